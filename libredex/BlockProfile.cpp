@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BlockProfile.h"
+
+#include "IRCode.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+BlockProfile::BlockProfile(
+    const Scope& scope,
+    const std::unordered_map<std::string, cfg::BlockCounts>& counts) {
+  std::atomic<size_t> tagged{0};
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    auto it = counts.find(show(method));
+    if (it == counts.end()) {
+      return;
+    }
+    const auto& method_counts = it->second;
+    m_methods.insert(method);
+    // The same CFG InstrumentPass builds, so that the block ids match.
+    code.build_cfg(/* editable */ false);
+    for (cfg::Block* block : code.cfg().blocks()) {
+      auto count_it = method_counts.find(block->id());
+      uint64_t count = count_it == method_counts.end() ? 0 : count_it->second;
+      for (const auto& mie : InstructionIterable(block)) {
+        m_tags.insert(
+            std::make_pair(mie.insn, Tag{count, mie.insn->opcode()}));
+        ++tagged;
+      }
+    }
+    code.clear_cfg();
+  });
+  TRACE(CFG, 2, "Block profile: tagged %zu instructions in %zu methods\n",
+        tagged.load(), m_methods.size());
+}
+
+cfg::BlockCounts BlockProfile::block_counts(
+    const DexMethod* method, const cfg::ControlFlowGraph& cfg) const {
+  cfg::BlockCounts result;
+  if (!has_counts(method)) {
+    return result;
+  }
+  for (cfg::Block* block : cfg.blocks()) {
+    for (const auto& mie : InstructionIterable(block)) {
+      auto it = m_tags.find(mie.insn);
+      if (it == m_tags.end() || it->second.opcode != mie.insn->opcode()) {
+        continue;
+      }
+      auto& count = result[block->id()];
+      count = std::max(count, it->second.count);
+    }
+  }
+  if (result.empty()) {
+    return result;
+  }
+
+  // Blocks without tags take the counts of their predecessors. Every round
+  // counts at least one more block, or nothing changes any more.
+  auto blocks = cfg.blocks();
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (cfg::Block* block : blocks) {
+      if (result.count(block->id())) {
+        continue;
+      }
+      bool found = false;
+      uint64_t count = 0;
+      for (cfg::Edge* e : block->preds()) {
+        auto it = result.find(e->src()->id());
+        if (it != result.end()) {
+          found = true;
+          count = std::max(count, it->second);
+        }
+      }
+      if (found) {
+        result.emplace(block->id(), count);
+        changed = true;
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "ConcurrentContainers.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+/*
+ * The per-block execution counts of the `profiled_blocks_file` (see
+ * docs/Config.md), carried from the input code to the code that is lowered.
+ *
+ * The file numbers the blocks of a method the way InstrumentPass does when it
+ * runs first: by their ids in the non-editable CFG of the code as loaded from
+ * the input dex. Those ids mean nothing once a pass has changed the method,
+ * so before the first pass runs, every instruction of a profiled block is
+ * tagged with the count of the block. When the code is lowered, the blocks of
+ * its editable CFG get their counts back from the tagged instructions they
+ * still contain.
+ *
+ * Code that gets new instructions, like inlined callees, or whose
+ * instructions are recreated, like code evicted to the IR spill, loses its
+ * tags; see block_counts() for how such blocks are counted.
+ */
+class BlockProfile {
+ public:
+  /*
+   * Tags the code in `scope`, which must not have been changed by any pass
+   * yet. `counts` is keyed by the method names as show() prints them at that
+   * point, then by block id. Blocks of a profiled method that have no count
+   * never ran.
+   */
+  BlockProfile(
+      const Scope& scope,
+      const std::unordered_map<std::string, cfg::BlockCounts>& counts);
+
+  bool has_counts(const DexMethod* method) const {
+    return m_methods.count(method) != 0;
+  }
+
+  /*
+   * The counts of the blocks of `cfg`, the editable CFG of `method`, or none
+   * if the method wasn't profiled. A block gets the largest count among its
+   * tagged instructions. A block without any takes the largest count of its
+   * predecessors, as it most likely holds code that a pass put in the place
+   * of theirs.
+   */
+  cfg::BlockCounts block_counts(const DexMethod* method,
+                                const cfg::ControlFlowGraph& cfg) const;
+
+ private:
+  struct Tag {
+    uint64_t count;
+    // The instruction a tag was put on may have been freed since, and its
+    // address reused. Checking the opcode rules out most such mix-ups; the
+    // others only cost some layout quality.
+    IROpcode opcode;
+  };
+
+  ConcurrentSet<const DexMethod*> m_methods;
+  ConcurrentMap<const IRInstruction*, Tag> m_tags;
+};
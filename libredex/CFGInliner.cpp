@@ -154,6 +154,8 @@ void CFGInliner::steal_contents(ControlFlowGraph* caller,
   caller->m_edges.reserve(caller->m_edges.size() + callee->m_edges.size());
   caller->m_edges.insert(callee->m_edges.begin(), callee->m_edges.end());
   callee->m_edges.clear();
+  caller->structure_changed();
+  callee->structure_changed();
 }
 
 /*
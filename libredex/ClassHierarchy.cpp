@@ -55,14 +55,6 @@ void build_class_hierarchy(ClassHierarchy& hierarchy, const DexClass* cls) {
   }
 }
 
-void build_external_hierarchy(ClassHierarchy& hierarchy) {
-  g_redex->walk_type_class(
-      [&](const DexType* type, const DexClass* cls) {
-        if (!cls->is_external() || is_interface(cls)) return;
-        build_class_hierarchy(hierarchy, cls);
-      });
-}
-
 // Find all the interfaces that extend 'intf'
 bool gather_intf_extenders(const DexType* extender,
                            const DexType* intf,
@@ -106,16 +98,38 @@ void build_interface_map(InterfaceMap& interfaces,
 }
 
 ClassHierarchy build_type_hierarchy(const Scope& scope) {
-  ClassHierarchy hierarchy;
+  ClassHierarchy hierarchy = g_redex->external_hierarchy()->classes;
   // build the type hierarchy
   for (const auto& cls : scope) {
     if (is_interface(cls)) continue;
     build_class_hierarchy(hierarchy, cls);
   }
-  build_external_hierarchy(hierarchy);
   return hierarchy;
 }
 
+ExternalHierarchy build_external_hierarchy(
+    const std::vector<const DexClass*>& external_classes) {
+  ExternalHierarchy external;
+  for (const auto& cls : external_classes) {
+    if (is_interface(cls)) {
+      load_interface_children(external.interface_children, cls);
+    } else {
+      build_class_hierarchy(external.classes, cls);
+    }
+  }
+  return external;
+}
+
+void load_interface_children(ClassHierarchy& children, const DexClass* intf) {
+  for (const auto& super_intf : intf->get_interfaces()->get_type_list()) {
+    children[super_intf].insert(intf->get_type());
+    const auto super_intf_cls = type_class(super_intf);
+    if (super_intf_cls != nullptr) {
+      load_interface_children(children, super_intf_cls);
+    }
+  }
+}
+
 InterfaceMap build_interface_map(const ClassHierarchy& hierarchy) {
   InterfaceMap interfaces;
   // build the type hierarchy
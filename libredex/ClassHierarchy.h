@@ -27,6 +27,28 @@ using ClassHierarchy = std::unordered_map<const DexType*, TypeSet>;
  */
 ClassHierarchy build_type_hierarchy(const Scope& scope);
 
+/**
+ * The parts of the hierarchy that only involve external classes: the
+ * parent-children relationship of the external classes that aren't
+ * interfaces, and the interfaces extending each interface, from the external
+ * interfaces up. Library classes far outnumber the app's but don't change
+ * once they are loaded, so RedexContext::external_hierarchy() keeps these
+ * until the next class is published.
+ */
+struct ExternalHierarchy {
+  ClassHierarchy classes;
+  ClassHierarchy interface_children;
+};
+
+ExternalHierarchy build_external_hierarchy(
+    const std::vector<const DexClass*>& external_classes);
+
+/**
+ * Adds the interfaces `intf` extends, directly or not, to `children`, each
+ * mapped to the interfaces that extend it.
+ */
+void load_interface_children(ClassHierarchy& children, const DexClass* intf);
+
 /**
  * Return the direct children of a type.
  */
@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -372,6 +376,491 @@ class ConcurrentSet final
   }
 };
 
+/*
+ * A drop-in replacement of ConcurrentMap for tables that are read much more
+ * often than they are modified, like the interning tables of RedexContext.
+ * Lookups (find, count, get, at) never take a lock.
+ *
+ * As in ConcurrentMap, the keys are spread across `n_slots` slots and writers
+ * lock the slot of the key they modify. Each slot is a chained hash table
+ * whose entries never change once readers can see them: an update links a new
+ * entry in place of the old one, and growing the table copies the entries
+ * into a new one. A lookup thus only follows pointers that were published
+ * with release semantics.
+ *
+ * Concurrent readers may still be looking at the entries and tables that were
+ * replaced, so these are kept until compact() is called at a point where
+ * nobody reads the map, or until clear() or the destructor. Maps that are
+ * updated or erased from a lot need to be compacted regularly.
+ */
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename Equal = std::equal_to<Key>,
+          size_t n_slots = 31>
+class ReadMostlyConcurrentMap final {
+  struct Node {
+    template <typename... Args>
+    explicit Node(Args&&... args) : entry(std::forward<Args>(args)...) {}
+
+    std::pair<const Key, Value> entry;
+    std::atomic<Node*> next{nullptr};
+  };
+
+  struct Table {
+    explicit Table(size_t log2_capacity)
+        : log2_capacity(log2_capacity),
+          buckets(new std::atomic<Node*>[capacity()]) {
+      for (size_t i = 0; i < capacity(); ++i) {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    size_t capacity() const { return size_t(1) << log2_capacity; }
+
+    // Fibonacci hashing, as the low bits of pointer hashes are all zeros.
+    size_t index(size_t hash) const {
+      return (uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> (64 - log2_capacity);
+    }
+
+    const size_t log2_capacity;
+    std::unique_ptr<std::atomic<Node*>[]> buckets;
+  };
+
+  static constexpr size_t INITIAL_LOG2_CAPACITY = 3;
+
+  struct Slot {
+    Slot() : table(new Table(INITIAL_LOG2_CAPACITY)) {}
+
+    std::atomic<Table*> table;
+    // The fields below are guarded by the lock.
+    size_t size{0};
+    boost::mutex lock;
+    // Replaced tables and entries, which concurrent readers may still use.
+    std::vector<Table*> old_tables;
+    std::vector<Node*> old_nodes;
+  };
+
+  template <bool is_const>
+  class Iterator final {
+    using SlotPtr = std::conditional_t<is_const, const Slot*, Slot*>;
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::pair<const Key, Value>;
+    using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<is_const, const value_type&, value_type&>;
+    using iterator_category = std::forward_iterator_tag;
+
+    Iterator(SlotPtr slots, size_t slot, size_t bucket, Node* node)
+        : m_slots(slots), m_slot(slot), m_bucket(bucket), m_node(node) {
+      skip_empty_buckets();
+    }
+
+    Iterator& operator++() {
+      always_assert(m_node != nullptr);
+      m_node = m_node->next.load(std::memory_order_acquire);
+      skip_empty_buckets();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator retval = *this;
+      ++(*this);
+      return retval;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return m_node == other.m_node;
+    }
+
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    reference operator*() const {
+      always_assert(m_node != nullptr);
+      return m_node->entry;
+    }
+
+    pointer operator->() const {
+      always_assert(m_node != nullptr);
+      return &m_node->entry;
+    }
+
+   private:
+    void skip_empty_buckets() {
+      while (m_node == nullptr && m_slot < n_slots) {
+        const Table* table = m_slots[m_slot].table.load();
+        if (++m_bucket < table->capacity()) {
+          m_node = table->buckets[m_bucket].load(std::memory_order_acquire);
+        } else {
+          ++m_slot;
+          // The bucket before the first one of the next slot.
+          m_bucket = size_t(-1);
+        }
+      }
+    }
+
+    SlotPtr m_slots;
+    size_t m_slot;
+    size_t m_bucket;
+    Node* m_node;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  ReadMostlyConcurrentMap() = default;
+
+  ReadMostlyConcurrentMap(const ReadMostlyConcurrentMap& map) {
+    insert(map.begin(), map.end());
+  }
+
+  ReadMostlyConcurrentMap(ReadMostlyConcurrentMap&& map) {
+    for (size_t i = 0; i < n_slots; ++i) {
+      swap_slots(m_slots[i], map.m_slots[i]);
+    }
+  }
+
+  template <typename InputIt>
+  ReadMostlyConcurrentMap(InputIt first, InputIt last) {
+    insert(first, last);
+  }
+
+  ~ReadMostlyConcurrentMap() {
+    for (auto& slot : m_slots) {
+      free_slot(slot);
+    }
+  }
+
+  /*
+   * Using iterators or accessor functions while the container is concurrently
+   * modified will result in undefined behavior.
+   */
+
+  iterator begin() { return iterator(m_slots, 0, size_t(-1), nullptr); }
+
+  iterator end() { return iterator(m_slots, n_slots, 0, nullptr); }
+
+  const_iterator begin() const {
+    return const_iterator(m_slots, 0, size_t(-1), nullptr);
+  }
+
+  const_iterator end() const {
+    return const_iterator(m_slots, n_slots, 0, nullptr);
+  }
+
+  const_iterator cbegin() const { return begin(); }
+
+  const_iterator cend() const { return end(); }
+
+  iterator find(const Key& key) {
+    size_t slot;
+    size_t bucket;
+    auto node = find_node(key, &slot, &bucket);
+    return node == nullptr ? end() : iterator(m_slots, slot, bucket, node);
+  }
+
+  const_iterator find(const Key& key) const {
+    size_t slot;
+    size_t bucket;
+    auto node = find_node(key, &slot, &bucket);
+    return node == nullptr ? end()
+                           : const_iterator(m_slots, slot, bucket, node);
+  }
+
+  size_t size() const {
+    size_t s = 0;
+    for (const auto& slot : m_slots) {
+      s += slot.size;
+    }
+    return s;
+  }
+
+  void reserve(size_t capacity) {
+    size_t slot_capacity = capacity / n_slots;
+    for (auto& slot : m_slots) {
+      boost::lock_guard<boost::mutex> lock(slot.lock);
+      while (slot.table.load()->capacity() < slot_capacity) {
+        grow(slot);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto& slot : m_slots) {
+      free_slot(slot);
+      slot.table.store(new Table(INITIAL_LOG2_CAPACITY));
+      slot.size = 0;
+    }
+  }
+
+  /*
+   * Frees the entries and tables that were replaced since the last call.
+   * This operation is not thread-safe: nobody may be reading the map, not
+   * even with the lock-free operations.
+   */
+  void compact() {
+    for (auto& slot : m_slots) {
+      free_old(slot);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  size_t count(const Key& key) const { return find_node(key) != nullptr; }
+
+  size_t count_unsafe(const Key& key) const { return count(key); }
+
+  /*
+   * This operation is always thread-safe and lock-free. It returns a copy of
+   * Value for compatibility with ConcurrentMap.
+   */
+  Value at(const Key& key) const { return at_unsafe(key); }
+
+  const Value& at_unsafe(const Key& key) const {
+    auto node = find_node(key);
+    if (node == nullptr) {
+      throw std::out_of_range("ReadMostlyConcurrentMap::at");
+    }
+    return node->entry.second;
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  Value get(const Key& key, Value default_value) const {
+    auto node = find_node(key);
+    return node == nullptr ? default_value : node->entry.second;
+  }
+
+  /*
+   * The Boolean return value denotes whether the insertion took place.
+   * This operation is always thread-safe.
+   */
+  bool insert(const std::pair<Key, Value>& entry) { return emplace(entry); }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  void insert(std::initializer_list<std::pair<Key, Value>> l) {
+    for (const auto& entry : l) {
+      insert(entry);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  void insert_or_assign(const std::pair<Key, Value>& entry) {
+    std::unique_ptr<Node> node(new Node(entry));
+    size_t hash = Hash()(entry.first);
+    auto& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    auto old_node = find_in_table(slot.table.load(), hash, entry.first);
+    if (old_node == nullptr) {
+      link(slot, hash, node.release());
+    } else {
+      replace(slot, hash, old_node, node.release());
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  template <typename... Args>
+  bool emplace(Args&&... args) {
+    std::unique_ptr<Node> node(new Node(std::forward<Args>(args)...));
+    const Key& key = node->entry.first;
+    size_t hash = Hash()(key);
+    auto& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    if (find_in_table(slot.table.load(), hash, key) != nullptr) {
+      return false;
+    }
+    link(slot, hash, node.release());
+    return true;
+  }
+
+  /*
+   * This operation atomically modifies an entry in the map. If the entry
+   * doesn't exist, it is created. The third argument of the updater function is
+   * a Boolean flag denoting whether the entry exists or not. The updater works
+   * on a copy of the value, which then replaces the entry.
+   */
+  void update(const Key& key,
+              const std::function<void(const Key&, Value&, bool)>& updater) {
+    size_t hash = Hash()(key);
+    auto& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    auto old_node = find_in_table(slot.table.load(), hash, key);
+    if (old_node == nullptr) {
+      Value value{};
+      updater(key, value, false);
+      link(slot, hash, new Node(key, std::move(value)));
+    } else {
+      Value value = old_node->entry.second;
+      updater(old_node->entry.first, value, true);
+      replace(slot, hash, old_node, new Node(key, std::move(value)));
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  size_t erase(const Key& key) {
+    size_t hash = Hash()(key);
+    auto& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    auto node = find_in_table(slot.table.load(), hash, key);
+    if (node == nullptr) {
+      return 0;
+    }
+    replace(slot, hash, node, node->next.load(std::memory_order_relaxed));
+    --slot.size;
+    return 1;
+  }
+
+  /*
+   * This operation is not thread-safe.
+   */
+  size_t bucket_size(size_t i) const {
+    always_assert(i < n_slots);
+    return m_slots[i].size;
+  }
+
+ private:
+  Node* find_node(const Key& key,
+                  size_t* slot_out = nullptr,
+                  size_t* bucket_out = nullptr) const {
+    size_t hash = Hash()(key);
+    size_t slot = hash % n_slots;
+    const Table* table =
+        m_slots[slot].table.load(std::memory_order_acquire);
+    size_t bucket = table->index(hash);
+    if (slot_out != nullptr) {
+      *slot_out = slot;
+      *bucket_out = bucket;
+    }
+    return find_in_bucket(table->buckets[bucket], key);
+  }
+
+  static Node* find_in_bucket(const std::atomic<Node*>& bucket,
+                              const Key& key) {
+    for (Node* node = bucket.load(std::memory_order_acquire); node != nullptr;
+         node = node->next.load(std::memory_order_acquire)) {
+      if (Equal()(node->entry.first, key)) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  static Node* find_in_table(const Table* table, size_t hash, const Key& key) {
+    return find_in_bucket(table->buckets[table->index(hash)], key);
+  }
+
+  // The functions below are called with the lock of the slot held.
+
+  void link(Slot& slot, size_t hash, Node* node) {
+    if (slot.size >= slot.table.load()->capacity()) {
+      grow(slot);
+    }
+    Table* table = slot.table.load();
+    auto& bucket = table->buckets[table->index(hash)];
+    node->next.store(bucket.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    bucket.store(node, std::memory_order_release);
+    ++slot.size;
+  }
+
+  // Makes whatever points to `old_node` point to `new_node` instead. When
+  // `new_node` is the successor of `old_node`, this unlinks `old_node`.
+  void replace(Slot& slot, size_t hash, Node* old_node, Node* new_node) {
+    Table* table = slot.table.load();
+    auto* link = &table->buckets[table->index(hash)];
+    while (link->load(std::memory_order_relaxed) != old_node) {
+      link = &link->load(std::memory_order_relaxed)->next;
+    }
+    auto next = old_node->next.load(std::memory_order_relaxed);
+    if (new_node != next) {
+      new_node->next.store(next, std::memory_order_relaxed);
+    }
+    link->store(new_node, std::memory_order_release);
+    slot.old_nodes.push_back(old_node);
+  }
+
+  void grow(Slot& slot) {
+    Table* old_table = slot.table.load();
+    auto new_table = new Table(old_table->log2_capacity + 1);
+    for (size_t i = 0; i < old_table->capacity(); ++i) {
+      for (Node* node = old_table->buckets[i].load(); node != nullptr;
+           node = node->next.load()) {
+        auto copy = new Node(node->entry);
+        auto& bucket =
+            new_table->buckets[new_table->index(Hash()(copy->entry.first))];
+        copy->next.store(bucket.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+        bucket.store(copy, std::memory_order_relaxed);
+        slot.old_nodes.push_back(node);
+      }
+    }
+    slot.table.store(new_table, std::memory_order_release);
+    slot.old_tables.push_back(old_table);
+  }
+
+  static void free_slot(Slot& slot) {
+    Table* table = slot.table.load();
+    for (size_t i = 0; i < table->capacity(); ++i) {
+      Node* node = table->buckets[i].load();
+      while (node != nullptr) {
+        Node* next = node->next.load();
+        delete node;
+        node = next;
+      }
+    }
+    delete table;
+    slot.table.store(nullptr);
+    free_old(slot);
+  }
+
+  static void free_old(Slot& slot) {
+    for (Table* old_table : slot.old_tables) {
+      delete old_table;
+    }
+    for (Node* old_node : slot.old_nodes) {
+      delete old_node;
+    }
+    slot.old_tables.clear();
+    slot.old_tables.shrink_to_fit();
+    slot.old_nodes.clear();
+    slot.old_nodes.shrink_to_fit();
+  }
+
+  static void swap_slots(Slot& a, Slot& b) {
+    Table* table = a.table.load();
+    a.table.store(b.table.load());
+    b.table.store(table);
+    std::swap(a.size, b.size);
+    std::swap(a.old_tables, b.old_tables);
+    std::swap(a.old_nodes, b.old_nodes);
+  }
+
+  Slot m_slots[n_slots];
+};
+
 namespace cc_impl {
 
 template <typename Container, size_t n_slots>
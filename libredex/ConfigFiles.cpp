@@ -157,11 +157,16 @@ ConfigFiles::ConfigFiles(const Json::Value& config, const std::string& outdir)
           config.get("coldstart_methods", "").asString()),
       m_profiled_methods_filename(
           config.get("profiled_methods_file", "").asString()),
+      m_profiled_blocks_filename(
+          config.get("profiled_blocks_file", "").asString()),
       m_printseeds(config.get("printseeds", "").asString()) {
 
   if (m_profiled_methods_filename != "") {
     load_method_to_weight();
   }
+  if (m_profiled_blocks_filename != "") {
+    load_block_counts();
+  }
 }
 
 ConfigFiles::ConfigFiles(const Json::Value& config) : ConfigFiles(config, "") {}
@@ -285,3 +290,29 @@ void ConfigFiles::load_method_to_weight() {
              m_profiled_methods_filename.c_str());
   TRACE(CUSTOMSORT, 2, "Preset sort weight count=%d\n", count);
 }
+
+/**
+ * The block profile has one `<method name> <block id> <count>` entry per
+ * line, where the names and block ids are those of the input code, as
+ * InstrumentPass numbers them when it runs first (see docs/Config.md and
+ * BlockProfile.h).
+ */
+void ConfigFiles::load_block_counts() {
+  std::ifstream infile(m_profiled_blocks_filename.c_str());
+  assert_log(infile, "Can't open block profile file: %s\n",
+             m_profiled_blocks_filename.c_str());
+
+  std::string method_name;
+  size_t block_id;
+  uint64_t count;
+  unsigned int entries = 0;
+  while (infile >> method_name >> block_id >> count) {
+    m_block_counts[method_name][block_id] = count;
+    entries++;
+  }
+
+  assert_log(entries > 0, "Block profile file %s didn't contain valid entries\n",
+             m_profiled_blocks_filename.c_str());
+  TRACE(CFG, 2, "Block profile: %u entries over %zu methods\n", entries,
+        m_block_counts.size());
+}
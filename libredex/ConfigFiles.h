@@ -110,6 +110,16 @@ struct ConfigFiles {
     return m_method_to_weight;
   }
 
+  /*
+   * Per-block execution counts, keyed by the method name in the input dex and
+   * then by block id, see BlockProfile.h.
+   */
+  const std::unordered_map<std::string,
+                           std::unordered_map<size_t, uint64_t>>&
+  get_block_counts() const {
+    return m_block_counts;
+  }
+
   bool save_move_map() const { return m_move_map; }
 
   const MethodMap& get_moved_methods_map() const {
@@ -149,6 +159,7 @@ struct ConfigFiles {
   std::vector<std::string> load_coldstart_methods();
   std::unordered_map<std::string, std::vector<std::string> > load_class_lists();
   void load_method_to_weight();
+  void load_block_counts();
 
   bool m_move_map{false};
   bool m_load_class_lists_attempted{false};
@@ -157,10 +168,13 @@ struct ConfigFiles {
   std::string m_coldstart_class_filename;
   std::string m_coldstart_method_filename;
   std::string m_profiled_methods_filename;
+  std::string m_profiled_blocks_filename;
   std::vector<std::string> m_coldstart_classes;
   std::vector<std::string> m_coldstart_methods;
   std::unordered_map<std::string, std::vector<std::string> > m_class_lists;
   std::unordered_map<std::string, unsigned int> m_method_to_weight;
+  std::unordered_map<std::string, std::unordered_map<size_t, uint64_t>>
+      m_block_counts;
   std::string m_printseeds; // Filename to dump computed seeds.
 
   // global no optimizations annotations
@@ -14,6 +14,7 @@
 #include <utility>
 
 #include "DexUtil.h"
+#include "Dominators.h"
 #include "Transform.h"
 #include "WeakTopologicalOrdering.h"
 
@@ -687,6 +688,7 @@ uint32_t ControlFlowGraph::remove_unreachable_blocks() {
       always_assert(b->preds().empty());
       delete b;
       it = m_blocks.erase(it);
+      structure_changed();
     } else {
       ++it;
     }
@@ -753,6 +755,7 @@ void ControlFlowGraph::remove_empty_blocks() {
         m_entry_block = succ;
       }
     }
+    structure_changed();
 
     for (const auto& mie : *b) {
       if (mie.type == MFLOW_POSITION) {
@@ -1024,6 +1027,7 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
   if (this->m_exit_block != nullptr) {
     new_cfg->m_exit_block = new_cfg->m_blocks.at(this->m_exit_block->id());
   }
+  new_cfg->structure_changed();
 }
 
 cfg::InstructionIterator ControlFlowGraph::to_cfg_instruction_iterator(
@@ -1055,7 +1059,9 @@ std::vector<Block*> ControlFlowGraph::order() {
   block_to_chain.reserve(m_blocks.size());
 
   build_chains(&chains, &block_to_chain);
-  const auto& result = wto_chains(block_to_chain);
+  const auto& result = m_block_counts.empty()
+                           ? wto_chains(block_to_chain)
+                           : profile_chains(block_to_chain);
 
   always_assert(result.size() == m_blocks.size());
   return result;
@@ -1094,7 +1100,13 @@ void ControlFlowGraph::build_chains(
         // We also add gotos that are in the same try because we can minimize
         // instructions (by using fallthroughs) without adding another try
         // region. This is not required, but empirical evidence shows that it
-        // generates smaller dex files.
+        // generates smaller dex files. With a profile, we don't glue hot and
+        // cold blocks together so that the cold ones can move out of the way.
+        if (!goto_block->starts_with_move_result() &&
+            !m_block_counts.empty() &&
+            (block_count(b) == 0) != (block_count(goto_block) == 0)) {
+          break;
+        }
         const auto& pair = block_to_chain->emplace(goto_block, chain);
         bool was_already_there = !pair.second;
         if (was_already_there) {
@@ -1166,6 +1178,104 @@ std::vector<Block*> ControlFlowGraph::wto_chains(
   return wto_order;
 }
 
+uint64_t ControlFlowGraph::block_count(const Block* b) const {
+  auto it = m_block_counts.find(b->id());
+  return it == m_block_counts.end() ? 0 : it->second;
+}
+
+std::vector<Block*> ControlFlowGraph::profile_chains(
+    const std::unordered_map<Block*, Chain*>& block_to_chain) {
+  // Use the WTO as the baseline so that ties (and all the cold code) keep the
+  // order we would have chosen without a profile.
+  const auto& wto_order = wto_chains(block_to_chain);
+  std::vector<Chain*> chain_order;
+  std::unordered_map<Chain*, uint64_t> chain_counts;
+  for (Block* b : wto_order) {
+    Chain* chain = block_to_chain.at(b);
+    auto pair = chain_counts.emplace(chain, 0);
+    if (pair.second) {
+      chain_order.push_back(chain);
+    }
+    pair.first->second = std::max(pair.first->second, block_count(b));
+  }
+
+  // Seeds of the hot paths: the entry first, then the other hot chains by
+  // decreasing count.
+  std::vector<Chain*> seeds;
+  Chain* entry_chain = block_to_chain.at(entry_block());
+  seeds.push_back(entry_chain);
+  for (Chain* chain : chain_order) {
+    if (chain != entry_chain && chain_counts.at(chain) > 0) {
+      seeds.push_back(chain);
+    }
+  }
+  std::stable_sort(seeds.begin() + 1, seeds.end(),
+                   [&chain_counts](Chain* a, Chain* b) {
+                     return chain_counts.at(a) > chain_counts.at(b);
+                   });
+
+  std::vector<Block*> result;
+  result.reserve(wto_order.size());
+  std::unordered_set<Chain*> placed;
+  const auto& place = [&result, &placed](Chain* chain) {
+    placed.insert(chain);
+    result.insert(result.end(), chain->begin(), chain->end());
+  };
+  for (Chain* chain : seeds) {
+    while (chain != nullptr && placed.count(chain) == 0) {
+      place(chain);
+      // Grow the path along the hottest successor that isn't placed yet.
+      // Catch handlers are never reached by falling through, skip them.
+      Chain* next = nullptr;
+      uint64_t next_count = 0;
+      for (Edge* e : chain->back()->succs()) {
+        if (e->type() == EDGE_THROW || e->type() == EDGE_GHOST) {
+          continue;
+        }
+        Chain* succ_chain = block_to_chain.at(e->target());
+        auto count = chain_counts.at(succ_chain);
+        if (placed.count(succ_chain) == 0 && count > next_count) {
+          next = succ_chain;
+          next_count = count;
+        }
+      }
+      chain = next;
+    }
+  }
+  for (Chain* chain : chain_order) {
+    if (placed.count(chain) == 0) {
+      place(chain);
+    }
+  }
+  return result;
+}
+
+void ControlFlowGraph::invert_branches_for_fallthrough(
+    const std::vector<Block*>& ordering) {
+  for (auto it = ordering.begin(); it != ordering.end(); ++it) {
+    auto next_it = std::next(it);
+    if (next_it == ordering.end()) {
+      break;
+    }
+    Block* b = *it;
+    auto branch_it = b->get_conditional_branch();
+    if (branch_it == b->end() ||
+        !is_conditional_branch(branch_it->insn->opcode())) {
+      continue;
+    }
+    Edge* goto_edge = get_succ_edge_of_type(b, EDGE_GOTO);
+    Edge* branch_edge = get_succ_edge_of_type(b, EDGE_BRANCH);
+    if (goto_edge == nullptr || branch_edge == nullptr ||
+        goto_edge->target() == *next_it || branch_edge->target() != *next_it) {
+      continue;
+    }
+    auto insn = branch_it->insn;
+    insn->set_opcode(opcode::invert_conditional_branch(insn->opcode()));
+    goto_edge->m_type = EDGE_BRANCH;
+    branch_edge->m_type = EDGE_GOTO;
+  }
+}
+
 // Add an MFLOW_TARGET at the end of each edge.
 // Insert GOTOs where necessary.
 void ControlFlowGraph::insert_branches_and_targets(
@@ -1225,6 +1335,9 @@ IRList* ControlFlowGraph::linearize() {
   sanity_check();
 
   const std::vector<Block*>& ordering = order();
+  if (!m_block_counts.empty()) {
+    invert_branches_for_fallthrough(ordering);
+  }
   insert_branches_and_targets(ordering);
   insert_try_catch_markers(ordering);
 
@@ -1426,6 +1539,7 @@ Block* ControlFlowGraph::create_block() {
   size_t id = next_block_id();
   Block* b = new Block(this, id);
   m_blocks.emplace(id, b);
+  structure_changed();
   return b;
 }
 
@@ -1551,6 +1665,7 @@ void ControlFlowGraph::calculate_exit_block() {
   eb.visit(entry_block());
   if (eb.exit_blocks.size() == 1) {
     m_exit_block = eb.exit_blocks[0];
+    structure_changed();
   } else {
     m_exit_block = create_block();
     for (Block* b : eb.exit_blocks) {
@@ -1706,6 +1821,7 @@ void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
   delete_succ_edges(succ);
   m_blocks.erase(succ->id());
   delete succ;
+  structure_changed();
 }
 
 void ControlFlowGraph::set_edge_target(Edge* edge, Block* new_target) {
@@ -1734,6 +1850,7 @@ void ControlFlowGraph::move_edge(Edge* edge,
 
   edge->src()->m_succs.push_back(edge);
   edge->target()->m_preds.push_back(edge);
+  structure_changed();
 }
 
 bool ControlFlowGraph::blocks_are_in_same_try(const Block* b1,
@@ -1833,6 +1950,7 @@ void ControlFlowGraph::remove_block(Block* block) {
                     "Block wasn't in CFG. Attempted double delete?");
   block->m_entries.clear_and_dispose();
   delete block;
+  structure_changed();
 }
 
 // delete old_block and reroute its predecessors to new_block
@@ -1962,6 +2080,33 @@ ControlFlowGraph::immediate_dominators() const {
   return postorder_dominator;
 }
 
+const DominatorTree& ControlFlowGraph::get_dominator_tree() const {
+  auto& cached = m_dominator_tree;
+  if (cached.analysis == nullptr || cached.version != m_structure_version) {
+    cached.analysis = std::make_shared<DominatorTree>(*this);
+    cached.version = m_structure_version;
+  }
+  return *cached.analysis;
+}
+
+const DominatorTree& ControlFlowGraph::get_post_dominator_tree() const {
+  auto& cached = m_post_dominator_tree;
+  if (cached.analysis == nullptr || cached.version != m_structure_version) {
+    cached.analysis = std::make_shared<DominatorTree>(*this, /* post */ true);
+    cached.version = m_structure_version;
+  }
+  return *cached.analysis;
+}
+
+const LoopInfo& ControlFlowGraph::get_loop_info() const {
+  auto& cached = m_loop_info;
+  if (cached.analysis == nullptr || cached.version != m_structure_version) {
+    cached.analysis = std::make_shared<LoopInfo>(*this, get_dominator_tree());
+    cached.version = m_structure_version;
+  }
+  return *cached.analysis;
+}
+
 ControlFlowGraph::EdgeSet ControlFlowGraph::remove_succ_edges(Block* b,
                                                               bool cleanup) {
   return remove_succ_edge_if(b, [](const Edge*) { return true; }, cleanup);
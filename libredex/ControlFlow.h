@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "IRCode.h"
+#include "ScratchAllocator.h"
 
 /**
  * A Control Flow Graph is a directed graph of Basic Blocks.
@@ -77,6 +78,8 @@ enum EdgeType {
 class Block;
 class ControlFlowGraph;
 class CFGInliner;
+class DominatorTree;
+class LoopInfo;
 
 struct ThrowInfo {
   // nullptr means catch all
@@ -171,12 +174,23 @@ class Edge final {
   Block* target() const { return m_target; }
   EdgeType type() const { return m_type; }
   boost::optional<CaseKey> case_key() const { return m_case_key; }
+
+  // Graphs are built and thrown away for every method, over and over.
+  static void* operator new(size_t size) {
+    return scratch::Pool<Edge>::allocate(size);
+  }
+  static void operator delete(void* p, size_t size) {
+    scratch::Pool<Edge>::deallocate(p, size);
+  }
 };
 
 std::ostream& operator<<(std::ostream& os, const Edge& e);
 
 using BlockId = size_t;
 
+// Execution counts of blocks, as collected by runtime instrumentation.
+using BlockCounts = std::unordered_map<BlockId, uint64_t>;
+
 template <bool is_const>
 class InstructionIteratorImpl;
 using InstructionIterator = InstructionIteratorImpl</* is_const */ false>;
@@ -265,6 +279,13 @@ class Block final {
     m_entries.push_back(*(new MethodItemEntry(std::forward<Args>(args)...)));
   }
 
+  static void* operator new(size_t size) {
+    return scratch::Pool<Block>::allocate(size);
+  }
+  static void operator delete(void* p, size_t size) {
+    scratch::Pool<Block>::deallocate(p, size);
+  }
+
  private:
   friend class ControlFlowGraph;
   friend class CFGInliner;
@@ -324,8 +345,14 @@ class ControlFlowGraph {
   const Block* exit_block() const { return m_exit_block; }
   Block* entry_block() { return m_entry_block; }
   Block* exit_block() { return m_exit_block; }
-  void set_entry_block(Block* b) { m_entry_block = b; }
-  void set_exit_block(Block* b) { m_exit_block = b; }
+  void set_entry_block(Block* b) {
+    m_entry_block = b;
+    structure_changed();
+  }
+  void set_exit_block(Block* b) {
+    m_exit_block = b;
+    structure_changed();
+  }
 
   /*
    * If there is a single method exit point, this returns a vector holding the
@@ -356,6 +383,7 @@ class ControlFlowGraph {
     m_edges.insert(edge);
     edge->src()->m_succs.emplace_back(edge);
     edge->target()->m_preds.emplace_back(edge);
+    structure_changed();
   }
 
   using EdgeSet = std::unordered_set<Edge*>;
@@ -493,6 +521,14 @@ class ControlFlowGraph {
   // Finding immediate dominator for each blocks in ControlFlowGraph.
   std::unordered_map<Block*, DominatorInfo> immediate_dominators() const;
 
+  // Cached structural analyses (see Dominators.h). They are computed on first
+  // use and recomputed after the blocks or edges of the graph change. The
+  // post-dominator tree depends on the exit block; call
+  // `calculate_exit_block()` first to root it at the real exit(s).
+  const DominatorTree& get_dominator_tree() const;
+  const DominatorTree& get_post_dominator_tree() const;
+  const LoopInfo& get_loop_info() const;
+
   // Do writes to this CFG propagate back to IR and Dex code?
   bool editable() const { return m_editable; }
 
@@ -560,6 +596,15 @@ class ControlFlowGraph {
   // choose an order of blocks for output
   std::vector<Block*> order();
 
+  // Provide per-block execution counts. When present, `order()` lays out the
+  // hot path as straight-line fallthrough code and moves blocks that never
+  // executed (throw paths, error handling, ...) to the end of the method.
+  // Blocks without a count are considered cold.
+  void set_block_counts(BlockCounts counts) {
+    m_block_counts = std::move(counts);
+  }
+  const BlockCounts& get_block_counts() const { return m_block_counts; }
+
  private:
   using BranchToTargets =
       std::unordered_map<MethodItemEntry*, std::vector<Block*>>;
@@ -569,6 +614,7 @@ class ControlFlowGraph {
   friend class InstructionIteratorImpl<false>;
   friend class InstructionIteratorImpl<true>;
   friend class CFGInliner;
+  friend class GraphInterface;
 
   // Find block boundaries in IRCode and create the blocks
   // For use by the constructor. You probably don't want to call this from
@@ -603,6 +649,18 @@ class ControlFlowGraph {
                     std::unordered_map<Block*, Chain*>* block_to_chain);
   std::vector<Block*> wto_chains(
       const std::unordered_map<Block*, Chain*>& block_to_chain);
+  // Profile-guided alternative to wto_chains. Starting from the entry, keep
+  // following the hottest successor chain so that the hot path falls through,
+  // then append the remaining hot chains by decreasing count and finally the
+  // cold chains in WTO order.
+  std::vector<Block*> profile_chains(
+      const std::unordered_map<Block*, Chain*>& block_to_chain);
+  uint64_t block_count(const Block* b) const;
+
+  // After a profile-guided ordering, the taken side of a conditional branch
+  // may end up right after the branch. Invert those branches so that the
+  // block falls through to it instead of needing an extra goto.
+  void invert_branches_for_fallthrough(const std::vector<Block*>& ordering);
 
   // Materialize target instructions and gotos corresponding to control-flow
   // edges. Used while turning back into a linear representation.
@@ -693,6 +751,7 @@ class ControlFlowGraph {
                                        }),
                         reverse_edges.end());
 
+    structure_changed();
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
@@ -729,6 +788,7 @@ class ControlFlowGraph {
           forward_edges.end());
     }
 
+    structure_changed();
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
@@ -765,6 +825,7 @@ class ControlFlowGraph {
           reverse_edges.end());
     }
 
+    structure_changed();
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
@@ -795,6 +856,17 @@ class ControlFlowGraph {
   // Return the next unused block identifier
   BlockId next_block_id() const;
 
+  // Must be called whenever blocks or edges are added or removed so that the
+  // cached analyses get recomputed.
+  void structure_changed() { ++m_structure_version; }
+
+  template <typename Analysis>
+  struct CachedAnalysis {
+    // shared_ptr because Analysis is incomplete here.
+    std::shared_ptr<Analysis> analysis;
+    size_t version{0};
+  };
+
   // The memory of all blocks and edges in this graph are owned here
   Blocks m_blocks;
   EdgeSet m_edges;
@@ -803,6 +875,12 @@ class ControlFlowGraph {
   Block* m_entry_block{nullptr};
   Block* m_exit_block{nullptr};
   bool m_editable{true};
+  BlockCounts m_block_counts;
+
+  size_t m_structure_version{1};
+  mutable CachedAnalysis<DominatorTree> m_dominator_tree;
+  mutable CachedAnalysis<DominatorTree> m_post_dominator_tree;
+  mutable CachedAnalysis<LoopInfo> m_loop_info;
   static constexpr bool DEBUG{false};
 };
 
@@ -819,14 +897,19 @@ class GraphInterface {
   static NodeId exit(const Graph& graph) {
     return const_cast<NodeId>(graph.exit_block());
   }
-  static std::vector<EdgeId> predecessors(const Graph&, const NodeId& b) {
+  static const std::vector<EdgeId>& predecessors(const Graph&,
+                                                 const NodeId& b) {
     return b->preds();
   }
-  static std::vector<EdgeId> successors(const Graph&, const NodeId& b) {
+  static const std::vector<EdgeId>& successors(const Graph&, const NodeId& b) {
     return b->succs();
   }
   static NodeId source(const Graph&, const EdgeId& e) { return e->src(); }
   static NodeId target(const Graph&, const EdgeId& e) { return e->target(); }
+  // Block ids are dense enough for the fixpoint iterator to keep its states in
+  // arrays indexed by block id.
+  static size_t index(const Graph&, const NodeId& b) { return b->id(); }
+  static size_t size(const Graph& graph) { return graph.next_block_id(); }
 };
 
 template <bool is_const>
@@ -16,6 +16,7 @@
 #include "DexUtil.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
+#include "IRSpill.h"
 #include "StringBuilder.h"
 #include "Util.h"
 #include "Walkers.h"
@@ -512,6 +513,12 @@ std::string DexMethod::get_fully_deobfuscated_name() const {
 
 void DexMethod::set_code(std::unique_ptr<IRCode> code) {
   m_code = std::move(code);
+  m_code_spilled = false;
+  m_code_touched = true;
+}
+
+void DexMethod::restore_code() const {
+  ir_spill::IRSpill::get()->restore(this);
 }
 
 void DexMethod::balloon() {
@@ -522,7 +529,7 @@ void DexMethod::balloon() {
 
 void DexMethod::sync() {
   assert(m_dex_code == nullptr);
-  m_dex_code = m_code->sync(this);
+  m_dex_code = get_code()->sync(this);
   m_code.reset();
 }
 
@@ -660,7 +667,7 @@ void DexMethod::make_concrete(DexAccessFlags access,
                               std::unique_ptr<IRCode> dc,
                               bool is_virtual) {
   m_access = access;
-  m_code = std::move(dc);
+  set_code(std::move(dc));
   m_concrete = true;
   m_virtual = is_virtual;
 }
@@ -744,7 +751,10 @@ void DexClass::load_class_data_item(DexIdx* idx,
   }
 }
 
-std::unique_ptr<IRCode> DexMethod::release_code() { return std::move(m_code); }
+std::unique_ptr<IRCode> DexMethod::release_code() {
+  touch_code();
+  return std::move(m_code);
+}
 
 void DexClass::add_method(DexMethod* m) {
   always_assert_log(m->is_concrete() || m->is_external(),
@@ -1172,7 +1182,7 @@ void DexField::gather_methods(std::vector<DexMethodRef*>& lmethod) const {
 
 void DexMethod::gather_types(std::vector<DexType*>& ltype) const {
   // We handle m_spec.cls and proto in the first-layer gather.
-  if (m_code) m_code->gather_types(ltype);
+  if (get_code()) get_code()->gather_types(ltype);
   if (m_anno) m_anno->gather_types(ltype);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1185,7 +1195,7 @@ void DexMethod::gather_types(std::vector<DexType*>& ltype) const {
 
 void DexMethod::gather_strings(std::vector<DexString*>& lstring) const {
   // We handle m_name and proto in the first-layer gather.
-  if (m_code) m_code->gather_strings(lstring);
+  if (get_code()) get_code()->gather_strings(lstring);
   if (m_anno) m_anno->gather_strings(lstring);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1197,7 +1207,7 @@ void DexMethod::gather_strings(std::vector<DexString*>& lstring) const {
 }
 
 void DexMethod::gather_fields(std::vector<DexFieldRef*>& lfield) const {
-  if (m_code) m_code->gather_fields(lfield);
+  if (get_code()) get_code()->gather_fields(lfield);
   if (m_anno) m_anno->gather_fields(lfield);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1209,7 +1219,7 @@ void DexMethod::gather_fields(std::vector<DexFieldRef*>& lfield) const {
 }
 
 void DexMethod::gather_methods(std::vector<DexMethodRef*>& lmethod) const {
-  if (m_code) m_code->gather_methods(lmethod);
+  if (get_code()) get_code()->gather_methods(lmethod);
   if (m_anno) m_anno->gather_methods(lmethod);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -57,6 +58,10 @@ class DexDebugInstruction;
 class DexOutputIdx;
 class DexString;
 class DexType;
+
+namespace ir_spill {
+class IRSpill;
+}
 using Scope = std::vector<DexClass*>;
 
 class DexString {
@@ -298,7 +303,9 @@ class DexField : public DexFieldRef {
   DexAccessFlags m_access;
   DexAnnotationSet* m_anno;
   DexEncodedValue* m_value; /* Static Only */
-  std::string m_deobfuscated_name;
+  // Interned, so that the fields of an app don't each hold a copy of their
+  // (mostly unique) name. nullptr if not set.
+  const DexString* m_deobfuscated_name{nullptr};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexField(DexType* container, DexString* name, DexType* type) :
@@ -355,7 +362,7 @@ class DexField : public DexFieldRef {
   void set_external() {
     always_assert_log(!m_concrete,
         "Unexpected concrete field %s\n", SHOW(this));
-    m_deobfuscated_name = show(this);
+    m_deobfuscated_name = DexString::make_string(show(this));
     m_external = true;
   }
 
@@ -374,9 +381,12 @@ class DexField : public DexFieldRef {
     return full_name.substr(dot_pos + 1, colon_pos-dot_pos - 1);
   }
 
-  void set_deobfuscated_name(std::string name) { m_deobfuscated_name = name; }
+  void set_deobfuscated_name(const std::string& name) {
+    m_deobfuscated_name = DexString::make_string(name);
+  }
   const std::string& get_deobfuscated_name() const {
-    return m_deobfuscated_name;
+    static const std::string empty;
+    return m_deobfuscated_name == nullptr ? empty : m_deobfuscated_name->str();
   }
 
   void make_concrete(DexAccessFlags access_flags, DexEncodedValue* v = nullptr);
@@ -807,20 +817,36 @@ class DexMethodRef {
 
 class DexMethod : public DexMethodRef {
   friend struct RedexContext;
+  friend class ir_spill::IRSpill;
 
   /* Concrete method members */
   DexAnnotationSet* m_anno;
   std::unique_ptr<DexCode> m_dex_code;
-  std::unique_ptr<IRCode> m_code;
+  // Null while the code is evicted to the IR spill, see IRSpill.h.
+  mutable std::unique_ptr<IRCode> m_code;
   DexAccessFlags m_access;
   bool m_virtual;
+  mutable std::atomic<bool> m_code_spilled{false};
+  // Whether get_code() was called since the IR spill last looked.
+  mutable std::atomic<bool> m_code_touched{true};
   ParamAnnotations m_param_anno;
-  std::string m_deobfuscated_name;
+  // Interned like the deobfuscated names of fields. nullptr if not set.
+  const DexString* m_deobfuscated_name{nullptr};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexMethod(DexType* type, DexString* name, DexProto* proto);
   ~DexMethod();
 
+  void touch_code() const {
+    if (!m_code_touched.load(std::memory_order_relaxed)) {
+      m_code_touched.store(true, std::memory_order_relaxed);
+    }
+    if (m_code_spilled.load(std::memory_order_acquire)) {
+      restore_code();
+    }
+  }
+  void restore_code() const;
+
   // For friend classes to use with smart pointers.
   struct Deleter {
     void operator()(DexMethod* m) {
@@ -919,8 +945,14 @@ class DexMethod : public DexMethodRef {
   DexAnnotationSet* get_anno_set() { return m_anno; }
   const DexCode* get_dex_code() const { return m_dex_code.get(); }
   DexCode* get_dex_code() { return m_dex_code.get(); }
-  IRCode* get_code() { return m_code.get(); }
-  const IRCode* get_code() const { return m_code.get(); }
+  IRCode* get_code() {
+    touch_code();
+    return m_code.get();
+  }
+  const IRCode* get_code() const {
+    touch_code();
+    return m_code.get();
+  }
   std::unique_ptr<IRCode> release_code();
   bool is_virtual() const { return m_virtual; }
   DexAccessFlags get_access() const {
@@ -938,9 +970,12 @@ class DexMethod : public DexMethodRef {
 
   // Note: be careful to maintain 1:1 mapping between name (possibily
   // obfuscated) and deobfuscated name, when you mutate the method.
-  void set_deobfuscated_name(std::string name) { m_deobfuscated_name = name; }
+  void set_deobfuscated_name(const std::string& name) {
+    m_deobfuscated_name = DexString::make_string(name);
+  }
   const std::string& get_deobfuscated_name() const {
-    return m_deobfuscated_name;
+    static const std::string empty;
+    return m_deobfuscated_name == nullptr ? empty : m_deobfuscated_name->str();
   }
 
   // Return just the name of the method.
@@ -965,7 +1000,7 @@ class DexMethod : public DexMethodRef {
   void set_external() {
     always_assert_log(!m_concrete,
         "Unexpected concrete method %s\n", SHOW(this));
-    m_deobfuscated_name = show(this);
+    m_deobfuscated_name = DexString::make_string(show(this));
     m_external = true;
   }
   void set_dex_code(std::unique_ptr<DexCode> code) {
@@ -34,6 +34,7 @@ class DexLoader {
     if (m_file.is_open()) m_file.close();
   }
   DexClasses load_dex(const char* location, dex_stats_t* stats);
+  DexClasses load_dex(const uint8_t* data, size_t size, dex_stats_t* stats);
   void load_dex_class(int num);
   void gather_input_stats(dex_stats_t* stats, const dex_header* dh);
 };
@@ -177,18 +178,24 @@ DexClasses DexLoader::load_dex(const char* location, dex_stats_t* stats) {
     fprintf(stderr, "error: cannot create memory-mapped file: %s\n", location);
     exit(EXIT_FAILURE);
   }
-  auto dh = reinterpret_cast<const dex_header*>(m_file.const_data());
-  validate_dex_header(dh, m_file.size());
+  return load_dex(reinterpret_cast<const uint8_t*>(m_file.const_data()),
+                  m_file.size(), stats);
+}
+
+DexClasses DexLoader::load_dex(const uint8_t* data,
+                               size_t size,
+                               dex_stats_t* stats) {
+  auto dh = reinterpret_cast<const dex_header*>(data);
+  validate_dex_header(dh, size);
   if (dh->class_defs_size == 0) {
     return DexClasses(0);
   }
   m_idx = new DexIdx(dh);
   auto off = (uint64_t)dh->class_defs_off;
   auto limit = off + dh->class_defs_size * sizeof(dex_class_def);
-  always_assert_log(off < m_file.size(), "class_defs_off out of range");
-  always_assert_log(limit <= m_file.size(), "invalid class_defs_size");
-  m_class_defs =
-      reinterpret_cast<const dex_class_def*>(m_file.const_data() + off);
+  always_assert_log(off < size, "class_defs_off out of range");
+  always_assert_log(limit <= size, "invalid class_defs_size");
+  m_class_defs = reinterpret_cast<const dex_class_def*>(data + off);
   DexClasses classes(dh->class_defs_size);
   m_classes = &classes;
 
@@ -244,4 +251,18 @@ DexClasses load_classes_from_dex(const char* location,
   return classes;
 }
 
+DexClasses load_classes_from_dex(const char* location,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 dex_stats_t* stats,
+                                 bool balloon) {
+  TRACE(MAIN, 1, "Loading classes from dex in memory from %s\n", location);
+  DexLoader dl(location);
+  auto classes = dl.load_dex(data, size, stats);
+  if (balloon) {
+    balloon_all(classes);
+  }
+  return classes;
+}
+
 void balloon_for_test(const Scope& scope) { balloon_all(scope); }
@@ -14,5 +14,12 @@
 
 DexClasses load_classes_from_dex(const char* location, bool balloon = true);
 DexClasses load_classes_from_dex(const char* location, dex_stats_t* stats, bool balloon = true);
+// Loads a dex file that is already in memory, e.g., read from an APK. The
+// location is only used to name the dex file.
+DexClasses load_classes_from_dex(const char* location,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 dex_stats_t* stats,
+                                 bool balloon = true);
 
 void balloon_for_test(const Scope& scope);
@@ -884,18 +884,19 @@ void DexOutput::generate_class_data_items() {
 
 static void sync_all(const Scope& scope) {
   constexpr bool serial = false; // for debugging
-  auto wq = workqueue_foreach<DexMethod*>([](DexMethod* m){m->sync();});
-  walk::code(scope,
-            [](DexMethod*) { return true; },
-            [&](DexMethod* m, IRCode&) {
-              if (serial) {
-                TRACE(MTRANS, 2, "Syncing %s\n", SHOW(m));
-                m->sync();
-              } else {
-                wq.add_item(m);
-              }
-            });
-  wq.run_all();
+  if (serial) {
+    walk::code(scope, [](DexMethod* m, IRCode&) {
+      TRACE(MTRANS, 2, "Syncing %s\n", SHOW(m));
+      m->sync();
+    });
+    return;
+  }
+  // Branch relaxation may take several passes over a method, so the largest
+  // ones go first to keep them from ending up last on a single thread. Like
+  // the WorkQueue this used to run on, it uses all the cores.
+  walk::parallel::code_by_size(
+      scope, [](DexMethod* m, IRCode&) { m->sync(); },
+      std::max(1u, boost::thread::hardware_concurrency()));
 }
 
 void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
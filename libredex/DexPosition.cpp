@@ -5,13 +5,17 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <array>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <json/json.h>
+#include <mutex>
 
 #include "DexClass.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
+#include "WorkQueue.h"
 
 DexPosition::DexPosition(uint32_t line) : line(line), parent(nullptr) {}
 
@@ -28,173 +32,209 @@ bool DexPosition::operator==(const DexPosition& that) const {
            *parent == *that.parent));
 }
 
-void RealPositionMapper::register_position(DexPosition* pos) {
-  m_pos_line_map[pos] = -1;
-}
-
-uint32_t RealPositionMapper::get_line(DexPosition* pos) {
-  return m_pos_line_map.at(pos) + 1;
-}
+namespace {
 
-uint32_t RealPositionMapper::position_to_line(DexPosition* pos) {
-  auto idx = m_positions.size();
-  m_positions.emplace_back(pos);
-  m_pos_line_map[pos] = idx;
-  return get_line(pos);
-}
+// Number of positions each work item of the map writer encodes.
+constexpr size_t POSITIONS_PER_CHUNK = 1 << 16;
 
-void RealPositionMapper::write_map() {
-  if (m_filename != "") {
-    write_map_v1();
-  }
-  if (m_filename_v2 != "") {
-    write_map_v2();
-  }
-}
+std::mutex s_cerr_mutex;
 
-void RealPositionMapper::write_map_v1() {
-  // to ensure that the line numbers in the Dex are as compact as possible,
-  // we put the emitted positions at the start of the list and rest at the end
-  for (auto item : m_pos_line_map) {
-    auto line = item.second;
-    if (line == -1) {
-      auto idx = m_positions.size();
-      m_positions.emplace_back(item.first);
-      m_pos_line_map[item.first] = idx;
+/*
+ * Map file layout:
+ * 0xfaceb000 (magic number)
+ * version (4 bytes)
+ * string_pool_size (4 bytes)
+ * string_pool[string_pool_size]
+ * positions_size (4 bytes)
+ * positions[positions_size]
+ *
+ * Each member of the string pool is encoded as follows:
+ * string_length (4 bytes)
+ * char[string_length]
+ *
+ * Each position is the ids of the N strings returned by `get_strings`, then
+ * its line and the line of its parent (4 bytes each).
+ *
+ * The positions are encoded in parallel chunks. Each chunk first interns its
+ * strings locally; the local pools are then merged in chunk order, so the
+ * string ids are the same as if the positions were encoded one by one.
+ */
+template <size_t N, typename GetStrings, typename GetParentLine>
+void write_map_file(const std::string& filename,
+                    uint32_t version,
+                    const std::vector<DexPosition*>& positions,
+                    const GetStrings& get_strings,
+                    const GetParentLine& get_parent_line) {
+  struct Chunk {
+    std::vector<std::string> strings;
+    // N local string ids per position.
+    std::vector<uint32_t> string_ids;
+    std::string out;
+  };
+  size_t num_chunks =
+      (positions.size() + POSITIONS_PER_CHUNK - 1) / POSITIONS_PER_CHUNK;
+  std::vector<Chunk> chunks(num_chunks);
+  auto for_each_chunk = [&](const std::function<void(size_t, Chunk&)>& f) {
+    auto wq = workqueue_foreach<size_t>([&](size_t c) {
+      f(c * POSITIONS_PER_CHUNK, chunks[c]);
+    });
+    for (size_t c = 0; c < num_chunks; ++c) {
+      wq.add_item(c);
     }
-  }
-  /*
-   * Map file layout:
-   * 0xfaceb000 (magic number)
-   * version (4 bytes)
-   * string_pool_size (4 bytes)
-   * string_pool[string_pool_size]
-   * positions_size (4 bytes)
-   * positions[positions_size]
-   *
-   * Each member of the string pool is encoded as follows:
-   * string_length (4 bytes)
-   * char[string_length]
-   */
-  std::ostringstream pos_out;
-  std::unordered_map<DexString*, uint32_t> string_ids;
-  std::vector<DexString*> string_pool;
-
-  for (auto pos : m_positions) {
-    uint32_t parent_line = 0;
-    try {
-      parent_line = pos->parent == nullptr ? 0 : get_line(pos->parent);
-    } catch (std::out_of_range& e) {
-      std::cerr << "Parent position " << show(pos->parent) << " of "
-                << show(pos) << " was not registered" << std::endl;
+    wq.run_all();
+  };
+  auto chunk_end = [&](size_t begin) {
+    return std::min(begin + POSITIONS_PER_CHUNK, positions.size());
+  };
+
+  for_each_chunk([&](size_t begin, Chunk& chunk) {
+    std::unordered_map<std::string, uint32_t> local_ids;
+    chunk.string_ids.reserve((chunk_end(begin) - begin) * N);
+    for (size_t i = begin; i < chunk_end(begin); ++i) {
+      for (auto& s : get_strings(positions[i])) {
+        auto it = local_ids.emplace(std::move(s), chunk.strings.size());
+        if (it.second) {
+          chunk.strings.push_back(it.first->first);
+        }
+        chunk.string_ids.push_back(it.first->second);
+      }
     }
-    if (string_ids.find(pos->file) == string_ids.end()) {
-      string_ids[pos->file] = string_pool.size();
-      string_pool.push_back(pos->file);
+  });
+
+  std::unordered_map<std::string, uint32_t> string_ids;
+  std::vector<std::string> string_pool;
+  std::vector<std::vector<uint32_t>> global_ids(num_chunks);
+  for (size_t c = 0; c < num_chunks; ++c) {
+    for (auto& s : chunks[c].strings) {
+      auto it = string_ids.emplace(s, string_pool.size());
+      if (it.second) {
+        string_pool.push_back(std::move(s));
+      }
+      global_ids[c].push_back(it.first->second);
     }
-    auto string_id = string_ids[pos->file];
-    pos_out.write((const char*)&string_id, sizeof(string_id));
-    pos_out.write((const char*)&pos->line, sizeof(pos->line));
-    pos_out.write((const char*)&parent_line, sizeof(parent_line));
   }
 
-  std::ofstream ofs(m_filename.c_str(),
+  for_each_chunk([&](size_t begin, Chunk& chunk) {
+    const auto& ids = global_ids[begin / POSITIONS_PER_CHUNK];
+    chunk.out.reserve((chunk_end(begin) - begin) * (N + 2) * sizeof(uint32_t));
+    auto write = [&chunk](uint32_t value) {
+      chunk.out.append((const char*)&value, sizeof(value));
+    };
+    size_t j = 0;
+    for (size_t i = begin; i < chunk_end(begin); ++i) {
+      for (size_t k = 0; k < N; ++k) {
+        write(ids[chunk.string_ids[j++]]);
+      }
+      write(positions[i]->line);
+      write(get_parent_line(positions[i]));
+    }
+  });
+
+  std::ofstream ofs(filename.c_str(),
                     std::ofstream::out | std::ofstream::trunc);
   uint32_t magic = 0xfaceb000; // serves as endianess check
   ofs.write((const char*)&magic, sizeof(magic));
-  uint32_t version = 1;
   ofs.write((const char*)&version, sizeof(version));
   uint32_t spool_count = string_pool.size();
   ofs.write((const char*)&spool_count, sizeof(spool_count));
-  for (auto s : string_pool) {
-    uint32_t ssize = s->size();
+  for (const auto& s : string_pool) {
+    uint32_t ssize = s.size();
     ofs.write((const char*)&ssize, sizeof(ssize));
-    ofs << s->c_str();
+    ofs.write(s.data(), s.size());
   }
-  uint32_t pos_count = m_positions.size();
+  uint32_t pos_count = positions.size();
   ofs.write((const char*)&pos_count, sizeof(pos_count));
-  ofs << pos_out.str();
+  for (const auto& chunk : chunks) {
+    ofs.write(chunk.out.data(), chunk.out.size());
+  }
 }
 
-void RealPositionMapper::write_map_v2() {
+} // namespace
+
+void RealPositionMapper::register_position(DexPosition* pos) {
+  if (m_pos_line_map.emplace(pos, -1).second) {
+    m_registered.push_back(pos);
+  }
+}
+
+uint32_t RealPositionMapper::get_line(DexPosition* pos) const {
+  return m_pos_line_map.at(pos) + 1;
+}
+
+uint32_t RealPositionMapper::get_parent_line(DexPosition* pos) const {
+  if (pos->parent == nullptr) {
+    return 0;
+  }
+  auto it = m_pos_line_map.find(pos->parent);
+  if (it == m_pos_line_map.end()) {
+    std::lock_guard<std::mutex> lock(s_cerr_mutex);
+    std::cerr << "Parent position " << show(pos->parent) << " of "
+              << show(pos) << " was not registered" << std::endl;
+    return 0;
+  }
+  return it->second + 1;
+}
+
+uint32_t RealPositionMapper::position_to_line(DexPosition* pos) {
+  auto idx = m_positions.size();
+  m_positions.emplace_back(pos);
+  m_pos_line_map[pos] = idx;
+  return get_line(pos);
+}
+
+void RealPositionMapper::assign_unemitted_lines() {
   // to ensure that the line numbers in the Dex are as compact as possible,
   // we put the emitted positions at the start of the list and rest at the end
-  for (auto item : m_pos_line_map) {
-    auto line = item.second;
+  for (auto pos : m_registered) {
+    auto& line = m_pos_line_map.at(pos);
     if (line == -1) {
-      auto idx = m_positions.size();
-      m_positions.emplace_back(item.first);
-      m_pos_line_map[item.first] = idx;
+      line = m_positions.size();
+      m_positions.emplace_back(pos);
     }
   }
-  /*
-   * Map file layout:
-   * 0xfaceb000 (magic number)
-   * version (4 bytes)
-   * string_pool_size (4 bytes)
-   * string_pool[string_pool_size]
-   * positions_size (4 bytes)
-   * positions[positions_size]
-   *
-   * Each member of the string pool is encoded as follows:
-   * string_length (4 bytes)
-   * char[string_length]
-   */
-  std::ostringstream pos_out;
-  std::unordered_map<std::string, uint32_t> string_ids;
-  std::vector<std::string> string_pool;
-
-  auto id_of_string = [&](const std::string& s) -> uint32_t {
-    if (string_ids.find(s) == string_ids.end()) {
-      string_ids[s] = string_pool.size();
-      string_pool.push_back(s);
-    }
-    return string_ids.at(s);
-  };
+  m_registered.clear();
+}
 
-  for (auto pos : m_positions) {
-    uint32_t parent_line = 0;
-    try {
-      parent_line = pos->parent == nullptr ? 0 : get_line(pos->parent);
-    } catch (std::out_of_range& e) {
-      std::cerr << "Parent position " << show(pos->parent) << " of "
-                << show(pos) << " was not registered" << std::endl;
-    }
-    // of the form "class_name.method_name:(arg_types)return_type"
-    auto full_method_name = pos->method->get_deobfuscated_name();
-    // strip out the args and return type
-    auto qualified_method_name =
-      full_method_name.substr(0, full_method_name.find(":"));
-    auto class_name = JavaNameUtil::internal_to_external(
-        qualified_method_name.substr(0, qualified_method_name.rfind(".")));
-    auto method_name =
-        qualified_method_name.substr(qualified_method_name.rfind(".") + 1);
-    auto class_id = id_of_string(class_name);
-    auto method_id = id_of_string(method_name);
-    auto file_id = id_of_string(pos->file->c_str());
-    pos_out.write((const char*)&class_id, sizeof(class_id));
-    pos_out.write((const char*)&method_id, sizeof(method_id));
-    pos_out.write((const char*)&file_id, sizeof(file_id));
-    pos_out.write((const char*)&pos->line, sizeof(pos->line));
-    pos_out.write((const char*)&parent_line, sizeof(parent_line));
+void RealPositionMapper::write_map() {
+  assign_unemitted_lines();
+  if (m_filename != "") {
+    write_map_v1();
   }
-
-  std::ofstream ofs(m_filename_v2.c_str(),
-                    std::ofstream::out | std::ofstream::trunc);
-  uint32_t magic = 0xfaceb000; // serves as endianess check
-  ofs.write((const char*)&magic, sizeof(magic));
-  uint32_t version = 2;
-  ofs.write((const char*)&version, sizeof(version));
-  uint32_t spool_count = string_pool.size();
-  ofs.write((const char*)&spool_count, sizeof(spool_count));
-  for (auto s : string_pool) {
-    uint32_t ssize = s.size();
-    ofs.write((const char*)&ssize, sizeof(ssize));
-    ofs << s;
+  if (m_filename_v2 != "") {
+    write_map_v2();
   }
-  uint32_t pos_count = m_positions.size();
-  ofs.write((const char*)&pos_count, sizeof(pos_count));
-  ofs << pos_out.str();
+}
+
+void RealPositionMapper::write_map_v1() {
+  write_map_file<1>(
+      m_filename,
+      1,
+      m_positions,
+      [](DexPosition* pos) {
+        return std::array<std::string, 1>{{pos->file->str()}};
+      },
+      [this](DexPosition* pos) { return get_parent_line(pos); });
+}
+
+void RealPositionMapper::write_map_v2() {
+  write_map_file<3>(
+      m_filename_v2,
+      2,
+      m_positions,
+      [](DexPosition* pos) {
+        // of the form "class_name.method_name:(arg_types)return_type"
+        const auto& full_method_name = pos->method->get_deobfuscated_name();
+        // strip out the args and return type
+        auto qualified_method_name =
+            full_method_name.substr(0, full_method_name.find(":"));
+        auto class_name = JavaNameUtil::internal_to_external(
+            qualified_method_name.substr(0, qualified_method_name.rfind(".")));
+        auto method_name =
+            qualified_method_name.substr(qualified_method_name.rfind(".") + 1);
+        return std::array<std::string, 3>{
+            {std::move(class_name), std::move(method_name), pos->file->str()}};
+      },
+      [this](DexPosition* pos) { return get_parent_line(pos); });
 }
 
 PositionMapper* PositionMapper::make(const std::string& map_filename,
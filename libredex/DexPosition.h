@@ -52,9 +52,14 @@ class RealPositionMapper : public PositionMapper {
   std::string m_filename;
   std::string m_filename_v2;
   std::vector<DexPosition*> m_positions;
+  // The registered positions in registration order, so that the ones that
+  // were never emitted are written in a deterministic order.
+  std::vector<DexPosition*> m_registered;
   std::unordered_map<DexPosition*, int64_t> m_pos_line_map;
  protected:
-  uint32_t get_line(DexPosition*);
+  uint32_t get_line(DexPosition*) const;
+  uint32_t get_parent_line(DexPosition*) const;
+  void assign_unemitted_lines();
   void write_map_v1();
   void write_map_v2();
  public:
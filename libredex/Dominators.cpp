@@ -0,0 +1,300 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Dominators.h"
+
+#include <utility>
+
+namespace cfg {
+
+namespace {
+
+BlockId max_block_id(const std::vector<Block*>& blocks) {
+  BlockId max_id = 0;
+  for (Block* b : blocks) {
+    max_id = std::max(max_id, b->id());
+  }
+  return max_id;
+}
+
+} // namespace
+
+constexpr uint32_t DominatorTree::NONE;
+
+DominatorTree::DominatorTree(const ControlFlowGraph& cfg, bool post)
+    : m_post(post) {
+  const auto& all_blocks = cfg.blocks();
+  if (all_blocks.empty()) {
+    return;
+  }
+  m_id_to_index.assign(max_block_id(all_blocks) + 1, NONE);
+
+  // The edges followed from the root, and the ones leading back to it.
+  const auto& forward = [post](Block* b) -> const std::vector<Edge*>& {
+    return post ? b->preds() : b->succs();
+  };
+  const auto& backward = [post](Block* b) -> const std::vector<Edge*>& {
+    return post ? b->succs() : b->preds();
+  };
+  const auto& forward_node = [post](const Edge* e) {
+    return post ? e->src() : e->target();
+  };
+  const auto& backward_node = [post](const Edge* e) {
+    return post ? e->target() : e->src();
+  };
+
+  std::vector<Block*> roots;
+  if (!post) {
+    roots.push_back(const_cast<Block*>(cfg.entry_block()));
+  } else if (cfg.exit_block() != nullptr) {
+    roots.push_back(const_cast<Block*>(cfg.exit_block()));
+  } else {
+    for (Block* b : all_blocks) {
+      if (b->succs().empty()) {
+        roots.push_back(b);
+      }
+    }
+  }
+  if (roots.size() != 1) {
+    m_virtual_root = 0;
+  }
+
+  // Iterative depth first search to get the postorder from the root(s).
+  std::vector<Block*> postorder;
+  postorder.reserve(all_blocks.size());
+  std::vector<bool> visited(m_id_to_index.size());
+  std::vector<std::pair<Block*, size_t>> stack;
+  for (Block* root : roots) {
+    if (visited[root->id()]) {
+      continue;
+    }
+    visited[root->id()] = true;
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+      Block* b = stack.back().first;
+      size_t edge_index = stack.back().second++;
+      const auto& edges = forward(b);
+      if (edge_index < edges.size()) {
+        Block* next = forward_node(edges[edge_index]);
+        if (!visited[next->id()]) {
+          visited[next->id()] = true;
+          stack.emplace_back(next, 0);
+        }
+      } else {
+        postorder.push_back(b);
+        stack.pop_back();
+      }
+    }
+  }
+
+  // Dense indices in reverse postorder; the root is at index 0.
+  if (m_virtual_root != NONE) {
+    m_blocks.push_back(nullptr);
+  }
+  m_blocks.insert(m_blocks.end(), postorder.rbegin(), postorder.rend());
+  for (uint32_t i = 0; i < m_blocks.size(); ++i) {
+    if (m_blocks[i] != nullptr) {
+      m_id_to_index[m_blocks[i]->id()] = i;
+    }
+  }
+  std::vector<bool> is_root_child(m_blocks.size());
+  if (m_virtual_root != NONE) {
+    for (Block* root : roots) {
+      is_root_child[index(root)] = true;
+    }
+  }
+
+  // Calls `f` on the index of every predecessor of `i` (in the direction of
+  // the tree) that is part of the tree.
+  const auto& for_each_pred = [&](uint32_t i, const auto& f) {
+    if (is_root_child[i]) {
+      f(m_virtual_root);
+    }
+    for (const Edge* e : backward(m_blocks[i])) {
+      auto pred = index(backward_node(e));
+      if (pred != NONE) {
+        f(pred);
+      }
+    }
+  };
+
+  m_idom.assign(m_blocks.size(), NONE);
+  m_idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint32_t i = 1; i < m_blocks.size(); ++i) {
+      uint32_t new_idom = NONE;
+      for_each_pred(i, [&](uint32_t pred) {
+        if (m_idom[pred] == NONE) {
+          // Not processed yet.
+          return;
+        }
+        new_idom = new_idom == NONE ? pred : intersect(pred, new_idom);
+      });
+      always_assert(new_idom != NONE);
+      if (m_idom[i] != new_idom) {
+        m_idom[i] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  // Number the tree in depth first order to answer dominance queries in
+  // constant time.
+  std::vector<std::vector<uint32_t>> children(m_blocks.size());
+  for (uint32_t i = 1; i < m_blocks.size(); ++i) {
+    children[m_idom[i]].push_back(i);
+  }
+  m_pre.assign(m_blocks.size(), 0);
+  m_post_number.assign(m_blocks.size(), 0);
+  uint32_t pre = 0;
+  uint32_t post_number = 0;
+  std::vector<std::pair<uint32_t, size_t>> tree_stack;
+  tree_stack.emplace_back(0, 0);
+  m_pre[0] = pre++;
+  while (!tree_stack.empty()) {
+    uint32_t i = tree_stack.back().first;
+    size_t child_index = tree_stack.back().second++;
+    if (child_index < children[i].size()) {
+      uint32_t child = children[i][child_index];
+      m_pre[child] = pre++;
+      tree_stack.emplace_back(child, 0);
+    } else {
+      m_post_number[i] = post_number++;
+      tree_stack.pop_back();
+    }
+  }
+
+  // Dominance frontiers, from the same paper.
+  m_frontiers.resize(m_blocks.size());
+  for (uint32_t i = 1; i < m_blocks.size(); ++i) {
+    size_t num_preds = 0;
+    for_each_pred(i, [&num_preds](uint32_t) { ++num_preds; });
+    if (num_preds < 2) {
+      continue;
+    }
+    Block* b = m_blocks[i];
+    for_each_pred(i, [&](uint32_t runner) {
+      while (runner != m_idom[i]) {
+        auto& frontier = m_frontiers[runner];
+        if (frontier.empty() || frontier.back() != b) {
+          frontier.push_back(b);
+        }
+        runner = m_idom[runner];
+      }
+    });
+  }
+}
+
+uint32_t DominatorTree::intersect(uint32_t a, uint32_t b) const {
+  // Indices are reverse postorder numbers, so the dominators of a node
+  // always have a smaller index than the node itself.
+  while (a != b) {
+    while (a > b) {
+      a = m_idom[a];
+    }
+    while (b > a) {
+      b = m_idom[b];
+    }
+  }
+  return a;
+}
+
+Block* DominatorTree::idom(const Block* b) const {
+  auto i = index(b);
+  if (i == NONE || i == 0) {
+    return nullptr;
+  }
+  return block_at(m_idom[i]);
+}
+
+bool DominatorTree::dominates(const Block* a, const Block* b) const {
+  auto ia = index(a);
+  auto ib = index(b);
+  if (ia == NONE || ib == NONE) {
+    return false;
+  }
+  return m_pre[ia] <= m_pre[ib] && m_post_number[ib] <= m_post_number[ia];
+}
+
+Block* DominatorTree::common_dominator(const Block* a, const Block* b) const {
+  auto ia = index(a);
+  auto ib = index(b);
+  if (ia == NONE || ib == NONE) {
+    return nullptr;
+  }
+  return block_at(intersect(ia, ib));
+}
+
+const std::vector<Block*>& DominatorTree::frontier(const Block* b) const {
+  static const std::vector<Block*> empty;
+  auto i = index(b);
+  return i == NONE ? empty : m_frontiers[i];
+}
+
+LoopInfo::LoopInfo(const ControlFlowGraph& cfg,
+                   const DominatorTree& dominators) {
+  always_assert(!dominators.is_post_dominator_tree());
+  const auto& all_blocks = cfg.blocks();
+  if (all_blocks.empty()) {
+    return;
+  }
+  auto num_ids = max_block_id(all_blocks) + 1;
+  m_depth.assign(num_ids, 0);
+  m_is_header.assign(num_ids, false);
+
+  // A header dominates the headers of the loops nested in it, so visiting the
+  // headers in reverse postorder finds outer loops first.
+  for (Block* header : dominators.blocks()) {
+    std::vector<Block*> worklist;
+    for (const Edge* e : header->preds()) {
+      if (dominators.dominates(header, e->src())) {
+        worklist.push_back(e->src());
+      }
+    }
+    if (worklist.empty()) {
+      continue;
+    }
+
+    Loop loop{header, {header}, 0};
+    std::vector<bool> in_loop(num_ids);
+    in_loop[header->id()] = true;
+    while (!worklist.empty()) {
+      Block* b = worklist.back();
+      worklist.pop_back();
+      if (in_loop[b->id()]) {
+        continue;
+      }
+      in_loop[b->id()] = true;
+      loop.blocks.push_back(b);
+      for (const Edge* e : b->preds()) {
+        Block* pred = e->src();
+        if (dominators.contains(pred) && !in_loop[pred->id()]) {
+          worklist.push_back(pred);
+        }
+      }
+    }
+
+    for (Block* b : loop.blocks) {
+      ++m_depth[b->id()];
+    }
+    m_is_header[header->id()] = true;
+    loop.depth = m_depth[header->id()];
+    m_loops.push_back(std::move(loop));
+  }
+}
+
+size_t LoopInfo::loop_depth(const Block* b) const {
+  return b->id() < m_depth.size() ? m_depth[b->id()] : 0;
+}
+
+bool LoopInfo::is_loop_header(const Block* b) const {
+  return b->id() < m_is_header.size() && m_is_header[b->id()];
+}
+
+} // namespace cfg
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "ControlFlow.h"
+
+/*
+ * Structural analyses of a ControlFlowGraph: (post-)dominator trees,
+ * dominance frontiers and natural loops.
+ *
+ * They are usually not built directly but obtained through
+ * ControlFlowGraph::get_dominator_tree() and friends, which cache them until
+ * the blocks or edges of the graph change.
+ */
+namespace cfg {
+
+/*
+ * Dominator tree computed with the algorithm from
+ *   K. D. Cooper et.al. A Simple, Fast Dominance Algorithm.
+ *
+ * Blocks are mapped to dense indices (their position in reverse postorder
+ * from the root), and every query is an array lookup.
+ *
+ * When `post` is true, this is the post-dominator tree, rooted at the exit
+ * block of the graph. If the graph has several exit points and no exit block
+ * has been calculated, the tree is rooted at a virtual node that is the
+ * successor of all of them.
+ *
+ * Blocks that are unreachable from the root (e.g. dead code, or infinite
+ * loops in the post-dominator case) are not part of the tree.
+ */
+class DominatorTree {
+ public:
+  DominatorTree(const ControlFlowGraph& cfg, bool post = false);
+
+  bool is_post_dominator_tree() const { return m_post; }
+
+  // Whether the block is part of the tree, i.e. reachable from the root.
+  bool contains(const Block* b) const { return index(b) != NONE; }
+
+  // The immediate (post-)dominator of `b`. This is nullptr for the root, for
+  // blocks dominated only by the virtual root, and for blocks not in the tree.
+  Block* idom(const Block* b) const;
+
+  // Whether `a` (post-)dominates `b`. Every block dominates itself.
+  bool dominates(const Block* a, const Block* b) const;
+
+  // The closest block that (post-)dominates both `a` and `b`, or nullptr if
+  // there is none.
+  Block* common_dominator(const Block* a, const Block* b) const;
+
+  // The (post-)dominance frontier of `b`.
+  const std::vector<Block*>& frontier(const Block* b) const;
+
+  // The blocks of the tree, in reverse postorder from the root. This starts
+  // with nullptr if the tree has a virtual root.
+  const std::vector<Block*>& blocks() const { return m_blocks; }
+
+ private:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  uint32_t index(const Block* b) const {
+    auto id = b->id();
+    return id < m_id_to_index.size() ? m_id_to_index[id] : NONE;
+  }
+  Block* block_at(uint32_t i) const {
+    return i == NONE ? nullptr : m_blocks[i];
+  }
+  uint32_t intersect(uint32_t a, uint32_t b) const;
+
+  bool m_post;
+  // Index of the virtual root in the arrays below, or NONE if the tree has
+  // a real root.
+  uint32_t m_virtual_root{NONE};
+  std::vector<uint32_t> m_id_to_index;
+  // Per index. The root has index 0; a virtual root maps to nullptr in
+  // m_blocks.
+  std::vector<Block*> m_blocks;
+  std::vector<uint32_t> m_idom;
+  std::vector<uint32_t> m_pre;
+  std::vector<uint32_t> m_post_number;
+  std::vector<std::vector<Block*>> m_frontiers;
+};
+
+/*
+ * Natural loops of a graph, found from its back edges (edges whose target
+ * dominates their source). Loops that share a header are merged.
+ */
+class LoopInfo {
+ public:
+  struct Loop {
+    Block* header;
+    // All the blocks of the loop, including the header and the blocks of the
+    // nested loops.
+    std::vector<Block*> blocks;
+    // Number of loops containing this one, counting itself. Outermost loops
+    // have a depth of 1.
+    size_t depth;
+  };
+
+  LoopInfo(const ControlFlowGraph& cfg, const DominatorTree& dominators);
+
+  // The number of loops the block belongs to; 0 if it isn't in a loop.
+  size_t loop_depth(const Block* b) const;
+
+  bool is_loop_header(const Block* b) const;
+
+  // Loops are ordered such that outer loops come before the loops they
+  // contain.
+  const std::vector<Loop>& loops() const { return m_loops; }
+
+ private:
+  std::vector<Loop> m_loops;
+  std::vector<size_t> m_depth;
+  std::vector<bool> m_is_header;
+};
+
+} // namespace cfg
@@ -20,24 +20,48 @@ bool is_own_init(DexField* field, const DexMethod* method) {
 FieldStatsMap analyze(const Scope& scope) {
   FieldStatsMap field_stats;
   // Gather the read/write counts.
-  walk::opcodes(scope, [&](const DexMethod* method, const IRInstruction* insn) {
-    auto op = insn->opcode();
-    if (!insn->has_field()) {
-      return;
-    }
-    auto field = resolve_field(insn->get_field());
+  walk::read_opcodes(
+      scope, [&](const DexMethod* method, const IRInstruction* insn) {
+        auto op = insn->opcode();
+        if (!insn->has_field()) {
+          return;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr) {
+          return;
+        }
+        if (is_sget(op) || is_iget(op)) {
+          ++field_stats[field].reads;
+          if (!is_own_init(field, method)) {
+            ++field_stats[field].reads_outside_init;
+          }
+        } else if (is_sput(op) || is_iput(op)) {
+          ++field_stats[field].writes;
+        }
+      });
+  return field_stats;
+}
+
+FieldStatsMap analyze(const xref::XrefIndex& index) {
+  FieldStatsMap field_stats;
+  for (const auto& pair : index.fields()) {
+    auto field = resolve_field(pair.first);
     if (field == nullptr) {
-      return;
+      continue;
     }
-    if (is_sget(op) || is_iget(op)) {
-      ++field_stats[field].reads;
-      if (!is_own_init(field, method)) {
-        ++field_stats[field].reads_outside_init;
+    auto& stats = field_stats[field];
+    for (const auto& xref : pair.second) {
+      auto op = xref.insn->opcode();
+      if (is_sget(op) || is_iget(op)) {
+        ++stats.reads;
+        if (!is_own_init(field, xref.method)) {
+          ++stats.reads_outside_init;
+        }
+      } else if (is_sput(op) || is_iput(op)) {
+        ++stats.writes;
       }
-    } else if (is_sput(op) || is_iput(op)) {
-      ++field_stats[field].writes;
     }
-  });
+  }
   return field_stats;
 }
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "DexClass.h"
+#include "XrefIndex.h"
 
 #include <unordered_map>
 
@@ -27,4 +28,7 @@ using FieldStatsMap = std::unordered_map<DexField*, FieldStats>;
 
 FieldStatsMap analyze(const Scope& scope);
 
+// Same as above, using the references of an already built index.
+FieldStatsMap analyze(const xref::XrefIndex& index);
+
 }
@@ -596,8 +596,11 @@ void IRCode::clear_cfg() {
   }
 
   if (m_cfg->editable()) {
+    auto epoch = m_ir_list->get_epoch();
     m_registers_size = m_cfg->get_registers_size();
     m_ir_list = m_cfg->linearize();
+    // We can't tell whether the graph was edited, so count it as a change.
+    m_ir_list->set_epoch(epoch + 1);
   }
 
   m_cfg.reset();
@@ -787,6 +790,7 @@ std::unique_ptr<DexCode> IRCode::sync(const DexMethod* method) {
 
 bool IRCode::try_sync(DexCode* code) {
   std::unordered_map<MethodItemEntry*, uint32_t> entry_to_addr;
+  entry_to_addr.reserve(m_ir_list->size());
   uint32_t addr = 0;
   // Step 1, regenerate opcode list for the method, and
   // and calculate the opcode entries address offsets.
@@ -167,6 +167,8 @@ class IRCode {
 
   bool editable_cfg_built() const;
 
+  bool cfg_built() const { return m_cfg != nullptr; }
+
   /* Generate DexCode from IRCode */
   std::unique_ptr<DexCode> sync(const DexMethod*);
 
@@ -270,6 +272,21 @@ class IRCode {
    */
   size_t count_opcodes() const { return m_ir_list->count_opcodes(); }
 
+  /*
+   * Returns the number of entries, i.e. instructions, positions, targets and
+   * so on. Unlike count_opcodes(), it takes constant time.
+   */
+  size_t count_entries() const { return m_ir_list->size(); }
+
+  /*
+   * Changes whenever entries are added to, removed from or replaced in this
+   * code, either through the methods above or by linearizing an editable CFG.
+   * Instructions edited in place (e.g. through IRInstruction::set_src) don't
+   * change it, so it can tell that a method was modified, but not that it
+   * wasn't.
+   */
+  uint64_t get_epoch() const { return m_ir_list->get_epoch(); }
+
   void sanity_check() const { m_ir_list->sanity_check(); }
 
   IRList::iterator begin() { return m_ir_list->begin(); }
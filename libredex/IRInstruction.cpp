@@ -7,6 +7,8 @@
 
 #include "IRInstruction.h"
 
+#include <algorithm>
+
 #include "DexClass.h"
 #include "DexUtil.h"
 
@@ -22,8 +24,88 @@ DexOpcode convert_3to2addr(DexOpcode op) {
   return (DexOpcode)(op + offset);
 }
 
+static_assert(sizeof(void*) != 8 || sizeof(IRInstruction) == 32,
+              "IRInstruction should fit in half a cache line");
+
 IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
-  m_srcs.resize(opcode_impl::min_srcs_size(op));
+  set_arg_word_count(opcode_impl::min_srcs_size(op));
+}
+
+IRInstruction::IRInstruction(const IRInstruction& that)
+    : m_opcode(that.m_opcode), m_dest(that.m_dest), m_literal(that.m_literal) {
+  set_arg_word_count(that.m_num_srcs);
+  std::copy(that.srcs().begin(), that.srcs().end(), srcs_data());
+}
+
+IRInstruction& IRInstruction::operator=(const IRInstruction& that) {
+  if (this != &that) {
+    m_opcode = that.m_opcode;
+    m_dest = that.m_dest;
+    m_literal = that.m_literal;
+    set_arg_word_count(that.m_num_srcs);
+    std::copy(that.srcs().begin(), that.srcs().end(), srcs_data());
+  }
+  return *this;
+}
+
+IRInstruction::IRInstruction(IRInstruction&& that) noexcept
+    : m_opcode(that.m_opcode),
+      m_num_srcs(that.m_num_srcs),
+      m_dest(that.m_dest),
+      m_literal(that.m_literal) {
+  steal_srcs(that);
+}
+
+IRInstruction& IRInstruction::operator=(IRInstruction&& that) noexcept {
+  if (this != &that) {
+    if (!srcs_inline()) {
+      delete[] m_srcs;
+    }
+    m_opcode = that.m_opcode;
+    m_num_srcs = that.m_num_srcs;
+    m_dest = that.m_dest;
+    m_literal = that.m_literal;
+    steal_srcs(that);
+  }
+  return *this;
+}
+
+void IRInstruction::steal_srcs(IRInstruction& that) {
+  if (that.srcs_inline()) {
+    std::copy(that.m_inline_srcs, that.m_inline_srcs + m_num_srcs,
+              m_inline_srcs);
+  } else {
+    m_srcs = that.m_srcs;
+  }
+  that.m_num_srcs = 0;
+}
+
+IRInstruction::~IRInstruction() {
+  if (!srcs_inline()) {
+    delete[] m_srcs;
+  }
+}
+
+IRInstruction* IRInstruction::set_arg_word_count(uint16_t count) {
+  auto kept = std::min(m_num_srcs, count);
+  if (srcs_inline() && count <= kMaxInlineSrcs) {
+    std::fill(m_inline_srcs + kept, m_inline_srcs + count, 0);
+  } else if (count <= kMaxInlineSrcs) {
+    // m_inline_srcs overlaps m_srcs, which we need to hold on to.
+    auto srcs = m_srcs;
+    std::copy(srcs, srcs + kept, m_inline_srcs);
+    delete[] srcs;
+  } else {
+    auto srcs = new uint16_t[count];
+    std::copy(srcs_data(), srcs_data() + kept, srcs);
+    std::fill(srcs + kept, srcs + count, 0);
+    if (!srcs_inline()) {
+      delete[] m_srcs;
+    }
+    m_srcs = srcs;
+  }
+  m_num_srcs = count;
+  return this;
 }
 
 // Structural equality of opcodes except branches offsets are ignored
@@ -31,7 +113,8 @@ IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
 bool IRInstruction::operator==(const IRInstruction& that) const {
   return m_opcode == that.m_opcode &&
     m_string == that.m_string && // just test one member of the union
-    m_srcs == that.m_srcs &&
+    std::equal(srcs().begin(), srcs().end(), that.srcs().begin(),
+               that.srcs().end()) &&
     m_dest == that.m_dest &&
     m_literal == that.m_literal;
 }
@@ -209,7 +292,8 @@ void IRInstruction::denormalize_registers() {
       }
     }
     if (has_wide) {
-      m_srcs = srcs;
+      set_arg_word_count(srcs.size());
+      std::copy(srcs.begin(), srcs.end(), srcs_data());
     }
   }
 }
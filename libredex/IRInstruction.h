@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <boost/range/iterator_range.hpp>
+
 #include "DexInstruction.h"
 #include "Show.h"
 
@@ -108,6 +110,12 @@
 class IRInstruction final {
  public:
   explicit IRInstruction(IROpcode op);
+  IRInstruction(const IRInstruction&);
+  IRInstruction& operator=(const IRInstruction&);
+  // The moved-from instruction is left without srcs.
+  IRInstruction(IRInstruction&&) noexcept;
+  IRInstruction& operator=(IRInstruction&&) noexcept;
+  ~IRInstruction();
 
   /*
    * Ensures that wide registers only have their first register referenced
@@ -151,7 +159,7 @@ class IRInstruction final {
    */
   size_t dests_size() const { return opcode_impl::dests_size(m_opcode); }
 
-  size_t srcs_size() const { return m_srcs.size(); }
+  size_t srcs_size() const { return m_num_srcs; }
 
   bool has_move_result_pseudo() const {
     return opcode_impl::has_move_result_pseudo(m_opcode);
@@ -194,9 +202,14 @@ class IRInstruction final {
     always_assert_log(dests_size(), "No dest for %s", SHOW(m_opcode));
     return m_dest;
   }
-  uint16_t src(size_t i) const { return m_srcs.at(i); }
-  const std::vector<uint16_t>& srcs() const { return m_srcs; }
-  uint16_t arg_word_count() const { return m_srcs.size(); }
+  uint16_t src(size_t i) const {
+    always_assert(i < m_num_srcs);
+    return srcs_data()[i];
+  }
+  boost::iterator_range<const uint16_t*> srcs() const {
+    return boost::make_iterator_range(srcs_data(), srcs_data() + m_num_srcs);
+  }
+  uint16_t arg_word_count() const { return m_num_srcs; }
 
   /*
    * Setters for logical parts of the instruction.
@@ -211,13 +224,13 @@ class IRInstruction final {
     return this;
   }
   IRInstruction* set_src(size_t i, uint16_t vreg) {
-    m_srcs.at(i) = vreg;
-    return this;
-  }
-  IRInstruction* set_arg_word_count(uint16_t count) {
-    m_srcs.resize(count);
+    always_assert(i < m_num_srcs);
+    srcs_data()[i] = vreg;
     return this;
   }
+  // New srcs are set to zero, like the elements that std::vector::resize()
+  // adds.
+  IRInstruction* set_arg_word_count(uint16_t count);
 
   int64_t get_literal() const {
     always_assert(has_literal());
@@ -313,9 +326,26 @@ class IRInstruction final {
   uint64_t hash();
 
  private:
+  // The srcs are stored inline, unless there are more of them than fit. That
+  // only happens to invokes and filled-new-array, which will be lowered to
+  // their range forms.
+  static constexpr size_t kMaxInlineSrcs = 8;
+
+  bool srcs_inline() const { return m_num_srcs <= kMaxInlineSrcs; }
+  // Takes over the srcs of `that`, whose m_num_srcs this already has.
+  void steal_srcs(IRInstruction& that);
+  uint16_t* srcs_data() { return srcs_inline() ? m_inline_srcs : m_srcs; }
+  const uint16_t* srcs_data() const {
+    return srcs_inline() ? m_inline_srcs : m_srcs;
+  }
+
   IROpcode m_opcode;
-  std::vector<uint16_t> m_srcs;
+  uint16_t m_num_srcs{0};
   uint16_t m_dest{0};
+  union {
+    uint16_t m_inline_srcs[kMaxInlineSrcs];
+    uint16_t* m_srcs;
+  };
   union {
     // Zero-initialize this union with the uint64_t member instead of a
     // pointer-type member so that it works properly even on 32-bit machines
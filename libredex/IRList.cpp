@@ -263,6 +263,7 @@ void IRList::replace_opcode(IRInstruction* from, IRInstruction* to) {
 }
 
 void IRList::replace_opcode_with_infinite_loop(IRInstruction* from) {
+  ++m_epoch;
   IRInstruction* to = new IRInstruction(OPCODE_GOTO);
   auto miter = m_list.begin();
   for (; miter != m_list.end(); miter++) {
@@ -286,6 +287,7 @@ void IRList::replace_opcode_with_infinite_loop(IRInstruction* from) {
 }
 
 void IRList::replace_branch(IRInstruction* from, IRInstruction* to) {
+  ++m_epoch;
   always_assert(is_branch(from->opcode()));
   always_assert(is_branch(to->opcode()));
   for (auto& mentry : m_list) {
@@ -304,6 +306,7 @@ void IRList::replace_branch(IRInstruction* from, IRInstruction* to) {
 
 void IRList::insert_after(IRInstruction* position,
                           const std::vector<IRInstruction*>& opcodes) {
+  ++m_epoch;
   /* The nullptr case handling is strange-ish..., this will not work as expected
    * if a method has a branch target as it's first instruction.
    *
@@ -332,17 +335,20 @@ void IRList::insert_after(IRInstruction* position,
 
 IRList::iterator IRList::insert_before(
     const IRList::iterator& position, MethodItemEntry& mie) {
+  ++m_epoch;
   return m_list.insert(position, mie);
 }
 
 IRList::iterator IRList::insert_after(
     const IRList::iterator& position, MethodItemEntry& mie) {
   always_assert(position != m_list.end());
+  ++m_epoch;
   return m_list.insert(std::next(position), mie);
 }
 
 void IRList::remove_opcode(const IRList::iterator& it) {
   always_assert(it->type == MFLOW_OPCODE);
+  ++m_epoch;
   auto insn = it->insn;
   always_assert(!opcode::is_move_result_pseudo(insn->opcode()));
   if (insn->has_move_result_pseudo()) {
@@ -583,6 +589,7 @@ IRList::iterator IRList::make_if_block(
     IRList::iterator cur,
     IRInstruction* insn,
     IRList::iterator* false_block) {
+  ++m_epoch;
   auto if_entry = new MethodItemEntry(insn);
   *false_block = m_list.insert(cur, *if_entry);
   auto bt = new BranchTarget(if_entry);
@@ -595,6 +602,7 @@ IRList::iterator IRList::make_if_else_block(
     IRInstruction* insn,
     IRList::iterator* false_block,
     IRList::iterator* true_block) {
+  ++m_epoch;
   // if block
   auto if_entry = new MethodItemEntry(insn);
   *false_block = m_list.insert(cur, *if_entry);
@@ -621,6 +629,7 @@ IRList::iterator IRList::make_switch_block(
     IRInstruction* insn,
     IRList::iterator* default_block,
     std::map<SwitchIndices, IRList::iterator>& cases) {
+  ++m_epoch;
   auto switch_entry = new MethodItemEntry(insn);
   *default_block = m_list.insert(cur, *switch_entry);
   IRList::iterator main_block = *default_block;
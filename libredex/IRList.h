@@ -202,6 +202,7 @@ class IRList {
       boost::intrusive::list<MethodItemEntry, MethodItemMemberListOption>;
 
   IntrusiveList m_list;
+  uint64_t m_epoch{0};
   void remove_branch_targets(IRInstruction* branch_inst);
 
   static void disposer(MethodItemEntry* mie) {
@@ -232,6 +233,14 @@ class IRList {
   size_t size() const { return m_list.size(); }
   bool empty() const { return m_list.empty(); }
 
+  /*
+   * Modification counter, bumped by every method of this class that adds,
+   * removes or replaces entries. Changes made in place through an iterator or
+   * directly to an IRInstruction are not counted.
+   */
+  uint64_t get_epoch() const { return m_epoch; }
+  void set_epoch(uint64_t epoch) { m_epoch = epoch; }
+
   /* Passes memory ownership of "from" to callee.  It will delete it. */
   void replace_opcode(IRInstruction* from, IRInstruction* to);
 
@@ -260,10 +269,16 @@ class IRList {
       const InstructionEquality& instruction_equals) const;
 
   /* Passes memory ownership of "mie" to callee. */
-  void push_back(MethodItemEntry& mie) { m_list.push_back(mie); }
+  void push_back(MethodItemEntry& mie) {
+    ++m_epoch;
+    m_list.push_back(mie);
+  }
 
   /* Passes memory ownership of "mie" to callee. */
-  void push_front(MethodItemEntry& mie) { m_list.push_front(mie); }
+  void push_front(MethodItemEntry& mie) {
+    ++m_epoch;
+    m_list.push_front(mie);
+  }
 
   /*
    * Insert after instruction :position.
@@ -325,6 +340,8 @@ class IRList {
   // transfer all of `other` into `this` starting at `pos`
   // memory ownership is also transferred
   void splice(IRList::const_iterator pos, IRList& other) {
+    ++m_epoch;
+    ++other.m_epoch;
     m_list.splice(pos, other.m_list);
   }
 
@@ -334,11 +351,14 @@ class IRList {
                         IRList& other,
                         IRList::const_iterator begin,
                         IRList::const_iterator end) {
+    ++m_epoch;
+    ++other.m_epoch;
     m_list.splice(pos, other.m_list, begin, end);
   }
 
   template<typename Predicate>
   void remove_and_dispose_if(Predicate predicate) {
+    ++m_epoch;
     m_list.remove_and_dispose_if(predicate, disposer);
   }
 
@@ -361,11 +381,18 @@ class IRList {
   void gather_fields(std::vector<DexFieldRef*>& lfield) const;
   void gather_methods(std::vector<DexMethodRef*>& lmethod) const;
 
-  IRList::iterator erase(IRList::iterator it) { return m_list.erase(it); }
+  IRList::iterator erase(IRList::iterator it) {
+    ++m_epoch;
+    return m_list.erase(it);
+  }
   IRList::iterator erase_and_dispose(IRList::iterator it) {
+    ++m_epoch;
     return m_list.erase_and_dispose(it, disposer);
   }
-  void clear_and_dispose() { m_list.clear_and_dispose(disposer); }
+  void clear_and_dispose() {
+    ++m_epoch;
+    m_list.clear_and_dispose(disposer);
+  }
 
   IRList::iterator iterator_to(MethodItemEntry& mie) {
     return m_list.iterator_to(mie);
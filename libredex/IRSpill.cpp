@@ -0,0 +1,493 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRSpill.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+#include "Debug.h"
+#include "DexDebugInstruction.h"
+#include "DexEncoding.h"
+#include "DexPosition.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+constexpr uint32_t kNoEntry = 0xffffffff;
+
+class Writer {
+ public:
+  explicit Writer(std::string* out) : m_out(out) {}
+
+  void uleb(uint32_t v) {
+    uint8_t buf[5];
+    auto end = write_uleb128(buf, v);
+    m_out->append(reinterpret_cast<const char*>(buf), end - buf);
+  }
+
+  // Indices are biased by one so that kNoEntry encodes in a single byte.
+  void index(uint32_t v) { uleb(v + 1); }
+
+  template <typename T>
+  void raw(T v) {
+    m_out->append(reinterpret_cast<const char*>(&v), sizeof(T));
+  }
+
+  template <typename T>
+  void ptr(T* p) {
+    raw(reinterpret_cast<uintptr_t>(p));
+  }
+
+ private:
+  std::string* m_out;
+};
+
+class Reader {
+ public:
+  Reader(const char* data, size_t size)
+      : m_ptr(reinterpret_cast<const uint8_t*>(data)), m_end(m_ptr + size) {}
+
+  uint32_t uleb() {
+    auto v = read_uleb128(&m_ptr);
+    always_assert(m_ptr <= m_end);
+    return v;
+  }
+
+  uint32_t index() { return uleb() - 1; }
+
+  template <typename T>
+  T raw() {
+    always_assert(m_ptr + sizeof(T) <= m_end);
+    T v;
+    memcpy(&v, m_ptr, sizeof(T));
+    m_ptr += sizeof(T);
+    return v;
+  }
+
+  template <typename T>
+  T* ptr() {
+    return reinterpret_cast<T*>(raw<uintptr_t>());
+  }
+
+  bool done() const { return m_ptr == m_end; }
+
+ private:
+  const uint8_t* m_ptr;
+  const uint8_t* m_end;
+};
+
+void serialize_insn(const IRInstruction* insn, Writer* w) {
+  w->uleb(insn->opcode());
+  if (insn->dests_size()) {
+    w->uleb(insn->dest());
+  }
+  w->uleb(insn->srcs_size());
+  for (auto src : insn->srcs()) {
+    w->uleb(src);
+  }
+  if (insn->has_literal()) {
+    w->raw(insn->get_literal());
+  } else if (insn->has_string()) {
+    w->ptr(insn->get_string());
+  } else if (insn->has_type()) {
+    w->ptr(insn->get_type());
+  } else if (insn->has_field()) {
+    w->ptr(insn->get_field());
+  } else if (insn->has_method()) {
+    w->ptr(insn->get_method());
+  } else if (insn->has_data()) {
+    auto data = insn->get_data();
+    w->uleb(data->opcode());
+    w->uleb(data->data_size());
+    for (size_t i = 0; i < data->data_size(); ++i) {
+      w->uleb(data->data()[i]);
+    }
+  }
+}
+
+IRInstruction* deserialize_insn(Reader* r) {
+  auto insn = new IRInstruction(static_cast<IROpcode>(r->uleb()));
+  if (insn->dests_size()) {
+    insn->set_dest(r->uleb());
+  }
+  insn->set_arg_word_count(r->uleb());
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    insn->set_src(i, r->uleb());
+  }
+  if (insn->has_literal()) {
+    insn->set_literal(r->raw<int64_t>());
+  } else if (insn->has_string()) {
+    insn->set_string(r->ptr<DexString>());
+  } else if (insn->has_type()) {
+    insn->set_type(r->ptr<DexType>());
+  } else if (insn->has_field()) {
+    insn->set_field(r->ptr<DexFieldRef>());
+  } else if (insn->has_method()) {
+    insn->set_method(r->ptr<DexMethodRef>());
+  } else if (insn->has_data()) {
+    // DexOpcodeData expects the payload to follow its pseudo-opcode.
+    std::vector<uint16_t> payload;
+    payload.push_back(r->uleb());
+    auto count = r->uleb();
+    for (size_t i = 0; i < count; ++i) {
+      payload.push_back(r->uleb());
+    }
+    insn->set_data(new DexOpcodeData(payload.data(), count));
+  }
+  return insn;
+}
+
+void serialize_dbgop(const DexDebugInstruction* dbgop, Writer* w) {
+  w->uleb(dbgop->opcode());
+  switch (dbgop->opcode()) {
+  case DBG_SET_FILE:
+    w->ptr(static_cast<const DexDebugOpcodeSetFile*>(dbgop)->file());
+    break;
+  case DBG_START_LOCAL:
+  case DBG_START_LOCAL_EXTENDED: {
+    auto start = static_cast<const DexDebugOpcodeStartLocal*>(dbgop);
+    w->uleb(start->uvalue());
+    w->ptr(start->name());
+    w->ptr(start->type());
+    w->ptr(start->sig());
+    break;
+  }
+  default:
+    w->raw(dbgop->uvalue());
+    break;
+  }
+}
+
+std::unique_ptr<DexDebugInstruction> deserialize_dbgop(Reader* r) {
+  DexDebugItemOpcode op = r->uleb();
+  switch (op) {
+  case DBG_SET_FILE:
+    return std::make_unique<DexDebugOpcodeSetFile>(r->ptr<DexString>());
+  case DBG_START_LOCAL:
+  case DBG_START_LOCAL_EXTENDED: {
+    auto rnum = r->uleb();
+    auto name = r->ptr<DexString>();
+    auto type = r->ptr<DexType>();
+    auto sig = r->ptr<DexString>();
+    return std::make_unique<DexDebugOpcodeStartLocal>(rnum, name, type, sig);
+  }
+  case DBG_ADVANCE_LINE:
+    // The only signed operand, see DexDebugInstruction::make_instruction.
+    return std::make_unique<DexDebugInstruction>(op, r->raw<int32_t>());
+  default:
+    return std::make_unique<DexDebugInstruction>(op, r->raw<uint32_t>());
+  }
+}
+
+} // namespace
+
+namespace ir_spill {
+
+bool serialize(const IRCode& code, std::string* out) {
+  auto dbg = code.get_debug_item();
+  if (code.cfg_built() ||
+      (dbg != nullptr &&
+       !const_cast<DexDebugItem*>(dbg)->get_entries().empty())) {
+    return false;
+  }
+
+  std::unordered_map<const MethodItemEntry*, uint32_t> entry_index;
+  std::unordered_map<const DexPosition*, uint32_t> position_index;
+  for (const auto& mie : code) {
+    if (mie.type == MFLOW_DEX_OPCODE) {
+      return false;
+    }
+    if (mie.type == MFLOW_POSITION) {
+      position_index.emplace(mie.pos.get(), entry_index.size());
+    }
+    entry_index.emplace(&mie, entry_index.size());
+  }
+  auto index_of = [&](const MethodItemEntry* mie) {
+    return mie == nullptr ? kNoEntry : entry_index.at(mie);
+  };
+
+  Writer w(out);
+  w.uleb(code.get_registers_size());
+  w.uleb(dbg != nullptr);
+  if (dbg != nullptr) {
+    auto& names = const_cast<DexDebugItem*>(dbg)->get_param_names();
+    w.uleb(names.size());
+    for (auto name : names) {
+      w.ptr(name);
+    }
+  }
+  w.uleb(entry_index.size());
+  for (const auto& mie : code) {
+    w.uleb(mie.type);
+    switch (mie.type) {
+    case MFLOW_TRY:
+      w.uleb(mie.tentry->type);
+      w.index(index_of(mie.tentry->catch_start));
+      break;
+    case MFLOW_CATCH:
+      w.ptr(mie.centry->catch_type);
+      w.index(index_of(mie.centry->next));
+      break;
+    case MFLOW_OPCODE:
+      serialize_insn(mie.insn, &w);
+      break;
+    case MFLOW_TARGET:
+      w.uleb(mie.target->type);
+      w.index(index_of(mie.target->src));
+      if (mie.target->type == BRANCH_MULTI) {
+        w.raw(mie.target->case_key);
+      }
+      break;
+    case MFLOW_DEBUG:
+      serialize_dbgop(mie.dbgop.get(), &w);
+      break;
+    case MFLOW_POSITION: {
+      auto pos = mie.pos.get();
+      uint32_t parent = kNoEntry;
+      if (pos->parent != nullptr) {
+        auto it = position_index.find(pos->parent);
+        if (it == position_index.end()) {
+          // The parent lives in another method, which we can't refer to.
+          return false;
+        }
+        parent = it->second;
+      }
+      w.ptr(pos->method);
+      w.ptr(pos->file);
+      w.uleb(pos->line);
+      w.index(parent);
+      break;
+    }
+    case MFLOW_DEX_OPCODE:
+      not_reached();
+    case MFLOW_FALLTHROUGH:
+      break;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<IRCode> deserialize(const char* data, size_t size) {
+  Reader r(data, size);
+  auto code = std::make_unique<IRCode>();
+  code->set_registers_size(r.uleb());
+  if (r.uleb()) {
+    auto dbg = std::make_unique<DexDebugItem>();
+    auto& names = dbg->get_param_names();
+    names.resize(r.uleb());
+    for (auto& name : names) {
+      name = r.ptr<DexString>();
+    }
+    code->set_debug_item(std::move(dbg));
+  }
+
+  // Entries may refer to later ones, so the references are patched once all
+  // the entries exist. TryEntry doesn't accept a null catch_start, even
+  // temporarily, hence the placeholder.
+  MethodItemEntry placeholder;
+  std::vector<MethodItemEntry*> entries(r.uleb());
+  std::vector<std::pair<MethodItemEntry**, uint32_t>> entry_fixups;
+  std::vector<std::pair<DexPosition**, uint32_t>> position_fixups;
+  for (auto& mie : entries) {
+    auto type = static_cast<MethodItemType>(r.uleb());
+    switch (type) {
+    case MFLOW_TRY: {
+      auto try_type = static_cast<TryEntryType>(r.uleb());
+      mie = new MethodItemEntry(try_type, &placeholder);
+      entry_fixups.emplace_back(&mie->tentry->catch_start, r.index());
+      break;
+    }
+    case MFLOW_CATCH:
+      mie = new MethodItemEntry(r.ptr<DexType>());
+      entry_fixups.emplace_back(&mie->centry->next, r.index());
+      break;
+    case MFLOW_OPCODE:
+      mie = new MethodItemEntry(deserialize_insn(&r));
+      break;
+    case MFLOW_TARGET: {
+      auto target = new BranchTarget();
+      target->type = static_cast<BranchTargetType>(r.uleb());
+      entry_fixups.emplace_back(&target->src, r.index());
+      if (target->type == BRANCH_MULTI) {
+        target->case_key = r.raw<int32_t>();
+      }
+      mie = new MethodItemEntry(target);
+      break;
+    }
+    case MFLOW_DEBUG:
+      mie = new MethodItemEntry(deserialize_dbgop(&r));
+      break;
+    case MFLOW_POSITION: {
+      auto method = r.ptr<DexMethod>();
+      auto file = r.ptr<DexString>();
+      auto pos = std::make_unique<DexPosition>(r.uleb());
+      pos->method = method;
+      pos->file = file;
+      pos->parent = nullptr;
+      position_fixups.emplace_back(&pos->parent, r.index());
+      mie = new MethodItemEntry(std::move(pos));
+      break;
+    }
+    case MFLOW_DEX_OPCODE:
+      not_reached();
+    case MFLOW_FALLTHROUGH:
+      mie = new MethodItemEntry();
+      break;
+    }
+    code->push_back(*mie);
+  }
+  always_assert(r.done());
+  for (auto& fixup : entry_fixups) {
+    *fixup.first = fixup.second == kNoEntry ? nullptr : entries[fixup.second];
+  }
+  for (auto& fixup : position_fixups) {
+    *fixup.first =
+        fixup.second == kNoEntry ? nullptr : entries[fixup.second]->pos.get();
+  }
+  return code;
+}
+
+IRSpill* IRSpill::s_instance = nullptr;
+
+IRSpill::IRSpill(const std::string& path) : m_path(path) {
+  always_assert_log(s_instance == nullptr, "There is already an IR spill");
+  m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  always_assert_log(m_fd >= 0, "Can't create the IR spill file %s: %s",
+                    path.c_str(), strerror(errno));
+  s_instance = this;
+}
+
+IRSpill::~IRSpill() {
+  s_instance = nullptr;
+  close(m_fd);
+  unlink(m_path.c_str());
+}
+
+bool IRSpill::evict(DexMethod* method) {
+  std::string buffer;
+  if (!serialize(*method->m_code, &buffer)) {
+    return false;
+  }
+  auto offset = m_file_size.fetch_add(buffer.size());
+  auto written = pwrite(m_fd, buffer.data(), buffer.size(), offset);
+  always_assert_log(written == static_cast<ssize_t>(buffer.size()),
+                    "Can't write to the IR spill file %s: %s", m_path.c_str(),
+                    strerror(errno));
+  m_records.insert_or_assign(std::make_pair(
+      method, Record{offset, static_cast<uint32_t>(buffer.size())}));
+  release(method);
+  return true;
+}
+
+void IRSpill::release(DexMethod* method) {
+  // Nothing else owns the instructions of a method.
+  for (auto& mie : *method->m_code) {
+    if (mie.type == MFLOW_OPCODE) {
+      if (mie.insn->has_data()) {
+        delete mie.insn->get_data();
+      }
+      delete mie.insn;
+    }
+  }
+  method->m_code.reset();
+  method->m_code_spilled.store(true, std::memory_order_release);
+}
+
+namespace {
+
+bool has_position_in(const IRCode& code,
+                     const ConcurrentSet<const DexPosition*>& positions) {
+  for (const auto& mie : code) {
+    if (mie.type == MFLOW_POSITION && positions.count(mie.pos.get())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+size_t IRSpill::sweep(const Scope& scope, bool evict) {
+  // The positions that are parents of positions in other methods, e.g. call
+  // sites whose inlined code was copied elsewhere. Evicting their method would
+  // leave those parent pointers dangling; serialize() already refuses the
+  // other side of such a reference.
+  ConcurrentSet<const DexPosition*> inbound_parents;
+  if (evict) {
+    walk::parallel::methods(scope, [&](DexMethod* method) {
+      if (method->m_code == nullptr) {
+        return;
+      }
+      std::unordered_set<const DexPosition*> own;
+      std::vector<const DexPosition*> parents;
+      for (const auto& mie : *method->m_code) {
+        if (mie.type == MFLOW_POSITION) {
+          own.insert(mie.pos.get());
+          if (mie.pos->parent != nullptr) {
+            parents.push_back(mie.pos->parent);
+          }
+        }
+      }
+      for (auto parent : parents) {
+        if (!own.count(parent)) {
+          inbound_parents.insert(parent);
+        }
+      }
+    });
+  }
+  std::atomic<size_t> evicted{0};
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    // Reading the flags directly, as get_code() would touch the code.
+    bool touched = method->m_code_touched.exchange(false);
+    if (evict && !touched && method->m_code != nullptr &&
+        !has_position_in(*method->m_code, inbound_parents) &&
+        this->evict(method)) {
+      ++evicted;
+    }
+  });
+  return evicted;
+}
+
+void IRSpill::restore(const DexMethod* method) {
+  std::lock_guard<std::mutex> lock(
+      m_locks[std::hash<const DexMethod*>()(method) % m_locks.size()]);
+  if (!method->m_code_spilled.load(std::memory_order_acquire)) {
+    // Another thread got there first.
+    return;
+  }
+  auto record = m_records.at(method);
+  std::string buffer(record.size, '\0');
+  auto read = pread(m_fd, &buffer[0], record.size, record.offset);
+  always_assert_log(read == static_cast<ssize_t>(record.size),
+                    "Can't read from the IR spill file %s: %s", m_path.c_str(),
+                    strerror(errno));
+  method->m_code = deserialize(buffer.data(), buffer.size());
+  method->m_code_spilled.store(false, std::memory_order_release);
+  ++m_restored;
+}
+
+void IRSpill::restore_all() {
+  auto wq = workqueue_foreach<const DexMethod*>(
+      [this](const DexMethod* method) { restore(method); });
+  for (const auto& pair : m_records) {
+    if (pair.first->m_code_spilled) {
+      wq.add_item(pair.first);
+    }
+  }
+  wq.run_all();
+}
+
+} // namespace ir_spill
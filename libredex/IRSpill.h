@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ConcurrentContainers.h"
+#include "DexClass.h"
+
+class IRCode;
+
+/*
+ * Moves the IR of methods that the passes aren't working on to a file, to
+ * keep the whole pipeline within a memory budget on very large apps.
+ *
+ * DexCode can't hold the IR before register allocation (wide temporaries,
+ * pseudo-opcodes, unlowered branches), so evicted code is written in an
+ * encoding of its own. Like the IRMetaIO files, it refers to strings, types,
+ * fields and methods directly, which is enough since the spill never outlives
+ * the process. Branches, try regions and parent positions refer to other
+ * entries of the same method by index.
+ */
+namespace ir_spill {
+
+/*
+ * Encodes `code` into `out`. Returns false if the code can't be evicted,
+ * e.g. because it was already lowered to dex instructions.
+ */
+bool serialize(const IRCode& code, std::string* out);
+
+std::unique_ptr<IRCode> deserialize(const char* data, size_t size);
+
+class IRSpill {
+ public:
+  /*
+   * Creates the spill file at `path`. There can only be one IRSpill at a
+   * time, which DexMethod::get_code() restores evicted code from.
+   */
+  explicit IRSpill(const std::string& path);
+
+  /*
+   * Removes the spill file. Code that is still evicted is lost, since the
+   * methods it belongs to may already be gone: call restore_all() first if
+   * they are still needed.
+   */
+  ~IRSpill();
+
+  static IRSpill* get() { return s_instance; }
+
+  /*
+   * If `evict` is set, evicts the code of the methods in `scope` that nobody
+   * asked for since the previous sweep. Their IRInstructions are freed too,
+   * so nothing may keep pointers to them across sweeps. Methods whose
+   * positions are parents of positions in other methods, or the other way
+   * around, are kept. The code of `scope` must not be accessed concurrently.
+   * Returns the number of evicted methods.
+   */
+  size_t sweep(const Scope& scope, bool evict);
+
+  void restore(const DexMethod* method);
+
+  void restore_all();
+
+  /*
+   * Calls `f` with the code of `method` without counting it as a use of the
+   * code, and evicts it again afterwards if it was evicted. `f` must not
+   * change the code.
+   */
+  template <typename F>
+  void peek(DexMethod* method, const F& f) {
+    if (m_shared) {
+      f(method->get_code());
+      return;
+    }
+    bool touched = method->m_code_touched.load();
+    bool spilled = method->m_code_spilled.load();
+    f(method->get_code());
+    if (spilled) {
+      release(method);
+    }
+    method->m_code_touched = touched;
+  }
+
+  /*
+   * While the code may be read by several walks at once, peek() leaves what
+   * it restores in memory, since another walk may still be reading it.
+   */
+  void set_shared(bool shared) { m_shared = shared; }
+
+  size_t restored_count() const { return m_restored; }
+
+  // The size of the spill file, including the space of restored code.
+  size_t file_size() const { return m_file_size; }
+
+ private:
+  bool evict(DexMethod* method);
+
+  // Drops restored code that is still the same as its encoding in the spill.
+  void release(DexMethod* method);
+
+  struct Record {
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  static IRSpill* s_instance;
+
+  std::string m_path;
+  int m_fd;
+  std::atomic<uint64_t> m_file_size{0};
+  std::atomic<size_t> m_restored{0};
+  bool m_shared{false};
+  ConcurrentMap<const DexMethod*, Record> m_records;
+  // Serializes concurrent restores of the same method.
+  std::array<std::mutex, 64> m_locks;
+};
+
+} // namespace ir_spill
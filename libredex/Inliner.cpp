@@ -189,6 +189,19 @@ MultiMethodInliner::MultiMethodInliner(
                     }
                   }
                 });
+
+  if (m_config.method_to_weight != nullptr) {
+    for (const auto& it : caller_callee) {
+      auto caller = it.first;
+      const auto& deobfname = caller->get_fully_deobfuscated_name();
+      auto weight_it = m_config.method_to_weight->find(deobfname);
+      if (weight_it != m_config.method_to_weight->end()) {
+        m_caller_weights.emplace(caller, weight_it->second);
+      }
+    }
+    TRACE(MMINL, 2, "%ld callers out of %ld have profile weights\n",
+          m_caller_weights.size(), caller_callee.size());
+  }
 }
 
 void MultiMethodInliner::inline_methods() {
@@ -237,6 +250,8 @@ void MultiMethodInliner::caller_inline(
 
     if (should_inline(caller, callee)) {
       nonrecursive_callees.push_back(callee);
+    } else if (too_large_for_cold_caller(caller, callee)) {
+      info.cold_caller++;
     }
   }
   inline_callees(caller, nonrecursive_callees);
@@ -356,6 +371,9 @@ void MultiMethodInliner::inline_inlinables(
           SHOW(callee));
     change_visibility(callee_method);
     info.calls_inlined++;
+    if (is_hot_caller(caller_method)) {
+      info.hot_inlined++;
+    }
     inlined.insert(callee_method);
   }
 
@@ -485,6 +503,13 @@ bool MultiMethodInliner::should_inline(const DexMethod* caller,
   if (has_any_annotation(callee, m_config.force_inline)) {
     return true;
   }
+  if (is_hot_caller(caller) && fits_hot_budget(callee)) {
+    return true;
+  }
+  if (too_large_for_cold_caller(caller, callee)) {
+    log_nopt(INL_COLD_CALLER, callee);
+    return false;
+  }
   if (too_many_callers(callee)) {
     log_nopt(INL_TOO_MANY_CALLERS, callee);
     return false;
@@ -492,6 +517,24 @@ bool MultiMethodInliner::should_inline(const DexMethod* caller,
   return true;
 }
 
+bool MultiMethodInliner::is_hot_caller(const DexMethod* caller) const {
+  auto it = m_caller_weights.find(caller);
+  return it != m_caller_weights.end() &&
+         it->second >= m_config.hot_caller_weight;
+}
+
+bool MultiMethodInliner::too_large_for_cold_caller(
+    const DexMethod* caller, const DexMethod* callee) const {
+  auto it = m_caller_weights.find(caller);
+  if (it == m_caller_weights.end() ||
+      it->second >= m_config.cold_caller_weight) {
+    return false;
+  }
+  // Inlining a callee with a single caller removes the callee altogether,
+  // so it is worth doing even in cold code.
+  return callee_caller.at(callee).size() > 1 || !can_delete(callee);
+}
+
 /*
  * Ignore internal opcodes because they do not take up any space in the final
  * dex file. Ignore move opcodes with the hope that RegAlloc will eliminate
@@ -513,10 +556,7 @@ bool MultiMethodInliner::too_many_callers(const DexMethod* callee) const {
   auto caller_count = callee_caller.at(callee).size();
   always_assert(caller_count > 0);
 
-  if (!m_opcode_counts.count(callee)) {
-    m_opcode_counts[callee] = count_important_opcodes(callee->get_code());
-  }
-  auto code_size = m_opcode_counts.at(callee);
+  auto code_size = get_callee_size(callee);
 
   if (!can_delete(callee)) {
     if (m_config.inline_small_non_deletables) {
@@ -542,6 +582,20 @@ bool MultiMethodInliner::too_many_callers(const DexMethod* callee) const {
   return code_size > CODE_SIZE_ANY_CALLERS;
 }
 
+size_t MultiMethodInliner::get_callee_size(const DexMethod* callee) const {
+  auto it = m_opcode_counts.find(callee);
+  if (it != m_opcode_counts.end()) {
+    return it->second;
+  }
+  auto code_size = count_important_opcodes(callee->get_code());
+  m_opcode_counts.emplace(callee, code_size);
+  return code_size;
+}
+
+bool MultiMethodInliner::fits_hot_budget(const DexMethod* callee) const {
+  return get_callee_size(callee) <= m_config.hot_callee_max_size;
+}
+
 bool MultiMethodInliner::caller_is_blacklisted(const DexMethod* caller) {
   auto cls = caller->get_class();
   if (m_config.caller_black_list.count(cls)) {
@@ -79,6 +79,20 @@ class MultiMethodInliner {
     std::unordered_set<DexType*> whitelist_no_method_limit;
     std::unordered_set<DexType*> no_inline;
     std::unordered_set<DexType*> force_inline;
+    // Optional method profile (deobfuscated name -> weight, as loaded by
+    // ConfigFiles::get_method_to_weight). When set, inlining is driven by
+    // the caller's hotness: hot callers get a larger callee size budget and
+    // cold callers only receive inlines that do not grow the code.
+    const std::unordered_map<std::string, unsigned int>* method_to_weight{
+        nullptr};
+    // Callers with a weight at or above this are considered hot.
+    size_t hot_caller_weight{50};
+    // Callers with a weight below this are considered cold. Callers that
+    // aren't in the profile are neither hot nor cold.
+    size_t cold_caller_weight{1};
+    // Max number of important opcodes of a callee inlined into a hot caller
+    // regardless of its number of callers.
+    size_t hot_callee_max_size{24};
   };
 
   MultiMethodInliner(
@@ -243,6 +257,31 @@ class MultiMethodInliner {
    */
   bool too_many_callers(const DexMethod* callee) const;
 
+  /**
+   * Profile-guided counterpart of too_many_callers. Return true if the callee
+   * fits in the extra size budget we grant to callsites in hot callers.
+   */
+  bool fits_hot_budget(const DexMethod* callee) const;
+
+  /**
+   * Return true if the caller is in the method profile with a weight of at
+   * least hot_caller_weight.
+   */
+  bool is_hot_caller(const DexMethod* caller) const;
+
+  /**
+   * Return true if the caller is in the method profile with a weight below
+   * cold_caller_weight, and inlining the callee would not let us delete it.
+   */
+  bool too_large_for_cold_caller(const DexMethod* caller,
+                                 const DexMethod* callee) const;
+
+  /**
+   * Return the number of opcodes of the callee that take up space in the
+   * final dex, caching the result.
+   */
+  size_t get_callee_size(const DexMethod* callee) const;
+
   /**
    * Staticize required methods (stored in `m_make_static`) and update
    * opcodes accordingly.
@@ -278,6 +317,9 @@ class MultiMethodInliner {
   std::map<DexMethod*, std::vector<DexMethod*>, dexmethods_comparator>
       caller_callee;
 
+  // Profiled weight of each caller that appears in the method profile.
+  std::unordered_map<const DexMethod*, unsigned int> m_caller_weights;
+
   // Cache of the opcode counts of each method after all its eligible callsites
   // have been inlined.
   mutable std::unordered_map<const DexMethod*, size_t> m_opcode_counts;
@@ -303,6 +345,8 @@ class MultiMethodInliner {
     size_t non_pub_ctor{0};
     size_t cross_store{0};
     size_t caller_too_large{0};
+    size_t hot_inlined{0};
+    size_t cold_caller{0};
   };
   InliningInfo info;
 
@@ -6,6 +6,9 @@
  */
 
 #include "InstructionLowering.h"
+
+#include <mutex>
+
 #include "Walkers.h"
 
 #include "boost/algorithm/string/join.hpp"
@@ -409,7 +412,9 @@ static void lower_simple_instruction(DexMethod*,
   }
 }
 
-Stats lower(DexMethod* method, bool lower_with_cfg) {
+Stats lower(DexMethod* method,
+            bool lower_with_cfg,
+            const BlockProfile* block_profile) {
   Stats stats;
   auto* code = method->get_code();
   always_assert(code != nullptr);
@@ -417,8 +422,14 @@ Stats lower(DexMethod* method, bool lower_with_cfg) {
   // There's a bug in dex2oat (version 6.0.0_r1) that generates bogus machine
   // code when there is an empty block (a block with only a goto in it). To
   // avoid this bug, we use the CFG to remove empty blocks.
-  if (lower_with_cfg) {
+  bool profiled =
+      block_profile != nullptr && block_profile->has_counts(method);
+  if (lower_with_cfg || profiled) {
     code->build_cfg(/* editable */ true);
+    if (profiled) {
+      code->cfg().set_block_counts(
+          block_profile->block_counts(method, code->cfg()));
+    }
     code->clear_cfg();
   }
 
@@ -454,22 +465,21 @@ Stats lower(DexMethod* method, bool lower_with_cfg) {
   return stats;
 }
 
-Stats run(DexStoresVector& stores, bool lower_with_cfg) {
+Stats run(DexStoresVector& stores,
+          bool lower_with_cfg,
+          const BlockProfile* block_profile) {
   auto scope = build_class_scope(stores);
-  return walk::parallel::reduce_methods<Stats>(
-      scope,
-      [lower_with_cfg](DexMethod* m) {
-        Stats stats;
-        if (m->get_code() == nullptr) {
-          return stats;
-        }
-        stats.accumulate(lower(m, lower_with_cfg));
-        return stats;
-      },
-      [](Stats a, Stats b) {
-        a.accumulate(b);
-        return a;
+  // Lowering time grows with the size of the method, and a few generated
+  // methods can take as long as whole packages, so we start with those.
+  Stats stats;
+  std::mutex stats_mutex;
+  walk::parallel::code_by_size(
+      scope, [&](DexMethod* m, IRCode&) {
+        auto method_stats = lower(m, lower_with_cfg, block_profile);
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.accumulate(method_stats);
       });
+  return stats;
 }
 
 } // namespace instruction_lowering
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "BlockProfile.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "Pass.h"
@@ -32,9 +33,18 @@ struct Stats {
  *   - Record the number of instructions converted to /2ddr form, also the
  *     number of move instruction inserted because of check-cast.
  */
-Stats lower(DexMethod*, bool lower_with_cfg = false);
+Stats lower(DexMethod*,
+            bool lower_with_cfg = false,
+            const BlockProfile* block_profile = nullptr);
 
-Stats run(DexStoresVector&, bool lower_with_cfg = false);
+/*
+ * Methods that `block_profile` has counts for are laid out through the
+ * editable CFG with their hot path as fallthrough code, regardless of
+ * `lower_with_cfg`.
+ */
+Stats run(DexStoresVector&,
+          bool lower_with_cfg = false,
+          const BlockProfile* block_profile = nullptr);
 
 namespace impl {
 
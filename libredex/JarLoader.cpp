@@ -5,11 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
-#include <boost/iostreams/device/mapped_file.hpp>
-
 #include <cstdint>
 #include <vector>
-#include <zlib.h>
 
 #ifdef _MSC_VER
 #include <Winsock2.h>
@@ -23,6 +20,7 @@
 #include "JarLoader.h"
 #include "Trace.h"
 #include "Util.h"
+#include "ZipArchive.h"
 
 /******************
  * Begin Class Loading code.
@@ -550,254 +548,36 @@ bool load_class_file(const std::string& filename, Scope* classes) {
  *
  */
 
-namespace {
-static const int kSignatureSize = 4;
-
-/* CDFile
- * Central directory file header entry structures.
- */
-static const uint16_t kCompMethodDeflate (8);
-static const uint8_t kCDFile[] = {'P', 'K', 0x01, 0x02};
-
-PACKED(struct pk_cd_file {
-  uint32_t signature;
-  uint16_t vmade;
-  uint16_t vextract;
-  uint16_t flags;
-  uint16_t comp_method;
-  uint16_t mod_time;
-  uint16_t mod_date;
-  uint32_t crc32;
-  uint32_t comp_size;
-  uint32_t ucomp_size;
-  uint16_t fname_len;
-  uint16_t extra_len;
-  uint16_t comment_len;
-  uint16_t diskno;
-  uint16_t interal_attr;
-  uint32_t external_attr;
-  uint32_t disk_offset;
-});
-
-/* CDirEnd:
- * End of central directory record structures.
- */
-static const int kMaxCDirEndSearch = 100;
-static const uint8_t kCDirEnd[] = {'P', 'K', 0x05, 0x06};
-
-PACKED(struct pk_cdir_end {
-  uint32_t signature;
-  uint16_t diskno;
-  uint16_t cd_diskno;
-  uint16_t cd_disk_entries;
-  uint16_t cd_entries;
-  uint32_t cd_size;
-  uint32_t cd_disk_offset;
-  uint16_t comment_len;
-});
-
-/* LFile:
- * Local file header structures.
- * (Yes, this made more sense in the world of floppies and tapes.)
- */
-static const uint8_t kLFile[] = {'P', 'K', 0x03, 0x04};
-
-PACKED(struct pk_lfile {
-  uint32_t signature;
-  uint16_t vextract;
-  uint16_t flags;
-  uint16_t comp_method;
-  uint16_t mod_time;
-  uint16_t mod_date;
-  uint32_t crc32;
-  uint32_t comp_size;
-  uint32_t ucomp_size;
-  uint16_t fname_len;
-  uint16_t extra_len;
-});
-
-struct jar_entry {
-  struct pk_cd_file cd_entry;
-  uint8_t *filename;
-  ~jar_entry() {
-    if (filename != nullptr) {
-      free(filename);
-      filename = nullptr;
-    }
-  }
-};
-}
-
-static bool find_central_directory(const uint8_t *mapping, ssize_t size,
-                                   pk_cdir_end &pce) {
-  ssize_t soffset = (size - sizeof(pk_cdir_end));
-  ssize_t eoffset = soffset - kMaxCDirEndSearch;
-  if (soffset < 0)
-    return false;
-  if (eoffset < 0)
-    eoffset = 0;
-  do {
-    const uint8_t *cdsearch = mapping + soffset;
-    if (memcmp(cdsearch, kCDirEnd, kSignatureSize) == 0) {
-      memcpy(&pce, cdsearch, sizeof(pk_cdir_end));
-      return true;
-    }
-  } while(soffset-- > eoffset);
-  fprintf(stderr, "End of central directory record not found, bailing\n");
-  return false;
-}
-
-static bool validate_pce(pk_cdir_end &pce, ssize_t size) {
-  /* We only support a limited feature set.  We
-   * don't support disk-spanning, so bail if that's the case.
-   */
-  if (pce.cd_diskno != pce.diskno ||
-      pce.cd_diskno != 0 ||
-      pce.cd_entries != pce.cd_disk_entries) {
-    fprintf(stderr, "Disk spanning is not supported, bailing\n");
-    return false;
-  }
-  ssize_t data_size = size - sizeof(pk_cdir_end);
-  if (pce.cd_disk_offset + pce.cd_size > data_size) {
-    fprintf(stderr, "Central directory overflow, invalid pce structure\n");
-    return false;
-  }
-  return true;
-}
-
-static bool extract_jar_entry(const uint8_t* &mapping, jar_entry &je) {
-  if (memcmp(mapping, kCDFile, kSignatureSize) != 0) {
-    fprintf(stderr, "Invalid central directory entry, bailing\n");
-    return false;
-  }
-  memcpy(&je.cd_entry, mapping, sizeof(pk_cd_file));
-  mapping += sizeof(pk_cd_file);
-  je.filename = (uint8_t*)malloc(je.cd_entry.fname_len + 1);
-  memcpy(je.filename, mapping, je.cd_entry.fname_len);
-  je.filename[je.cd_entry.fname_len] = '\0';
-  mapping += je.cd_entry.fname_len;
-  mapping += je.cd_entry.extra_len;
-  mapping += je.cd_entry.comment_len;
-  return true;
-}
-
-static bool get_jar_entries(const uint8_t *mapping, pk_cdir_end &pce,
-                            std::vector<jar_entry> &files) {
-  const uint8_t *cdir = mapping + pce.cd_disk_offset;
-  files.resize(pce.cd_entries);
-  for (int entry=0; entry < pce.cd_entries; entry++) {
-    if (!extract_jar_entry(cdir, files[entry]))
-      return false;
-  }
-  return true;
-}
-
-static int jar_uncompress(Bytef *dest, uLongf *destLen, const Bytef *source,
-                   uLong sourceLen) {
-  z_stream stream;
-  int err;
-
-  stream.next_in = (Bytef *)source;
-  stream.avail_in = (uInt)sourceLen;
-  stream.next_out = dest;
-  stream.avail_out = (uInt)*destLen;
-  stream.zalloc = (alloc_func)0;
-  stream.zfree = (free_func)0;
-
-  err = inflateInit2(&stream, -MAX_WBITS);
-  if (err != Z_OK) return err;
-
-  err = inflate(&stream, Z_FINISH);
-  if (err != Z_STREAM_END) {
-    inflateEnd(&stream);
-    return err;
-  }
-  *destLen = stream.total_out;
-
-  err = inflateEnd(&stream);
-  return err;
-}
-
-static bool decompress_class(jar_entry &file, const uint8_t *mapping,
-                             uint8_t *outbuffer, ssize_t bufsize) {
-  if (file.cd_entry.comp_method != kCompMethodDeflate) {
-    fprintf(stderr, "Unknown compression method %d, Bailing\n",
-            file.cd_entry.comp_method);
-    return false;
-  }
-  const uint8_t *lfile = mapping + file.cd_entry.disk_offset;
-  if (memcmp(lfile, kLFile, kSignatureSize) != 0) {
-    fprintf(stderr, "Invalid local file entry, bailing\n");
-    return false;
-  }
-  pk_lfile pkf;
-  memcpy(&pkf, lfile, sizeof(pk_lfile));
-  if (pkf.comp_size == 0 && pkf.ucomp_size == 0 &&
-     pkf.comp_size != file.cd_entry.comp_size &&
-     pkf.ucomp_size != file.cd_entry.ucomp_size) {
-    pkf.comp_size = file.cd_entry.comp_size;
-    pkf.ucomp_size = file.cd_entry.ucomp_size;
-  }
-  lfile += sizeof(pk_lfile);
-  if (pkf.fname_len != file.cd_entry.fname_len ||
-     pkf.comp_size != file.cd_entry.comp_size ||
-     pkf.ucomp_size != file.cd_entry.ucomp_size ||
-     pkf.comp_method != file.cd_entry.comp_method ||
-     memcmp(lfile, file.filename, pkf.fname_len) != 0) {
-    fprintf(stderr, "Directory entry doesn't match local file header, "
-            "Bailing %d %d %d %d, %d %d %d %d extra %d\n",
-            pkf.fname_len, pkf.comp_size, pkf.ucomp_size, pkf.comp_method,
-            file.cd_entry.fname_len, file.cd_entry.comp_size, file.cd_entry.ucomp_size, file.cd_entry.comp_method, pkf.extra_len);
-    return false;
-  }
-  lfile += pkf.fname_len;
-  lfile += pkf.extra_len;
-  uLongf dlen = bufsize;
-  int zlibrv = jar_uncompress(outbuffer, &dlen, lfile, pkf.comp_size);
-  if (zlibrv != Z_OK) {
-    fprintf(stderr, "uncompress failed with code %d, Bailing\n", zlibrv);
-    return false;
-  }
-  if (dlen != pkf.ucomp_size) {
-    fprintf(stderr, "mis-match on uncompressed size, Bailing\n");
-    return false;
-  }
-  return true;
-}
-
 static const int kStartBufferSize = 128 * 1024;
 
 static bool process_jar_entries(const char* location,
-                                std::vector<jar_entry>& files,
-                                const uint8_t* mapping,
+                                const zip::ZipReader& jar,
                                 Scope* classes,
                                 attribute_hook_t attr_hook) {
   ssize_t bufsize = kStartBufferSize;
   uint8_t *outbuffer = (uint8_t*)malloc(bufsize);
-  static char classEndString[] = ".class";
-  static size_t classEndStringLen = strlen(classEndString);
+  static const std::string classEndString = ".class";
   init_basic_types();
-  for (auto &file : files) {
-    if (file.cd_entry.ucomp_size == 0)
-      continue;
-    if (file.cd_entry.fname_len < (classEndStringLen  + 1))
+  for (const auto& file : jar.entries()) {
+    if (file.ucomp_size == 0)
       continue;
 
     // Skip non-class files
-    uint8_t *endcomp = file.filename +
-      (file.cd_entry.fname_len - classEndStringLen);
-    if (memcmp(endcomp, classEndString, classEndStringLen) != 0)
+    if (file.name.size() <= classEndString.size() ||
+        file.name.compare(file.name.size() - classEndString.size(),
+                          classEndString.size(),
+                          classEndString) != 0)
       continue;
 
     // Resize output if necessary.
-    if (bufsize < file.cd_entry.ucomp_size) {
-      while(bufsize < file.cd_entry.ucomp_size)
+    if (bufsize < file.ucomp_size) {
+      while(bufsize < file.ucomp_size)
         bufsize *= 2;
       free(outbuffer);
       outbuffer = (uint8_t*)malloc(bufsize);
     }
 
-    if (!decompress_class(file, mapping, outbuffer, bufsize)) {
+    if (!jar.read(file, outbuffer)) {
       free(outbuffer);
       return false;
     }
@@ -811,37 +591,16 @@ static bool process_jar_entries(const char* location,
   return true;
 }
 
-static bool process_jar(const char* location,
-                        const uint8_t* mapping,
-                        ssize_t size,
-                        Scope* classes,
-                        attribute_hook_t attr_hook) {
-  pk_cdir_end pce;
-  std::vector<jar_entry> files;
-  if (!find_central_directory(mapping, size, pce))
-    return false;
-  if (!validate_pce(pce, size))
-    return false;
-  if (!get_jar_entries(mapping, pce, files))
-    return false;
-  if (!process_jar_entries(location, files, mapping, classes, attr_hook)) {
-    return false;
-  }
-  return true;
-}
-
 bool load_jar_file(const char* location,
                    Scope* classes,
                    attribute_hook_t attr_hook) {
-  boost::iostreams::mapped_file file;
-  file.open(location, boost::iostreams::mapped_file::readonly);
-  if (!file.is_open()) {
+  zip::ZipReader jar;
+  if (!jar.open(location)) {
     fprintf(stderr, "error: cannot open jar file: %s\n", location);
     return false;
   }
 
-  auto mapping = reinterpret_cast<const uint8_t*>(file.const_data());
-  if (!process_jar(location, mapping, file.size(), classes, attr_hook)) {
+  if (!process_jar_entries(location, jar, classes, attr_hook)) {
     fprintf(stderr, "error: cannot process jar: %s\n", location);
     return false;
   }
@@ -7,11 +7,13 @@
 
 #include "OptData.h"
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <json/json.h>
 #include <mutex>
 #include <string>
@@ -122,58 +124,106 @@ void log_nopt(NoptReason nopt, const DexClass* cls) {
   OptDataMapper::get_instance().log_nopt(nopt, cls);
 }
 
-InsnOptData::InsnOptData(const DexMethod* method, const IRInstruction* insn)
-    : m_method(method) {
-  m_insn_orig = SHOW(insn);
-  m_has_line_num = get_line_num(method, insn, &m_line_num);
+namespace {
+
+std::atomic<uint64_t> s_next_subject_seq{0};
+
+} // namespace
+
+void ThreadLog::add_subject(Subject subject, const Key& key) {
+  subject.seq = s_next_subject_seq.fetch_add(1, std::memory_order_relaxed);
+  m_subject_ids.emplace(key, m_subjects.size());
+  m_subjects.push_back(std::move(subject));
 }
 
-MethodOptData::MethodOptData(const DexMethod* method) : m_method(method) {
-  m_method_orig = SHOW(method);
-  m_has_line_num = get_line_num(method, nullptr, &m_line_num);
+uint32_t ThreadLog::get_class_id(const DexClass* cls) {
+  auto it = m_subject_ids.find(Key(cls, nullptr));
+  if (it != m_subject_ids.end()) {
+    return it->second;
+  }
+  uint32_t id = m_subjects.size();
+  Subject subject{Level::CLASS};
+  subject.cls = cls;
+  subject.package = get_package_name(cls->get_type());
+  auto source_file = cls->get_source_file();
+  if (source_file != nullptr) {
+    subject.source_file = source_file->str();
+  }
+  add_subject(std::move(subject), Key(cls, nullptr));
+  return id;
 }
 
-std::shared_ptr<InsnOptData> MethodOptData::get_insn_opt_data(
-    const IRInstruction* insn) {
-  const auto& kv_pair = m_insn_opt_map.find(insn);
-  if (kv_pair == m_insn_opt_map.end()) {
-    auto insn_opt_data = std::make_shared<InsnOptData>(m_method, insn);
-    m_insn_opt_map.emplace(insn, insn_opt_data);
-    return insn_opt_data;
+uint32_t ThreadLog::get_method_id(const DexMethod* method) {
+  auto it = m_subject_ids.find(Key(method, nullptr));
+  if (it != m_subject_ids.end()) {
+    return it->second;
   }
-  return kv_pair->second;
+  auto cls_id = get_class_id(type_class(method->get_class()));
+  uint32_t id = m_subjects.size();
+  Subject subject{Level::METHOD};
+  subject.method = method;
+  subject.parent = cls_id;
+  subject.has_line_num = get_line_num(method, nullptr, &subject.line_num);
+  add_subject(std::move(subject), Key(method, nullptr));
+  return id;
 }
 
-ClassOptData::ClassOptData(const DexClass* cls) : m_cls(cls) {
-  m_package = get_package_name(cls->get_type());
-  auto source_file = cls->get_source_file();
-  if (source_file != nullptr) {
-    m_has_srcfile = true;
-    m_filename = source_file->str();
+uint32_t ThreadLog::get_insn_id(const DexMethod* method,
+                                const IRInstruction* insn) {
+  auto it = m_subject_ids.find(Key(method, insn));
+  if (it != m_subject_ids.end()) {
+    return it->second;
   }
+  auto meth_id = get_method_id(method);
+  uint32_t id = m_subjects.size();
+  Subject subject{Level::INSN};
+  subject.method = method;
+  subject.insn = insn;
+  subject.parent = meth_id;
+  subject.insn_orig = SHOW(insn);
+  subject.has_line_num = get_line_num(method, insn, &subject.line_num);
+  add_subject(std::move(subject), Key(method, insn));
+  return id;
 }
 
-std::shared_ptr<MethodOptData> ClassOptData::get_meth_opt_data(
-    const DexMethod* method) {
-  const auto& kv_pair = m_meth_opt_map.find(method);
-  if (kv_pair == m_meth_opt_map.end()) {
-    auto meth_opt_data = std::make_shared<MethodOptData>(method);
-    m_meth_opt_map.emplace(method, meth_opt_data);
-    return meth_opt_data;
+namespace {
+
+// Gives the log of a thread back to the mapper when the thread exits.
+struct ThreadLogHandle {
+  ThreadLog* log{nullptr};
+  std::function<void(ThreadLog*)> release;
+  ~ThreadLogHandle() {
+    if (log != nullptr) {
+      release(log);
+    }
   }
-  return kv_pair->second;
+};
+
+} // namespace
+
+ThreadLog& OptDataMapper::get_thread_log() {
+  thread_local ThreadLogHandle handle;
+  if (handle.log == nullptr) {
+    handle.log = acquire_thread_log();
+    handle.release = [this](ThreadLog* log) { release_thread_log(log); };
+  }
+  return *handle.log;
 }
 
-std::shared_ptr<ClassOptData> OptDataMapper::get_cls_opt_data(
-    DexType* cls_type) {
-  auto cls = type_class(cls_type);
-  const auto& kv_pair = m_cls_opt_map.find(cls);
-  if (kv_pair == m_cls_opt_map.end()) {
-    auto cls_opt_data = std::make_shared<ClassOptData>(cls);
-    m_cls_opt_map.emplace(cls, cls_opt_data);
-    return cls_opt_data;
+ThreadLog* OptDataMapper::acquire_thread_log() {
+  std::lock_guard<std::mutex> guard(m_thread_logs_mutex);
+  if (!m_free_thread_logs.empty()) {
+    auto log = m_free_thread_logs.back();
+    m_free_thread_logs.pop_back();
+    return log;
   }
-  return kv_pair->second;
+  m_thread_logs.emplace_back(new ThreadLog());
+  return m_thread_logs.back().get();
+}
+
+void OptDataMapper::release_thread_log(ThreadLog* log) {
+  std::lock_guard<std::mutex> guard(m_thread_logs_mutex);
+  m_free_thread_logs.push_back(log);
 }
 
 void OptDataMapper::log_opt(OptReason opt,
@@ -182,73 +232,158 @@ void OptDataMapper::log_opt(OptReason opt,
   if (!m_logs_enabled) {
     return;
   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
   always_assert_log(method != nullptr, "Can't log null method\n");
   always_assert_log(insn != nullptr, "Can't log null instruction\n");
-  auto cls_opt_data = get_cls_opt_data(method->get_class());
-  auto meth_opt_data = cls_opt_data->get_meth_opt_data(method);
-  auto insn_opt_data = meth_opt_data->get_insn_opt_data(insn);
-  insn_opt_data->m_opts.emplace_back(opt);
+  auto& log = get_thread_log();
+  log.add(log.get_insn_id(method, insn), opt, true);
 }
 
 void OptDataMapper::log_nopt(NoptReason nopt,
                              const DexMethod* method,
                              const IRInstruction* insn) {
-   if (!m_logs_enabled) {
-     return;
-   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
+  if (!m_logs_enabled) {
+    return;
+  }
   always_assert_log(method != nullptr, "Can't log null method\n");
   always_assert_log(insn != nullptr, "Can't log null instruction\n");
-  auto cls_opt_data = get_cls_opt_data(method->get_class());
-  auto meth_opt_data = cls_opt_data->get_meth_opt_data(method);
-  auto insn_opt_data = meth_opt_data->get_insn_opt_data(insn);
-  insn_opt_data->m_nopts.emplace_back(nopt);
+  auto& log = get_thread_log();
+  log.add(log.get_insn_id(method, insn), nopt, false);
 }
 
 void OptDataMapper::log_opt(OptReason opt, const DexMethod* method) {
   if (!m_logs_enabled) {
     return;
   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
   always_assert_log(method != nullptr, "Can't log null method\n");
-  auto cls_opt_data = get_cls_opt_data(method->get_class());
-  auto meth_opt_data = cls_opt_data->get_meth_opt_data(method);
-  meth_opt_data->m_opts.emplace_back(opt);
+  auto& log = get_thread_log();
+  log.add(log.get_method_id(method), opt, true);
 }
 
 void OptDataMapper::log_nopt(NoptReason nopt, const DexMethod* method) {
   if (!m_logs_enabled) {
     return;
   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
   always_assert_log(method != nullptr, "Can't log null method\n");
-  auto cls_opt_data = get_cls_opt_data(method->get_class());
-  auto meth_opt_data = cls_opt_data->get_meth_opt_data(method);
-  meth_opt_data->m_nopts.emplace_back(nopt);
+  auto& log = get_thread_log();
+  log.add(log.get_method_id(method), nopt, false);
 }
 
 void OptDataMapper::log_opt(OptReason opt, const DexClass* cls) {
   if (!m_logs_enabled) {
     return;
   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
   always_assert_log(cls != nullptr, "Can't log null class\n");
-  auto cls_opt_data = get_cls_opt_data(cls->get_type());
-  cls_opt_data->m_opts.emplace_back(opt);
+  auto& log = get_thread_log();
+  log.add(log.get_class_id(cls), opt, true);
 }
 
 void OptDataMapper::log_nopt(NoptReason nopt, const DexClass* cls) {
   if (!m_logs_enabled) {
     return;
   }
-  std::lock_guard<std::mutex> guard(s_opt_log_mutex);
   always_assert_log(cls != nullptr, "Can't log null class\n");
-  auto cls_opt_data = get_cls_opt_data(cls->get_type());
-  cls_opt_data->m_nopts.emplace_back(nopt);
+  auto& log = get_thread_log();
+  log.add(log.get_class_id(cls), nopt, false);
+}
+
+namespace {
+
+/**
+ * The decisions of all the ThreadLogs for one class, method or instruction.
+ * `subject` is the earliest of the Subjects recorded for it, which holds the
+ * state it was in when it was first logged. The decisions are grouped by the
+ * thread that made them, in the order each thread made them.
+ */
+struct MergedSubject {
+  const Subject* subject;
+  uint32_t parent;
+  std::vector<OptReason> opts;
+  std::vector<NoptReason> nopts;
+};
+
+/**
+ * Writes the rows of a table, one json object per line.
+ */
+class TableWriter {
+ public:
+  TableWriter(std::ostream& out, const char* name, bool first)
+      : m_out(out) {
+    if (!first) {
+      m_out << ",\n";
+    }
+    m_out << Json::valueToQuotedString(name) << ":[";
+  }
+  ~TableWriter() { m_out << (m_empty ? "]" : "\n]"); }
+
+  TableWriter& begin_row() {
+    m_out << (m_empty ? "\n{" : ",\n{");
+    m_empty = false;
+    m_first_column = true;
+    return *this;
+  }
+  TableWriter& column(const char* name, uint64_t value) {
+    column_name(name);
+    m_out << value;
+    return *this;
+  }
+  TableWriter& column(const char* name, const std::string& value) {
+    column_name(name);
+    m_out << Json::valueToQuotedString(value.c_str());
+    return *this;
+  }
+  void end_row() { m_out << '}'; }
+
+ private:
+  void column_name(const char* name) {
+    if (!m_first_column) {
+      m_out << ',';
+    }
+    m_first_column = false;
+    m_out << '"' << name << "\":";
+  }
+
+  std::ostream& m_out;
+  bool m_empty{true};
+  bool m_first_column{true};
+};
+
+/**
+ * For the table {msg_type}_messages, write each row to table.
+ */
+void serialize_messages(const std::unordered_map<int, std::string>& msg_map,
+                        TableWriter& table) {
+  for (const auto& reason_msg_pair : msg_map) {
+    table.begin_row()
+        .column("reason_code", reason_msg_pair.first)
+        .column("message", reason_msg_pair.second)
+        .end_row();
+  }
 }
 
-Json::Value OptDataMapper::serialize_sql() {
+/**
+ * For the tables {level}_opts and {level}_nopts, write a row for each reason
+ * of each subject.
+ */
+template <typename Reason>
+void serialize_reasons(
+    const std::vector<MergedSubject>& subjects,
+    std::vector<Reason> MergedSubject::*reasons,
+    TableWriter& table) {
+  for (size_t id = 0; id < subjects.size(); ++id) {
+    const auto& subject_reasons = subjects[id].*reasons;
+    for (size_t i = 0; i < subject_reasons.size(); ++i) {
+      table.begin_row()
+          .column("reason_idx", i)
+          .column("id", id)
+          .column("reason_code", subject_reasons[i])
+          .end_row();
+    }
+  }
+}
+
+} // namespace
+
+void OptDataMapper::serialize_sql(std::ostream& out) {
   constexpr const char* CLASS_OPTS = "class_opts";
   constexpr const char* METHOD_OPTS = "method_opts";
   constexpr const char* INSTRUCTION_OPTS = "instruction_opts";
@@ -260,153 +395,145 @@ Json::Value OptDataMapper::serialize_sql() {
   constexpr const char* CLASSES = "classes";
   constexpr const char* OPT_MESSAGES = "opt_messages";
   constexpr const char* NOPT_MESSAGES = "nopt_messages";
-  Json::Value top;
-
-  Json::Value opt_msg_arr;
-  Json::Value nopt_msg_arr;
-  serialize_messages_helper(m_opt_msg_map, &opt_msg_arr);
-  serialize_messages_helper(m_nopt_msg_map, &nopt_msg_arr);
-  top[OPT_MESSAGES] = opt_msg_arr;
-  top[NOPT_MESSAGES] = nopt_msg_arr;
-
-  size_t cls_id{0};
-  size_t meth_id{0};
-  size_t insn_id{0};
-  Json::Value cls_arr;
-  Json::Value cls_opt_arr;
-  Json::Value cls_nopt_arr;
-  Json::Value meth_arr;
-  Json::Value meth_opt_arr;
-  Json::Value meth_nopt_arr;
-  Json::Value insn_arr;
-  Json::Value insn_opt_arr;
-  Json::Value insn_nopt_arr;
-
-  for (const auto& cls_pair : m_cls_opt_map) {
-    auto cls_opt_data = cls_pair.second;
-    serialize_class(cls_opt_data, cls_id, &cls_arr, &cls_opt_arr,
-                    &cls_nopt_arr);
-
-    for (const auto& meth_pair : cls_opt_data->m_meth_opt_map) {
-      auto meth_opt_data = meth_pair.second;
-      serialize_method(meth_opt_data, cls_id, meth_id, &meth_arr, &meth_opt_arr,
-                       &meth_nopt_arr);
-
-      for (const auto& insn_pair : meth_opt_data->m_insn_opt_map) {
-        auto insn_opt_data = insn_pair.second;
-        serialize_insn(insn_opt_data, meth_id, insn_id, &insn_arr,
-                       &insn_opt_arr, &insn_nopt_arr);
-        insn_id++;
+
+  // Merge the thread logs. Each log creates the subjects of a class before
+  // the ones of its methods and instructions, so parents are always merged
+  // before their children.
+  std::vector<MergedSubject> merged[3];
+  std::unordered_map<ThreadLog::Key, uint32_t, ThreadLog::KeyHash> merged_ids;
+  std::vector<uint32_t> log_to_merged;
+  for (const auto& log : m_thread_logs) {
+    log_to_merged.clear();
+    log_to_merged.reserve(log->m_subjects.size());
+    for (const auto& subject : log->m_subjects) {
+      auto level = static_cast<size_t>(subject.level);
+      ThreadLog::Key key;
+      uint32_t parent = 0;
+      switch (subject.level) {
+      case Level::CLASS:
+        key = ThreadLog::Key(subject.cls, nullptr);
+        break;
+      case Level::METHOD:
+        key = ThreadLog::Key(subject.method, nullptr);
+        parent = log_to_merged.at(subject.parent);
+        break;
+      case Level::INSN:
+        key = ThreadLog::Key(subject.method, subject.insn);
+        parent = log_to_merged.at(subject.parent);
+        break;
+      }
+      auto it = merged_ids.find(key);
+      if (it == merged_ids.end()) {
+        it = merged_ids.emplace(key, merged[level].size()).first;
+        merged[level].push_back(MergedSubject{&subject, parent, {}, {}});
+      } else if (subject.seq < merged[level][it->second].subject->seq) {
+        merged[level][it->second].subject = &subject;
+      }
+      log_to_merged.push_back(it->second);
+    }
+    for (const auto& decision : log->m_decisions) {
+      const auto& subject = log->m_subjects[decision.subject];
+      auto& target = merged[static_cast<size_t>(subject.level)]
+                           [log_to_merged[decision.subject]];
+      if (decision.is_opt) {
+        target.opts.push_back(static_cast<OptReason>(decision.reason));
+      } else {
+        target.nopts.push_back(static_cast<NoptReason>(decision.reason));
       }
-      meth_id++;
     }
-    cls_id++;
-  }
-
-  top[CLASSES] = cls_arr;
-  top[METHODS] = meth_arr;
-  top[INSTRUCTIONS] = insn_arr;
-  top[INSTRUCTION_OPTS] = insn_opt_arr;
-  top[METHOD_OPTS] = meth_opt_arr;
-  top[CLASS_OPTS] = cls_opt_arr;
-  top[INSTRUCTION_NOPTS] = insn_nopt_arr;
-  top[METHOD_NOPTS] = meth_nopt_arr;
-  top[CLASS_NOPTS] = cls_nopt_arr;
-  return top;
-}
-
-void OptDataMapper::serialize_messages_helper(
-    const std::unordered_map<int, std::string>& msg_map, Json::Value* arr) {
-  for (const auto& reason_msg_pair : msg_map) {
-    auto reason = reason_msg_pair.first;
-    const auto& message = reason_msg_pair.second;
-    Json::Value msg_pair;
-    msg_pair["reason_code"] = reason;
-    msg_pair["message"] = std::move(message);
-    arr->append(msg_pair);
   }
-}
-
-void OptDataMapper::serialize_opt_nopt_helper(
-    const std::vector<OptReason>& opts,
-    const std::vector<NoptReason>& nopts,
-    size_t id,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  for (size_t i = 0; i < opts.size(); ++i) {
-    verify_opt(opts.at(i));
-    Json::Value opt_data;
-    opt_data["reason_idx"] = (uint)i;
-    opt_data["id"] = (uint)id;
-    opt_data["reason_code"] = opts.at(i);
-    opt_arr->append(opt_data);
-  }
-  for (size_t i = 0; i < nopts.size(); ++i) {
-    verify_nopt(nopts.at(i));
-    Json::Value nopt_data;
-    nopt_data["reason_idx"] = (uint)i;
-    nopt_data["id"] = (uint)id;
-    nopt_data["reason_code"] = nopts.at(i);
-    nopt_arr->append(nopt_data);
+  const auto& classes = merged[static_cast<size_t>(Level::CLASS)];
+  const auto& methods = merged[static_cast<size_t>(Level::METHOD)];
+  const auto& insns = merged[static_cast<size_t>(Level::INSN)];
+  for (const auto& level : merged) {
+    for (const auto& subject : level) {
+      for (auto opt : subject.opts) {
+        verify_opt(opt);
+      }
+      for (auto nopt : subject.nopts) {
+        verify_nopt(nopt);
+      }
+    }
   }
-}
 
-void OptDataMapper::serialize_class(std::shared_ptr<ClassOptData> cls_opt_data,
-                                    size_t cls_id,
-                                    Json::Value* arr,
-                                    Json::Value* opt_arr,
-                                    Json::Value* nopt_arr) {
-  const auto& name = get_deobfuscated_name_substr(cls_opt_data->m_cls);
-  Json::Value cls_data;
-  cls_data["id"] = (uint)cls_id;
-  cls_data["package"] = cls_opt_data->m_package;
-  cls_data["source_file"] =
-      cls_opt_data->m_has_srcfile ? cls_opt_data->m_filename : "";
-  cls_data["name"] = name.c_str();
-  arr->append(cls_data);
-  serialize_opt_nopt_helper(cls_opt_data->m_opts, cls_opt_data->m_nopts, cls_id,
-                            opt_arr, nopt_arr);
-}
-
-void OptDataMapper::serialize_method(
-    std::shared_ptr<MethodOptData> meth_opt_data,
-    size_t cls_id,
-    size_t meth_id,
-    Json::Value* arr,
-    Json::Value* opt_arr,
-    Json::Value* nopt_arr) {
-  const auto& method = meth_opt_data->m_method;
-  Json::Value meth_data;
-  meth_data["id"] = (uint)meth_id;
-  meth_data["cls_id"] = (uint)cls_id;
-  meth_data["has_line_num"] = meth_opt_data->m_has_line_num ? 1 : 0;
-  meth_data["line_num"] = (uint)meth_opt_data->m_line_num;
-  meth_data["signature"] = get_deobfuscated_name(method);
-  meth_data["code_size"] =
-      (uint)(method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
-  arr->append(meth_data);
-  serialize_opt_nopt_helper(meth_opt_data->m_opts, meth_opt_data->m_nopts,
-                            meth_id, opt_arr, nopt_arr);
-}
-
-void OptDataMapper::serialize_insn(std::shared_ptr<InsnOptData> insn_opt_data,
-                                   size_t meth_id,
-                                   size_t insn_id,
-                                   Json::Value* arr,
-                                   Json::Value* opt_arr,
-                                   Json::Value* nopt_arr) {
-  Json::Value insn_data;
-  insn_data["id"] = (uint)insn_id;
-  insn_data["meth_id"] = (uint)meth_id;
-  insn_data["has_line_num"] = insn_opt_data->m_has_line_num ? 1 : 0;
-  insn_data["line_num"] = (uint)insn_opt_data->m_line_num;
-  insn_data["instruction"] = insn_opt_data->m_insn_orig;
-
-  // TODO In case of invokes, we want to show the deobfuscated name for clarity,
-  // if possible.
-  arr->append(insn_data);
-  serialize_opt_nopt_helper(insn_opt_data->m_opts, insn_opt_data->m_nopts,
-                            insn_id, opt_arr, nopt_arr);
+  out << "{\n";
+  {
+    TableWriter table(out, OPT_MESSAGES, /* first */ true);
+    serialize_messages(m_opt_msg_map, table);
+  }
+  {
+    TableWriter table(out, NOPT_MESSAGES, false);
+    serialize_messages(m_nopt_msg_map, table);
+  }
+  {
+    TableWriter table(out, CLASSES, false);
+    for (size_t id = 0; id < classes.size(); ++id) {
+      const auto& subject = *classes[id].subject;
+      table.begin_row()
+          .column("id", id)
+          .column("package", subject.package)
+          .column("source_file", subject.source_file)
+          .column("name", get_deobfuscated_name_substr(subject.cls))
+          .end_row();
+    }
+  }
+  {
+    TableWriter table(out, METHODS, false);
+    for (size_t id = 0; id < methods.size(); ++id) {
+      const auto& subject = *methods[id].subject;
+      const auto* method = subject.method;
+      table.begin_row()
+          .column("id", id)
+          .column("cls_id", methods[id].parent)
+          .column("has_line_num", subject.has_line_num ? 1 : 0)
+          .column("line_num", subject.line_num)
+          .column("signature", get_deobfuscated_name(method))
+          .column("code_size",
+                  method->get_code() ? method->get_code()->sum_opcode_sizes()
+                                     : 0)
+          .end_row();
+    }
+  }
+  {
+    // TODO In case of invokes, we want to show the deobfuscated name for
+    // clarity, if possible.
+    TableWriter table(out, INSTRUCTIONS, false);
+    for (size_t id = 0; id < insns.size(); ++id) {
+      const auto& subject = *insns[id].subject;
+      table.begin_row()
+          .column("id", id)
+          .column("meth_id", insns[id].parent)
+          .column("has_line_num", subject.has_line_num ? 1 : 0)
+          .column("line_num", subject.line_num)
+          .column("instruction", subject.insn_orig)
+          .end_row();
+    }
+  }
+  {
+    TableWriter table(out, INSTRUCTION_OPTS, false);
+    serialize_reasons(insns, &MergedSubject::opts, table);
+  }
+  {
+    TableWriter table(out, METHOD_OPTS, false);
+    serialize_reasons(methods, &MergedSubject::opts, table);
+  }
+  {
+    TableWriter table(out, CLASS_OPTS, false);
+    serialize_reasons(classes, &MergedSubject::opts, table);
+  }
+  {
+    TableWriter table(out, INSTRUCTION_NOPTS, false);
+    serialize_reasons(insns, &MergedSubject::nopts, table);
+  }
+  {
+    TableWriter table(out, METHOD_NOPTS, false);
+    serialize_reasons(methods, &MergedSubject::nopts, table);
+  }
+  {
+    TableWriter table(out, CLASS_NOPTS, false);
+    serialize_reasons(classes, &MergedSubject::nopts, table);
+  }
+  out << "\n}\n";
 }
 
 /**
@@ -448,7 +575,9 @@ void OptDataMapper::init_nopt_messages() {
       {INL_MULTIPLE_RETURNS,
        "Didn''t inline: callee has multiple return points"},
       {INL_TOO_MANY_CALLERS,
-       "Didn''t inline: this method has too many callers"}};
+       "Didn''t inline: this method has too many callers"},
+      {INL_COLD_CALLER,
+       "Didn''t inline: the caller is cold according to the method profile"}};
   m_nopt_msg_map = std::move(nopt_msg_map);
 }
 
@@ -464,5 +593,4 @@ void OptDataMapper::verify_nopt(NoptReason reason) {
                     reason);
 }
 
-std::mutex OptDataMapper::s_opt_log_mutex;
 } // namespace opt_metadata
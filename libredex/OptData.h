@@ -7,11 +7,14 @@
 
 #pragma once
 
-#include <json/json.h>
+#include <boost/functional/hash.hpp>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "DexClass.h"
 #include "IRInstruction.h"
@@ -32,9 +35,6 @@
  *     - For class-level: log_opt/nopt(reason, cls)
  */
 namespace opt_metadata {
-class InsnOptData;
-class MethodOptData;
-class ClassOptData;
 
 /**
  * Per-instruction logging functions. We require each insn log to be
@@ -62,67 +62,79 @@ void log_nopt(NoptReason opt, const DexMethod* method);
 void log_opt(OptReason opt, const DexClass* cls);
 void log_nopt(NoptReason opt, const DexClass* cls);
 
+enum class Level : uint8_t { CLASS, METHOD, INSN };
+
 /**
- * Stores per-insn optimization data.
+ * A class, method or instruction that has decisions logged against it.
+ *
+ * Instructions may be deleted by later passes, so everything we want to
+ * report about them is captured when they are first logged.
  */
-class InsnOptData {
-  friend class MethodOptData;
-  friend class OptDataMapper;
-
- public:
-  InsnOptData(const DexMethod* method, const IRInstruction* insn);
-
- private:
-  const DexMethod* m_method;
-  std::string m_insn_orig;
-  bool m_has_line_num{false};
-  size_t m_line_num{0};
-  std::vector<OptReason> m_opts;
-  std::vector<NoptReason> m_nopts;
+struct Subject {
+  Level level;
+  const DexClass* cls{nullptr};
+  const DexMethod* method{nullptr};
+  // Only used to tell instructions apart; it may be dangling by the time the
+  // logs are serialized.
+  const IRInstruction* insn{nullptr};
+  // The id of the enclosing class (for methods) or method (for instructions)
+  // in the same ThreadLog.
+  uint32_t parent{0};
+  // When the subject was first logged, across all the ThreadLogs.
+  uint64_t seq{0};
+  // Classes may be renamed by later passes, so these are captured as well.
+  std::string package;
+  std::string source_file;
+  std::string insn_orig;
+  bool has_line_num{false};
+  size_t line_num{0};
 };
 
 /**
- * Stores per-method optimization data.
+ * A single logged opt or nopt, attributed to a subject of the ThreadLog that
+ * recorded it.
  */
-class MethodOptData {
-  friend class InsnOptData;
-  friend class ClassOptData;
-  friend class OptDataMapper;
-
- public:
-  MethodOptData(const DexMethod* method);
-  std::shared_ptr<InsnOptData> get_insn_opt_data(const IRInstruction* insn);
-
- private:
-  const DexMethod* m_method;
-  std::string m_method_orig;
-  bool m_has_line_num{false};
-  size_t m_line_num{0};
-  std::vector<OptReason> m_opts;
-  std::vector<NoptReason> m_nopts;
-  std::unordered_map<const IRInstruction*, std::shared_ptr<InsnOptData>>
-      m_insn_opt_map;
+struct Decision {
+  uint32_t subject;
+  uint16_t reason;
+  bool is_opt;
 };
 
 /**
- * Stores per-class optimization data.
+ * Append-only log of the decisions made on one thread. Logging only touches
+ * the log of the calling thread, so it doesn't need any synchronization.
+ * Logs are handed over to the next thread once their thread exits, and are
+ * only merged when serializing.
  */
-class ClassOptData {
+class ThreadLog {
   friend class OptDataMapper;
 
  public:
-  ClassOptData(const DexClass* cls);
-  std::shared_ptr<MethodOptData> get_meth_opt_data(const DexMethod* method);
+  uint32_t get_class_id(const DexClass* cls);
+  uint32_t get_method_id(const DexMethod* method);
+  uint32_t get_insn_id(const DexMethod* method, const IRInstruction* insn);
+
+  void add(uint32_t subject, int reason, bool is_opt) {
+    m_decisions.push_back(Decision{subject, static_cast<uint16_t>(reason),
+                                   is_opt});
+  }
 
  private:
-  const DexClass* m_cls;
-  bool m_has_srcfile{false};
-  std::string m_package;
-  std::string m_filename;
-  std::vector<OptReason> m_opts;
-  std::vector<NoptReason> m_nopts;
-  std::unordered_map<const DexMethod*, std::shared_ptr<MethodOptData>>
-      m_meth_opt_map;
+  using Key = std::pair<const void*, const IRInstruction*>;
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t seed = 0;
+      boost::hash_combine(seed, key.first);
+      boost::hash_combine(seed, key.second);
+      return seed;
+    }
+  };
+
+  void add_subject(Subject subject, const Key& key);
+
+  std::vector<Subject> m_subjects;
+  std::unordered_map<Key, uint32_t, KeyHash> m_subject_ids;
+  std::vector<Decision> m_decisions;
 };
 
 /**
@@ -130,8 +142,6 @@ class ClassOptData {
  */
 class OptDataMapper {
  public:
-  static std::mutex s_opt_log_mutex;
-
   static OptDataMapper& get_instance() {
     static OptDataMapper instance;
     return instance;
@@ -144,6 +154,8 @@ class OptDataMapper {
    */
   void enable_logs() { m_logs_enabled = true; };
 
+  bool logs_enabled() const { return m_logs_enabled; }
+
   /**
    * Records the given opt and attributes it to the given class/method/insn.
    */
@@ -159,8 +171,10 @@ class OptDataMapper {
   void log_nopt(NoptReason opt, const DexClass* cls);
 
   /**
-   * Writes the gathered optimization data in terms of sql queries, separated
-   * by newlines for easy parsing later on.
+   * Writes the gathered optimization data as a json object with one array per
+   * sql table, and one row per line for easy parsing later on. Rows are
+   * written as they are produced, without building the whole document in
+   * memory. This must not run concurrently with logging.
    * 11 tables are created:
    *  - opt_messages maps an optimization reason_code to a message.
    *  - nopt_messages maps a non-optimization reason_code to a message.
@@ -172,12 +186,15 @@ class OptDataMapper {
    *  - classes/methods/instructions contain basic information: a unique id,
    *    names, and in the case of instructions, the instruction itself.
    */
-  Json::Value serialize_sql();
+  void serialize_sql(std::ostream& out);
 
  private:
   bool m_logs_enabled{false};
-  std::unordered_map<const DexClass*, std::shared_ptr<ClassOptData>>
-      m_cls_opt_map;
+  // Every ThreadLog ever created, and the ones that aren't owned by a live
+  // thread.
+  std::mutex m_thread_logs_mutex;
+  std::vector<std::unique_ptr<ThreadLog>> m_thread_logs;
+  std::vector<ThreadLog*> m_free_thread_logs;
   std::unordered_map<int /*OptReason*/, std::string> m_opt_msg_map;
   std::unordered_map<int /*NoptReason*/, std::string> m_nopt_msg_map;
 
@@ -187,58 +204,12 @@ class OptDataMapper {
   }
 
   /**
-   * Finds and returns a ClassOptData for the given class type. If the
-   * ClassOptData doesn't yet exist, construct it and return.
-   */
-  std::shared_ptr<ClassOptData> get_cls_opt_data(DexType* cls_type);
-
-  /**
-   * For the table {msg_type}_messages, append each row as an entry to arr.
-   */
-  void serialize_messages_helper(
-      const std::unordered_map<int, std::string>& msg_map, Json::Value* arr);
-
-  /**
-   * For the tables {level}_opts and {level}_nopts, append each row as an
-   * entry in the corresponding json arr.
-   */
-  void serialize_opt_nopt_helper(const std::vector<OptReason>& opts,
-                                 const std::vector<NoptReason>& nopts,
-                                 size_t id,
-                                 Json::Value* opt_arr,
-                                 Json::Value* nopt_arr);
-
-  /**
-   * For the table 'classes', append class info to arr. Append cls opt info to
-   * opt/nopt arrs.
-   */
-  void serialize_class(std::shared_ptr<ClassOptData> cls_opt_data,
-                       size_t cls_id,
-                       Json::Value* arr,
-                       Json::Value* opt_arr,
-                       Json::Value* nopt_arr);
-
-  /**
-   * For the table 'methods', append method info to arr. Append meth opt info to
-   * opt/nopt arrs.
-   */
-  void serialize_method(std::shared_ptr<MethodOptData> meth_opt_data,
-                        size_t cls_id,
-                        size_t meth_id,
-                        Json::Value* arr,
-                        Json::Value* opt_arr,
-                        Json::Value* nopt_arr);
-
-  /**
-   * For the table 'instructions', append instruction info to arr. Append insn
-   * opt info to opt/nopt arrs.
+   * Returns the log of the calling thread, taking over a free one or creating
+   * it on the first call from that thread.
    */
-  void serialize_insn(std::shared_ptr<InsnOptData> insn_opt_data,
-                      size_t meth_id,
-                      size_t insn_id,
-                      Json::Value* arr,
-                      Json::Value* opt_arr,
-                      Json::Value* nopt_arr);
+  ThreadLog& get_thread_log();
+  ThreadLog* acquire_thread_log();
+  void release_thread_log(ThreadLog* log);
 
   /**
    * NOTE: Register an opt/non-opt message to the corresponding init_ function.
@@ -39,6 +39,7 @@ enum NoptReason : int {
   INL_UNKNOWN_FIELD,
   INL_MULTIPLE_RETURNS,
   INL_TOO_MANY_CALLERS,
+  INL_COLD_CALLER,
 
   // NOPT reason count
   N_NOPT_REASONS,
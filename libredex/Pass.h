@@ -43,6 +43,21 @@ class Pass {
   virtual void eval_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {};
   virtual void run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) = 0;
 
+  /**
+   * A pass that starts with a read-only analysis of the whole program can do
+   * it in analyze_pass and keep the results for its run_pass. analyze_pass
+   * must not change the program nor record metrics.
+   *
+   * By default analyze_pass runs right before run_pass. When the
+   * "concurrent_pass_analysis" option is set, the analyses of consecutive
+   * passes that have one run concurrently, on the program as it is before
+   * the first of these passes runs; their run_pass still run one after the
+   * other. Only turn it on for pass lists where these passes don't change
+   * what the later ones analyze.
+   */
+  virtual bool has_analysis() const { return false; }
+  virtual void analyze_pass(const Scope& scope, const PassManager& mgr) {}
+
  private:
   std::string m_name;
 };
@@ -7,8 +7,12 @@
 
 #include "PassManager.h"
 
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <unordered_set>
 
 #include "ApiLevelChecker.h"
@@ -31,6 +35,7 @@
 #include "ReachableClasses.h"
 #include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -42,6 +47,91 @@ std::string get_apk_dir(const Json::Value& config) {
   return apkdir;
 }
 
+/*
+ * Hashes everything about the code of a method that the type checker looks
+ * at, to detect the changes that don't go through the IRList API.
+ */
+size_t code_fingerprint(const DexMethod* method, const IRCode& code) {
+  size_t seed = 0;
+  boost::hash_combine(seed, method->get_proto());
+  boost::hash_combine(seed, is_static(method));
+  boost::hash_combine(seed, code.get_registers_size());
+  for (const auto& mie : code) {
+    boost::hash_combine(seed, static_cast<int>(mie.type));
+    switch (mie.type) {
+    case MFLOW_OPCODE: {
+      auto insn = mie.insn;
+      boost::hash_combine(seed, static_cast<int>(insn->opcode()));
+      if (insn->dests_size()) {
+        boost::hash_combine(seed, insn->dest());
+      }
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        boost::hash_combine(seed, insn->src(i));
+      }
+      if (insn->has_literal()) {
+        boost::hash_combine(seed, insn->get_literal());
+      } else if (insn->has_string()) {
+        boost::hash_combine(seed, insn->get_string());
+      } else if (insn->has_type()) {
+        boost::hash_combine(seed, insn->get_type());
+      } else if (insn->has_field()) {
+        // Member references can be changed in place (see DexMethod::change),
+        // so we hash the parts the checker relies on as well.
+        boost::hash_combine(seed, insn->get_field());
+        boost::hash_combine(seed, insn->get_field()->get_type());
+      } else if (insn->has_method()) {
+        boost::hash_combine(seed, insn->get_method());
+        boost::hash_combine(seed, insn->get_method()->get_proto());
+      }
+      break;
+    }
+    case MFLOW_TRY:
+      boost::hash_combine(seed, static_cast<int>(mie.tentry->type));
+      boost::hash_combine(seed, mie.tentry->catch_start);
+      break;
+    case MFLOW_CATCH:
+      boost::hash_combine(seed, mie.centry->catch_type);
+      boost::hash_combine(seed, mie.centry->next);
+      break;
+    case MFLOW_TARGET:
+      boost::hash_combine(seed, static_cast<int>(mie.target->type));
+      boost::hash_combine(seed, mie.target->src);
+      boost::hash_combine(seed, mie.target->case_key);
+      break;
+    default:
+      break;
+    }
+  }
+  return seed;
+}
+
+size_t get_peak_rss_mb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss >> 20;
+#else
+  return usage.ru_maxrss >> 10;
+#endif
+}
+
+size_t get_rss_mb() {
+#ifdef __linux__
+  long size = 0;
+  long resident = 0;
+  auto statm = fopen("/proc/self/statm", "r");
+  if (statm != nullptr) {
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(statm);
+  }
+  return (resident * sysconf(_SC_PAGESIZE)) >> 20;
+#else
+  return get_peak_rss_mb();
+#endif
+}
+
 } // namespace
 
 void RedexOptions::serialize(Json::Value& entry_data) const {
@@ -129,12 +219,27 @@ void PassManager::init(const Json::Value& config) {
   }
 }
 
-void PassManager::run_type_checker(const Scope& scope,
-                                   bool polymorphic_constants,
-                                   bool verify_moves) {
+size_t PassManager::run_type_checker(const Scope& scope,
+                                     bool polymorphic_constants,
+                                     bool verify_moves) {
   TRACE(PM, 1, "Running IRTypeChecker...\n");
   Timer t("IRTypeChecker");
-  walk::parallel::methods(scope, [=](DexMethod* dex_method) {
+  std::atomic<size_t> checked{0};
+  std::atomic<size_t> skipped{0};
+  auto check = [&](DexMethod* dex_method, IRCode* code) {
+    if (code == nullptr) {
+      return;
+    }
+    // A new IRCode (e.g. from set_code) or a new epoch means the method was
+    // changed. Otherwise, it may still have been edited in place, which only
+    // the fingerprint tells us.
+    auto last = m_type_checked_code.get(dex_method, {nullptr, 0, 0});
+    auto changed = last.code != code || last.epoch != code->get_epoch();
+    auto fingerprint = code_fingerprint(dex_method, *code);
+    if (!changed && last.fingerprint == fingerprint) {
+      ++skipped;
+      return;
+    }
     IRTypeChecker checker(dex_method);
     if (polymorphic_constants) {
       checker.enable_polymorphic_constants();
@@ -147,10 +252,25 @@ void PassManager::run_type_checker(const Scope& scope,
       std::string msg = checker.what();
       fprintf(stderr, "ABORT! Inconsistency found in Dex code for %s.\n %s\n",
               SHOW(dex_method), msg.c_str());
-      fprintf(stderr, "Code:\n%s\n", SHOW(dex_method->get_code()));
+      fprintf(stderr, "Code:\n%s\n", SHOW(code));
       exit(EXIT_FAILURE);
     }
+    ++checked;
+    m_type_checked_code.insert_or_assign(std::make_pair(
+        dex_method, TypeCheckedCode{code, code->get_epoch(), fingerprint}));
+  };
+  walk::parallel::methods(scope, [&](DexMethod* dex_method) {
+    if (m_ir_spill) {
+      // Evicted code only comes back for the time of the check.
+      m_ir_spill->peek(dex_method,
+                       [&](IRCode* code) { check(dex_method, code); });
+    } else {
+      check(dex_method, dex_method->get_code());
+    }
   });
+  TRACE(PM, 1, "IRTypeChecker: checked %lu methods, skipped %lu unchanged\n",
+        checked.load(), skipped.load());
+  return skipped;
 }
 
 void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& cfg) {
@@ -215,8 +335,32 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& cfg) {
     trigger_passes.insert(trigger_pass.asString());
   }
 
+  bool concurrent_analysis;
+  cfg.get_json_config().get(
+      "concurrent_pass_analysis", false, concurrent_analysis);
+  // Index of the first pass whose analysis hasn't run yet.
+  size_t analyzed_end = 0;
+
+  cfg.get_json_config().get(
+      "memory_budget_mb", size_t(0), m_memory_budget.budget_mb);
+  if (m_memory_budget.budget_mb > 0) {
+    if (opt_metadata::OptDataMapper::get_instance().logs_enabled()) {
+      // The opt decision logs refer to the instructions that eviction frees.
+      fprintf(stderr, "WARNING: memory_budget_mb is ignored with opt decision "
+                      "logs enabled\n");
+    } else {
+      auto path = boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path("redex-ir-%%%%-%%%%-%%%%");
+      m_ir_spill = std::make_unique<ir_spill::IRSpill>(path.string());
+    }
+  }
+
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
+    if (pass->has_analysis() && i >= analyzed_end) {
+      analyzed_end = concurrent_analysis ? analysis_group_end(i) : i + 1;
+      run_analyses(build_class_scope(it), i, analyzed_end);
+    }
     TRACE(PM, 1, "Running %s...\n", pass->name().c_str());
     Timer t(pass->name() + " (run)");
     m_current_pass_info = &m_pass_info[i];
@@ -232,15 +376,51 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& cfg) {
 
     if (run_after_each_pass || trigger_passes.count(pass->name()) > 0) {
       scope = build_class_scope(it);
-      run_type_checker(scope, polymorphic_constants, verify_moves);
+      auto skipped =
+          run_type_checker(scope, polymorphic_constants, verify_moves);
+      incr_metric("type_checker_skipped_methods", skipped);
+    }
+
+    g_redex->compact_interning_tables();
+
+    // The analyses that already ran for the next passes may hold on to the
+    // code they looked at, so we wait until none is pending.
+    if (m_ir_spill && i + 1 >= analyzed_end) {
+      auto rss_mb = get_rss_mb();
+      scope = build_class_scope(it);
+      auto evicted =
+          m_ir_spill->sweep(scope, rss_mb > m_memory_budget.budget_mb);
+      TRACE(PM, 1, "RSS after %s: %lu MB, evicted the code of %lu methods\n",
+            pass->name().c_str(), rss_mb, evicted);
+      set_metric("rss_mb", rss_mb);
+      set_metric("ir_spill_evicted_methods", evicted);
+      m_memory_budget.evicted_methods += evicted;
     }
     m_current_pass_info = nullptr;
   }
 
+  // The backend needs all the code, so we bring it back in parallel rather than
+  // one method at a time as the backend gets to it.
+  if (m_ir_spill) {
+    m_ir_spill->restore_all();
+  }
+
   // Always run the type checker before generating the optimized dex code.
   scope = build_class_scope(it);
   run_type_checker(scope, polymorphic_constants, verify_moves);
 
+  if (m_memory_budget.budget_mb > 0) {
+    m_memory_budget.peak_rss_mb = get_peak_rss_mb();
+    if (m_ir_spill) {
+      m_memory_budget.restored_methods = m_ir_spill->restored_count();
+      // Nothing is evicted anymore. The spill must go before the methods it
+      // has records of are freed along with g_redex.
+      m_ir_spill.reset();
+    }
+    TRACE(PM, 1, "Peak RSS: %lu MB, memory budget: %lu MB\n",
+          m_memory_budget.peak_rss_mb, m_memory_budget.budget_mb);
+  }
+
   if (!cfg.get_printseeds().empty()) {
     Timer t("Writing outgoing classes to file " + cfg.get_printseeds() +
             ".outgoing");
@@ -278,6 +458,43 @@ Pass* PassManager::find_pass(const std::string& pass_name) const {
   return pass_it != m_activated_passes.end() ? *pass_it : nullptr;
 }
 
+size_t PassManager::analysis_group_end(size_t begin) const {
+  // A pass that appears twice in a row can't keep two analyses.
+  std::unordered_set<const Pass*> passes;
+  size_t end = begin;
+  while (end < m_activated_passes.size() &&
+         m_activated_passes[end]->has_analysis() &&
+         passes.insert(m_activated_passes[end]).second) {
+    ++end;
+  }
+  return end;
+}
+
+void PassManager::run_analyses(const Scope& scope, size_t begin, size_t end) {
+  std::string names;
+  for (size_t i = begin; i < end; ++i) {
+    names += (i == begin ? "" : ", ") + m_activated_passes[i]->name();
+  }
+  TRACE(PM, 1, "Analyzing %s...\n", names.c_str());
+  Timer t(names + " (analysis)");
+  if (end - begin == 1) {
+    m_activated_passes[begin]->analyze_pass(scope, *this);
+    return;
+  }
+  auto wq = workqueue_foreach<Pass*>(
+      [&](Pass* pass) { pass->analyze_pass(scope, *this); }, end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    wq.add_item(m_activated_passes[i]);
+  }
+  if (m_ir_spill) {
+    m_ir_spill->set_shared(true);
+  }
+  wq.run_all();
+  if (m_ir_spill) {
+    m_ir_spill->set_shared(false);
+  }
+}
+
 void PassManager::incr_metric(const std::string& key, int value) {
   always_assert_log(m_current_pass_info != nullptr, "No current pass!");
   (m_current_pass_info->metrics)[key] += value;
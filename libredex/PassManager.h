@@ -8,6 +8,8 @@
 #pragma once
 
 #include "ApkManager.h"
+#include "ConcurrentContainers.h"
+#include "IRSpill.h"
 #include "Pass.h"
 #include "ProguardConfiguration.h"
 
@@ -61,7 +63,7 @@ class PassManager {
   const std::unordered_map<std::string, int>& get_interdex_metrics();
 
   redex::ProguardConfiguration& get_proguard_config() { return *m_pg_config; }
-  bool no_proguard_rules() {
+  bool no_proguard_rules() const {
     return m_pg_config->keep_rules.empty() && !m_testing_mode;
   }
 
@@ -77,6 +79,18 @@ class PassManager {
 
   bool regalloc_has_run() { return m_regalloc_has_run; }
 
+  // How the run fared against the "memory_budget_mb" option.
+  struct MemoryBudgetStats {
+    size_t budget_mb{0};
+    size_t peak_rss_mb{0};
+    size_t evicted_methods{0};
+    size_t restored_methods{0};
+  };
+
+  const MemoryBudgetStats& get_memory_budget_stats() const {
+    return m_memory_budget;
+  }
+
  private:
   void activate_pass(const char* name, const Json::Value& cfg);
 
@@ -84,9 +98,18 @@ class PassManager {
 
   void init(const Json::Value& config);
 
-  static void run_type_checker(const Scope& scope,
-                               bool polymorphic_constants,
-                               bool verify_moves);
+  // The end of the run of passes with an analysis that starts at `begin`,
+  // whose analyses can run together.
+  size_t analysis_group_end(size_t begin) const;
+
+  // Runs the analyses of the passes in [begin, end) concurrently.
+  void run_analyses(const Scope& scope, size_t begin, size_t end);
+
+  // Type checks the methods whose code changed since they last passed the
+  // checker, and returns how many of them were skipped.
+  size_t run_type_checker(const Scope& scope,
+                          bool polymorphic_constants,
+                          bool verify_moves);
 
   ApkManager m_apk_mgr;
   std::vector<Pass*> m_registered_passes;
@@ -110,4 +133,19 @@ class PassManager {
 
   boost::optional<ProfilerInfo> m_profiler_info;
   Pass* m_malloc_profile_pass{nullptr};
+
+  // What the code of each method looked like when it last passed the type
+  // checker.
+  struct TypeCheckedCode {
+    const IRCode* code;
+    uint64_t epoch;
+    size_t fingerprint;
+  };
+  ConcurrentMap<const DexMethod*, TypeCheckedCode> m_type_checked_code;
+
+  // Where the code of the methods that the passes leave alone goes when the
+  // process grows beyond the memory budget. Freed once all the code is
+  // restored at the end of run_passes.
+  std::unique_ptr<ir_spill::IRSpill> m_ir_spill;
+  MemoryBudgetStats m_memory_budget;
 };
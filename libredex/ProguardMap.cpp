@@ -7,20 +7,18 @@
 
 #include "ProguardMap.h"
 
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
 #include "DexUtil.h"
 #include "Timer.h"
 #include "WorkQueue.h"
 
 namespace {
 
-std::string find_or_same(
-    const std::string& key,
-    const std::unordered_map<std::string, std::string>& map) {
-  auto it = map.find(key);
-  if (it == map.end()) return key;
-  return it->second;
-}
-
 std::string convert_scalar_type(std::string type) {
   static const std::unordered_map<std::string, std::string> prim_map =
     {{"void",    "V"},
@@ -143,15 +141,64 @@ bool is_maybe_proguard_generated_member(const std::string& s) {
 }
 } // namespace
 
+struct ProguardMap::ClassSection {
+  // The member lines. The first section holds whatever precedes the first
+  // class line (comments).
+  const char* begin;
+  const char* end;
+
+  std::string cls;
+  std::string new_cls;
+
+  std::vector<std::pair<std::string, std::string>> fields;
+  std::vector<std::pair<std::string, std::string>> methods;
+  std::vector<std::string> coalesced_interfaces;
+};
+
 ProguardMap::ProguardMap(const std::string& filename) {
   if (!filename.empty()) {
     Timer t("Parsing proguard map");
-    std::ifstream fp(filename);
-    always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
-    parse_proguard_map(fp);
+    // Empty files and the likes of /dev/null can't be mapped.
+    boost::system::error_code ec;
+    if (boost::filesystem::is_regular_file(filename, ec) &&
+        boost::filesystem::file_size(filename, ec) > 0) {
+      boost::iostreams::mapped_file_source file;
+      try {
+        file.open(filename);
+      } catch (const std::exception&) {
+      }
+      always_assert_log(file.is_open(), "Can't open proguard map: %s\n",
+                        filename.c_str());
+      parse_proguard_map(file.data(), file.size());
+    } else {
+      std::ifstream fp(filename);
+      always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
+      std::string contents((std::istreambuf_iterator<char>(fp)),
+                           std::istreambuf_iterator<char>());
+      parse_proguard_map(contents.data(), contents.size());
+    }
   }
 }
 
+ProguardMap::ProguardMap(std::istream& is) {
+  std::string contents((std::istreambuf_iterator<char>(is)),
+                       std::istreambuf_iterator<char>());
+  parse_proguard_map(contents.data(), contents.size());
+}
+
+const std::string* ProguardMap::intern(std::string name) {
+  return &*m_names.insert(std::move(name)).first;
+}
+
+std::string ProguardMap::find_or_same(const std::string& key,
+                                      const NameMap& map) const {
+  auto name = m_names.find(key);
+  if (name == m_names.end()) return key;
+  auto it = map.find(&*name);
+  if (it == map.end()) return key;
+  return *it->second;
+}
+
 std::string ProguardMap::translate_class(const std::string& cls) const {
   return find_or_same(cls, m_classMap);
 }
@@ -176,30 +223,81 @@ std::string ProguardMap::deobfuscate_method(const std::string& method) const {
   return find_or_same(method, m_obfMethodMap);
 }
 
-void ProguardMap::parse_proguard_map(std::istream& fp) {
+void ProguardMap::parse_proguard_map(const char* data, size_t size) {
+  const char* end = data + size;
+  auto next_line = [end](const char* line) {
+    auto eol = static_cast<const char*>(memchr(line, '\n', end - line));
+    return eol == nullptr ? end : eol + 1;
+  };
+  auto line_end = [](const char* line, const char* next) {
+    return next > line && next[-1] == '\n' ? next - 1 : next;
+  };
+
+  // The members of a class are translated using the mapping of all the
+  // classes, so we parse the class lines first. Members are indented, so
+  // those are the lines starting with anything else.
+  std::vector<ClassSection> sections(1);
+  sections.back().begin = data;
   std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
+  for (const char* p = data; p < end;) {
+    auto next = next_line(p);
+    if (!isspace(*p)) {
+      line.assign(p, line_end(p, next));
+      if (parse_class(line)) {
+        sections.back().end = p;
+        sections.emplace_back();
+        auto& section = sections.back();
+        section.begin = next;
+        section.cls = m_currClass;
+        section.new_cls = m_currNewClass;
+      }
+    }
+    p = next;
   }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class(line)) {
-      continue;
+  sections.back().end = end;
+
+  // The members of each class can then be parsed in parallel.
+  auto wq = workqueue_foreach<ClassSection*>([&](ClassSection* section) {
+    std::string line;
+    for (const char* p = section->begin; p < section->end;) {
+      auto next = next_line(p);
+      line.assign(p, line_end(p, next));
+      p = next;
+      if (parse_field(line, *section)) {
+        continue;
+      }
+      if (parse_method(line, *section)) {
+        continue;
+      }
+      if (comment(line)) {
+        continue;
+      }
+      always_assert_log(false,
+                        "Bogus line encountered in proguard map: %s\n",
+                        line.c_str());
     }
-    if (parse_field(line)) {
-      continue;
+  });
+  for (auto& section : sections) {
+    wq.add_item(&section);
+  }
+  wq.run_all();
+
+  for (auto& section : sections) {
+    for (auto& field : section.fields) {
+      auto pgold = intern(std::move(field.first));
+      auto pgnew = intern(std::move(field.second));
+      m_fieldMap[pgold] = pgnew;
+      m_obfFieldMap[pgnew] = pgold;
     }
-    if (parse_method(line)) {
-      continue;
+    for (auto& method : section.methods) {
+      auto pgold = intern(std::move(method.first));
+      auto pgnew = intern(std::move(method.second));
+      m_methodMap[pgold] = pgnew;
+      m_obfMethodMap[pgnew] = pgold;
     }
-    if (comment(line)) {
-      continue;
+    for (const auto& type : section.coalesced_interfaces) {
+      m_pg_coalesced_interfaces.insert(type);
     }
-    always_assert_log(false,
-                      "Bogus line encountered in proguard map: %s\n",
-                      line.c_str());
   }
 }
 
@@ -212,12 +310,15 @@ bool ProguardMap::parse_class(const std::string& line) {
   if (!id(p, newname)) return false;
   m_currClass = convert_type(classname);
   m_currNewClass = convert_type(newname);
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  auto cls = intern(m_currClass);
+  auto new_cls = intern(m_currNewClass);
+  m_classMap[cls] = new_cls;
+  m_obfClassMap[new_cls] = cls;
   return true;
 }
 
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              ClassSection& section) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -232,22 +333,22 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
+  auto pgnew = convert_field(section.new_cls, xtype, newname);
+  auto pgold = convert_field(section.cls, ctype, fieldname);
   // Record interfaces that are coalesced by Proguard.
   if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
     fprintf(stderr,
             "Type '%s' is touched by Proguard in '%s'\n",
             ctype.c_str(),
             pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
+    section.coalesced_interfaces.push_back(ctype);
   }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
+  section.fields.emplace_back(std::move(pgold), std::move(pgnew));
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               ClassSection& section) const {
   std::string type;
   std::string methodname;
   std::string old_args;
@@ -288,10 +389,9 @@ bool ProguardMap::parse_method(const std::string& line) {
 
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
-  auto pgold = convert_method(m_currClass, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
+  auto pgold = convert_method(section.cls, old_rtype, methodname, old_args);
+  auto pgnew = convert_method(section.new_cls, new_rtype, newname, new_args);
+  section.methods.emplace_back(std::move(pgold), std::move(pgnew));
   return true;
 }
 
@@ -39,16 +39,15 @@
  */
 struct ProguardMap {
   /**
-   * Construct map from the given file.
+   * Construct map from the given file. The file is memory-mapped and its
+   * classes are parsed in parallel.
    */
   explicit ProguardMap(const std::string& filename);
 
   /**
    * Construct map from a given stream.
    */
-  explicit ProguardMap(std::istream& is) {
-    parse_proguard_map(is);
-  }
+  explicit ProguardMap(std::istream& is);
 
   /**
    * Translate un-obfuscated class name to obfuscated name.
@@ -89,26 +88,40 @@ struct ProguardMap {
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
+  // Names are interned in m_names, so that a name shared by several maps (e.g.
+  // the two directions of a mapping) is only stored once.
+  using NameMap = std::unordered_map<const std::string*, const std::string*>;
+
+  // The members of one class of the mapping, parsed independently of the
+  // other classes.
+  struct ClassSection;
+
+  void parse_proguard_map(const char* data, size_t size);
 
   bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+  bool parse_field(const std::string& line, ClassSection& section) const;
+  bool parse_method(const std::string& line, ClassSection& section) const;
+
+  const std::string* intern(std::string name);
+  std::string find_or_same(const std::string& key, const NameMap& map) const;
 
  private:
+  std::unordered_set<std::string> m_names;
+
   // Unobfuscated to obfuscated maps
-  std::unordered_map<std::string, std::string> m_classMap;
-  std::unordered_map<std::string, std::string> m_fieldMap;
-  std::unordered_map<std::string, std::string> m_methodMap;
+  NameMap m_classMap;
+  NameMap m_fieldMap;
+  NameMap m_methodMap;
 
   // Obfuscated to unobfuscated maps from proguard
-  std::unordered_map<std::string, std::string> m_obfClassMap;
-  std::unordered_map<std::string, std::string> m_obfFieldMap;
-  std::unordered_map<std::string, std::string> m_obfMethodMap;
+  NameMap m_obfClassMap;
+  NameMap m_obfFieldMap;
+  NameMap m_obfMethodMap;
 
   // Interfaces that are (most likely) coalesced by Proguard.
   std::unordered_set<std::string> m_pg_coalesced_interfaces;
 
+  // The last class line parsed, while splitting the map into sections.
   std::string m_currClass;
   std::string m_currNewClass;
 };
@@ -469,6 +469,41 @@ IgnoreSets::IgnoreSets(const JsonWrapper& jw) {
   system_annos.emplace(DexType::get_type("Ldalvik/annotation/MemberClasses;"));
 }
 
+namespace {
+
+std::vector<const DexClass*> scope_classes(const Scope& scope) {
+  return std::vector<const DexClass*>(scope.begin(), scope.end());
+}
+
+std::vector<const DexFieldRef*> scope_fields(const Scope& scope) {
+  std::vector<const DexFieldRef*> fields;
+  for (auto cls : scope) {
+    fields.insert(fields.end(), cls->get_ifields().begin(),
+                  cls->get_ifields().end());
+    fields.insert(fields.end(), cls->get_sfields().begin(),
+                  cls->get_sfields().end());
+  }
+  return fields;
+}
+
+std::vector<const DexMethodRef*> scope_methods(const Scope& scope) {
+  std::vector<const DexMethodRef*> methods;
+  for (auto cls : scope) {
+    methods.insert(methods.end(), cls->get_dmethods().begin(),
+                   cls->get_dmethods().end());
+    methods.insert(methods.end(), cls->get_vmethods().begin(),
+                   cls->get_vmethods().end());
+  }
+  return methods;
+}
+
+} // namespace
+
+ReachableObjects::ReachableObjects(const Scope& scope)
+    : m_marked_classes(scope_classes(scope)),
+      m_marked_fields(scope_fields(scope)),
+      m_marked_methods(scope_methods(scope)) {}
+
 std::unique_ptr<ReachableObjects> compute_reachable_objects(
     DexStoresVector& stores,
     const IgnoreSets& ignore_sets,
@@ -476,7 +511,7 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool record_reachability) {
   Timer t("Marking");
   auto scope = build_class_scope(stores);
-  auto reachable_objects = std::make_unique<ReachableObjects>();
+  auto reachable_objects = std::make_unique<ReachableObjects>(scope);
   ConditionallyMarked cond_marked;
   auto method_override_graph = mog::build_graph(scope);
 
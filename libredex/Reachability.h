@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "ConcurrentContainers.h"
 #include "DexClass.h"
@@ -88,8 +92,112 @@ using ReachableObjectSet =
 using ReachableObjectGraph =
     ConcurrentMap<ReachableObject, ReachableObjectSet, ReachableObjectHash>;
 
+/*
+ * A concurrent set of objects of one kind, optimized for the objects defined
+ * in the scope being analyzed. Those are numbered when the set is created,
+ * by their slot in an open-addressing table, and membership is a bit that is
+ * set atomically. Marking them takes neither a lock nor an allocation. Other
+ * objects (e.g. refs to external methods) are kept in a ConcurrentSet.
+ */
+template <class T>
+class MarkedSet {
+ public:
+  explicit MarkedSet(const std::vector<const T*>& universe) {
+    size_t log2_capacity = 1;
+    while ((size_t(1) << log2_capacity) < 2 * universe.size()) {
+      ++log2_capacity;
+    }
+    m_shift = 64 - log2_capacity;
+    m_slots.resize(size_t(1) << log2_capacity, nullptr);
+    for (auto obj : universe) {
+      size_t mask = m_slots.size() - 1;
+      for (size_t i = hash(obj); m_slots[i] != obj; i = (i + 1) & mask) {
+        if (m_slots[i] == nullptr) {
+          m_slots[i] = obj;
+          break;
+        }
+      }
+    }
+    m_num_words = (m_slots.size() + 63) / 64;
+    m_bits = std::make_unique<std::atomic<uint64_t>[]>(m_num_words);
+    for (size_t i = 0; i < m_num_words; ++i) {
+      m_bits[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /*
+   * Returns true if the object was not in the set yet.
+   */
+  bool insert(const T* obj) {
+    auto slot = find_slot(obj);
+    if (slot == NONE) {
+      return m_others.insert(obj);
+    }
+    auto bit = uint64_t(1) << (slot % 64);
+    return !(m_bits[slot / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
+  }
+
+  bool contains(const T* obj) const {
+    auto slot = find_slot(obj);
+    if (slot == NONE) {
+      return m_others.count(obj);
+    }
+    return test(slot);
+  }
+
+  /*
+   * Only safe when no other thread is inserting objects that aren't part of
+   * the numbered scope.
+   */
+  bool contains_unsafe(const T* obj) const {
+    auto slot = find_slot(obj);
+    if (slot == NONE) {
+      return m_others.count_unsafe(obj);
+    }
+    return test(slot);
+  }
+
+ private:
+  static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+  size_t hash(const T* obj) const {
+    // Fibonacci hashing; the low bits of the pointers are always zero.
+    return (reinterpret_cast<uintptr_t>(obj) * 0x9E3779B97F4A7C15ull) >>
+           m_shift;
+  }
+
+  size_t find_slot(const T* obj) const {
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash(obj);; i = (i + 1) & mask) {
+      if (m_slots[i] == obj) {
+        return i;
+      }
+      if (m_slots[i] == nullptr) {
+        return NONE;
+      }
+    }
+  }
+
+  bool test(size_t slot) const {
+    auto bit = uint64_t(1) << (slot % 64);
+    return m_bits[slot / 64].load(std::memory_order_relaxed) & bit;
+  }
+
+  size_t m_shift;
+  std::vector<const T*> m_slots;
+  size_t m_num_words;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_bits;
+  ConcurrentSet<const T*> m_others;
+};
+
 class ReachableObjects {
  public:
+  /*
+   * The classes, fields and methods defined in `scope` are tracked in dense
+   * bitsets.
+   */
+  explicit ReachableObjects(const Scope& scope);
+
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
 
   void mark(const DexClass* cls) { m_marked_classes.insert(cls); }
@@ -98,26 +206,28 @@ class ReachableObjects {
 
   void mark(const DexFieldRef* field) { m_marked_fields.insert(field); }
 
-  bool marked(const DexClass* cls) const { return m_marked_classes.count(cls); }
+  bool marked(const DexClass* cls) const {
+    return m_marked_classes.contains(cls);
+  }
 
   bool marked(const DexMethodRef* method) const {
-    return m_marked_methods.count(method);
+    return m_marked_methods.contains(method);
   }
 
   bool marked(const DexFieldRef* field) const {
-    return m_marked_fields.count(field);
+    return m_marked_fields.contains(field);
   }
 
   bool marked_unsafe(const DexClass* cls) const {
-    return m_marked_classes.count_unsafe(cls);
+    return m_marked_classes.contains_unsafe(cls);
   }
 
   bool marked_unsafe(const DexMethodRef* method) const {
-    return m_marked_methods.count_unsafe(method);
+    return m_marked_methods.contains_unsafe(method);
   }
 
   bool marked_unsafe(const DexFieldRef* field) const {
-    return m_marked_fields.count_unsafe(field);
+    return m_marked_fields.contains_unsafe(field);
   }
 
  private:
@@ -134,9 +244,9 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  ConcurrentSet<const DexClass*> m_marked_classes;
-  ConcurrentSet<const DexFieldRef*> m_marked_fields;
-  ConcurrentSet<const DexMethodRef*> m_marked_methods;
+  MarkedSet<DexClass> m_marked_classes;
+  MarkedSet<DexFieldRef> m_marked_fields;
+  MarkedSet<DexMethodRef> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
@@ -12,6 +12,7 @@
 #include <regex>
 #include <unordered_set>
 
+#include "ClassHierarchy.h"
 #include "Debug.h"
 #include "DexClass.h"
 
@@ -379,6 +380,29 @@ void RedexContext::publish_class(DexClass* cls) {
     }
   }
   m_type_to_class.emplace(type, cls);
+  m_external_hierarchy.reset();
+}
+
+std::shared_ptr<const ExternalHierarchy> RedexContext::external_hierarchy() {
+  std::lock_guard<std::mutex> l(m_type_system_mutex);
+  if (!m_external_hierarchy) {
+    std::vector<const DexClass*> classes;
+    for (const auto& type_cls : m_type_to_class) {
+      if (type_cls.second->is_external()) {
+        classes.push_back(type_cls.second);
+      }
+    }
+    m_external_hierarchy =
+        std::make_shared<ExternalHierarchy>(build_external_hierarchy(classes));
+  }
+  return m_external_hierarchy;
+}
+
+void RedexContext::compact_interning_tables() {
+  s_type_map.compact();
+  s_field_map.compact();
+  s_proto_map.compact();
+  s_method_map.compact();
 }
 
 DexClass* RedexContext::type_class(const DexType* t) {
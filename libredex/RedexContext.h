@@ -14,6 +14,7 @@
 #include <functional>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <unordered_map>
@@ -34,6 +35,7 @@ class DexClass;
 struct DexFieldSpec;
 struct DexDebugEntry;
 struct DexPosition;
+struct ExternalHierarchy;
 struct RedexContext;
 
 extern RedexContext* g_redex;
@@ -101,6 +103,18 @@ struct RedexContext {
     }
   }
 
+  /*
+   * The hierarchy of the external classes, see ClassHierarchy.h. It is built
+   * on first use and rebuilt after a class is published.
+   */
+  std::shared_ptr<const ExternalHierarchy> external_hierarchy();
+
+  /*
+   * Frees what renames and erasures left behind in the interning tables.
+   * Nothing may be looking up types, fields, protos or methods meanwhile.
+   */
+  void compact_interning_tables();
+
   /*
    * This returns true if we want to preserve keep reasons for better
    * diagnostics.
@@ -168,11 +182,15 @@ struct RedexContext {
   // DexString
   ConcurrentLargeStringMap<DexString*> s_string_map;
 
+  // The interning tables are looked up far more often than they grow, from
+  // all the worker threads, so their lookups don't take locks. The renames of
+  // the passes replace their entries, so they are compacted between passes.
+
   // DexType
-  ConcurrentMap<DexString*, DexType*> s_type_map;
+  ReadMostlyConcurrentMap<DexString*, DexType*> s_type_map;
 
   // DexFieldRef
-  ConcurrentMap<DexFieldSpec, DexFieldRef*> s_field_map;
+  ReadMostlyConcurrentMap<DexFieldSpec, DexFieldRef*> s_field_map;
   std::mutex s_field_lock;
 
   // DexTypeList
@@ -183,15 +201,17 @@ struct RedexContext {
 
   // DexProto
   using ProtoKey = std::pair<DexType*, DexTypeList*>;
-  ConcurrentMap<ProtoKey, DexProto*, boost::hash<ProtoKey>> s_proto_map;
+  ReadMostlyConcurrentMap<ProtoKey, DexProto*, boost::hash<ProtoKey>>
+      s_proto_map;
 
   // DexMethod
-  ConcurrentMap<DexMethodSpec, DexMethodRef*> s_method_map;
+  ReadMostlyConcurrentMap<DexMethodSpec, DexMethodRef*> s_method_map;
   std::mutex s_method_lock;
 
   // Type-to-class map and class hierarchy
   std::mutex m_type_system_mutex;
   std::unordered_map<const DexType*, DexClass*> m_type_to_class;
+  std::shared_ptr<const ExternalHierarchy> m_external_hierarchy;
 
   const std::vector<const DexType*> m_empty_types;
 
@@ -47,6 +47,7 @@
 
 #include "Debug.h"
 #include "StringUtil.h"
+#include "WorkQueue.h"
 
 constexpr size_t MIN_CLASSNAME_LENGTH = 10;
 constexpr size_t MAX_CLASSNAME_LENGTH = 500;
@@ -127,15 +128,20 @@ std::string dotname_to_dexname(const std::string& classname) {
 
 void extract_by_pattern(
     const std::string& string_to_search,
-    boost::regex regex,
+    const boost::regex& regex,
     std::unordered_set<std::string>& result) {
-  boost::smatch m;
-  std::string s = string_to_search;
-  while (boost::regex_search (s, m, regex)) {
+  // Iterate over the matches in place; searching a copy of what follows each
+  // match is quadratic in the size of the file.
+  for (boost::sregex_iterator it(string_to_search.begin(),
+                                 string_to_search.end(),
+                                 regex),
+       end;
+       it != end;
+       ++it) {
+    const auto& m = *it;
     if (m.size() > 1) {
-        result.insert(m[1].str());
+      result.insert(m[1].str());
     }
-    s = m.suffix().str();
   }
 }
 
@@ -162,7 +168,7 @@ void extract_js_asset_registrations(
   static boost::regex special_char_regex("[^a-z0-9_]");
   std::unordered_set<std::string> registrations;
   extract_by_pattern(file_contents, register_regex, registrations);
-  for (std::string registration : registrations) {
+  for (const auto& registration : registrations) {
     boost::smatch m;
     if (!boost::regex_search (registration, m, location_regex) || m.size() == 0) {
       continue;
@@ -671,7 +677,7 @@ std::unordered_set<std::string> get_candidate_js_resources_from_assets_list(
 
 std::unordered_set<uint32_t> get_apk_resources_from_candidates(
   const std::unordered_set<std::string>& candidate_resources,
-  std::map<std::string, std::vector<uint32_t>> name_to_ids
+  const std::map<std::string, std::vector<uint32_t>>& name_to_ids
 ) {
   // The actual resources are the intersection of the real resources and the
   // candidate resources (since our current javascript processing produces
@@ -687,8 +693,9 @@ std::unordered_set<uint32_t> get_apk_resources_from_candidates(
     }
   } else {
     for (auto& name : candidate_resources) {
-      if (name_to_ids.find(name) != name_to_ids.end()) {
-        apk_resources.insert(name_to_ids[name].begin(), name_to_ids[name].end());
+      auto it = name_to_ids.find(name);
+      if (it != name_to_ids.end()) {
+        apk_resources.insert(it->second.begin(), it->second.end());
       }
     }
   }
@@ -696,48 +703,35 @@ std::unordered_set<uint32_t> get_apk_resources_from_candidates(
   return apk_resources;
 }
 
-// Uses an explicitly provided file to list resources referenced in js.
-std::unordered_set<uint32_t> get_js_resources_from_assets_lists(
+// Parses the content of all .js files and reads the explicitly provided
+// assets lists, in parallel, to find all the resources referenced in js.
+std::unordered_set<uint32_t> get_js_resources(
+    const std::string& directory,
     const std::vector<std::string>& js_assets_lists,
     const std::map<std::string, std::vector<uint32_t>>& name_to_ids) {
-  std::unordered_set<std::string> js_candidate_resources;
-  for (const auto& f : js_assets_lists) {
-    auto c = get_candidate_js_resources_from_assets_list(f);
-    js_candidate_resources.insert(c.begin(), c.end());
+  auto js_files = get_js_files(directory);
+  std::vector<std::string> bundles(js_files.begin(), js_files.end());
+  std::vector<std::unordered_set<std::string>> candidates(
+      bundles.size() + js_assets_lists.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    candidates[i] =
+        i < bundles.size()
+            ? get_candidate_js_resources_from_bundle(bundles[i])
+            : get_candidate_js_resources_from_assets_list(
+                  js_assets_lists[i - bundles.size()]);
+  });
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    wq.add_item(i);
   }
-  return get_apk_resources_from_candidates(js_candidate_resources, name_to_ids);
-}
+  wq.run_all();
 
-// Parses the content of all .js files and extracts all resources referenced.
-std::unordered_set<uint32_t> get_js_resources_by_parsing(
-    const std::string& directory,
-    const std::map<std::string, std::vector<uint32_t>>& name_to_ids) {
   std::unordered_set<std::string> js_candidate_resources;
-  for (auto& f : get_js_files(directory)) {
-    auto c = get_candidate_js_resources_from_bundle(f);
+  for (const auto& c : candidates) {
     js_candidate_resources.insert(c.begin(), c.end());
   }
-
   return get_apk_resources_from_candidates(js_candidate_resources, name_to_ids);
 }
 
-std::unordered_set<uint32_t> get_js_resources(
-    const std::string& directory,
-    const std::vector<std::string>& js_assets_lists,
-    const std::map<std::string, std::vector<uint32_t>>& name_to_ids) {
-  std::unordered_set<uint32_t> assets_from_js_files = get_js_resources_by_parsing(
-      directory,
-      name_to_ids);
-  std::unordered_set<uint32_t> assets_from_js_list_files = get_js_resources_from_assets_lists(
-      js_assets_lists,
-      name_to_ids);
-
-  std::unordered_set<uint32_t> js_assets;
-  js_assets.insert(assets_from_js_files.begin(), assets_from_js_files.end());
-  js_assets.insert(assets_from_js_list_files.begin(), assets_from_js_list_files.end());
-  return js_assets;
-}
-
 std::unordered_set<uint32_t> get_resources_by_name_prefix(
     const std::vector<std::string>& prefixes,
     const std::map<std::string, std::vector<uint32_t>>& name_to_ids) {
@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ScratchAllocator.h"
+
+#include <algorithm>
+
+namespace scratch {
+
+void* Arena::allocate_in_next_chunk(size_t size) {
+  size_t next = m_chunks.empty() ? 0 : m_current + 1;
+  // Chunks we rewound past are reused if they are large enough. An oversized
+  // request gets a chunk of its own in front of them.
+  if (next == m_chunks.size() || m_chunks[next].size < size) {
+    size_t chunk_size = std::max(kChunkSize, size);
+    m_chunks.insert(m_chunks.begin() + next,
+                    Chunk{std::unique_ptr<char[]>(new char[chunk_size]),
+                          chunk_size});
+  }
+  m_current = next;
+  m_used = size;
+  return m_chunks[m_current].data.get();
+}
+
+void Arena::rewind(const Mark& mark) {
+  m_current = mark.chunk;
+  m_used = mark.used;
+  if (m_current == 0 && m_used == 0 && m_chunks.size() > kRetainedChunks) {
+    m_chunks.resize(kRetainedChunks);
+  }
+}
+
+size_t Arena::capacity() const {
+  size_t capacity = 0;
+  for (const auto& chunk : m_chunks) {
+    capacity += chunk.size;
+  }
+  return capacity;
+}
+
+Arena& arena() {
+  thread_local Arena s_arena;
+  return s_arena;
+}
+
+} // namespace scratch
@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "Debug.h"
+
+/*
+ * Memory for the scratch state of per-method analyses.
+ *
+ * Most of what an analysis allocates while it looks at a method -- per-block
+ * state, worklists, graphs -- is dropped all at once when it is done. Each
+ * thread has an arena that hands out such memory by bumping a pointer and
+ * takes it all back when the enclosing scratch::Scope ends, instead of going
+ * through malloc and free for every node. The walk:: functions open a scope
+ * around each method they visit.
+ *
+ * Whatever is allocated from the arena must be destroyed before the scope it
+ * was allocated in ends. In particular it must not be stored anywhere that
+ * outlives the analysis of the method, and a container that uses the arena
+ * must not grow inside a walker callback unless it was created there.
+ */
+namespace scratch {
+
+class Arena {
+ public:
+  static constexpr size_t kChunkSize = 64 * 1024;
+  // How much of its memory the arena holds on to once all scopes have ended.
+  static constexpr size_t kRetainedChunks = 16;
+
+  struct Mark {
+    size_t chunk;
+    size_t used;
+  };
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t size, size_t alignment) {
+    always_assert(alignment <= alignof(std::max_align_t));
+    if (m_current < m_chunks.size()) {
+      size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+      if (start + size <= m_chunks[m_current].size) {
+        m_used = start + size;
+        return m_chunks[m_current].data.get() + start;
+      }
+    }
+    return allocate_in_next_chunk(size);
+  }
+
+  Mark mark() const { return Mark{m_current, m_used}; }
+
+  // Frees everything that was allocated since `mark` was taken.
+  void rewind(const Mark& mark);
+
+  // The size of all the chunks, used or not.
+  size_t capacity() const;
+
+ private:
+  void* allocate_in_next_chunk(size_t size);
+
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+  std::vector<Chunk> m_chunks;
+  // The chunk we are allocating from, and how much of it is taken.
+  size_t m_current{0};
+  size_t m_used{0};
+};
+
+// The arena of the calling thread.
+Arena& arena();
+
+/*
+ * Frees everything allocated from the arena of the thread during its
+ * lifetime. Scopes nest.
+ */
+class Scope {
+ public:
+  Scope() : m_arena(arena()), m_mark(m_arena.mark()) {}
+  ~Scope() { m_arena.rewind(m_mark); }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  Arena& m_arena;
+  Arena::Mark m_mark;
+};
+
+/*
+ * An STL allocator on the arena of the thread that creates it. Deallocation
+ * does nothing; the memory comes back when the scope ends.
+ */
+template <typename T>
+class Allocator {
+ public:
+  using value_type = T;
+
+  Allocator() : m_arena(&arena()) {}
+
+  template <typename U>
+  Allocator(const Allocator<U>& other) : m_arena(other.m_arena) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const Allocator<U>& other) const {
+    return m_arena == other.m_arena;
+  }
+
+  template <typename U>
+  bool operator!=(const Allocator<U>& other) const {
+    return m_arena != other.m_arena;
+  }
+
+ private:
+  template <typename U>
+  friend class Allocator;
+
+  Arena* m_arena;
+};
+
+/*
+ * Recycles the memory of objects of type T that are created and destroyed in
+ * large numbers, but whose lifetime isn't tied to a scope, like the blocks and
+ * edges of control flow graphs. Freed objects go to a list of the thread that
+ * frees them, which it then allocates from before calling operator new.
+ */
+template <typename T>
+class Pool {
+ public:
+  static void* allocate(size_t size) {
+    auto& list = free_list();
+    if (size != sizeof(T) || list.head == nullptr) {
+      return ::operator new(size);
+    }
+    auto* node = list.head;
+    list.head = node->next;
+    --list.size;
+    return node;
+  }
+
+  static void deallocate(void* p, size_t size) {
+    auto& list = free_list();
+    if (size != sizeof(T) || list.size >= kMaxFree) {
+      ::operator delete(p);
+      return;
+    }
+    auto* node = static_cast<Node*>(p);
+    node->next = list.head;
+    list.head = node;
+    ++list.size;
+  }
+
+ private:
+  static constexpr size_t kMaxFree = 4096;
+
+  struct Node {
+    Node* next;
+  };
+  static_assert(sizeof(T) >= sizeof(Node), "Too small to pool");
+
+  struct FreeList {
+    ~FreeList() {
+      while (head != nullptr) {
+        auto* node = head;
+        head = node->next;
+        ::operator delete(node);
+      }
+      // Objects freed after this on the same thread aren't recycled.
+      size = kMaxFree;
+    }
+    Node* head{nullptr};
+    size_t size{0};
+  };
+
+  static FreeList& free_list() {
+    thread_local FreeList s_free_list;
+    return s_free_list;
+  }
+};
+
+} // namespace scratch
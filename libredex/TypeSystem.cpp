@@ -40,30 +40,12 @@ void make_instanceof_table(
   }
 }
 
-void load_interface_children(ClassHierarchy& children, const DexClass* intf) {
-  for (const auto& super_intf : intf->get_interfaces()->get_type_list()) {
-    children[super_intf].insert(intf->get_type());
-    const auto super_intf_cls = type_class(super_intf);
-    if (super_intf_cls != nullptr) {
-      load_interface_children(children, super_intf_cls);
-    }
-  }
-}
-
-void load_interface_children(ClassHierarchy& children) {
-  g_redex->walk_type_class(
-      [&](const DexType* type, const DexClass* cls) {
-        if (!cls->is_external() || !is_interface(cls)) return;
-        load_interface_children(children, cls);
-      });
-}
-
 void load_interface_children(const Scope& scope, ClassHierarchy& children) {
+  children = g_redex->external_hierarchy()->interface_children;
   for (const auto& cls : scope) {
     if (!is_interface(cls)) continue;
     load_interface_children(children, cls);
   }
-  load_interface_children(children);
 }
 
 }
@@ -17,7 +17,9 @@
 #include "DexClass.h"
 #include "EditableCfgAdapter.h"
 #include "IRCode.h"
+#include "IRSpill.h"
 #include "Match.h"
+#include "ScratchAllocator.h"
 #include "WorkQueue.h"
 
 /**
@@ -41,6 +43,8 @@ class walk {
   using MethodFilterFn = const std::function<bool(DexMethod*)>&;
   using CodeWalkerFn = const std::function<void(DexMethod*, IRCode&)>&;
   using InsnWalkerFn = const std::function<void(DexMethod*, IRInstruction*)>&;
+  using ConstInsnWalkerFn =
+      const std::function<void(const DexMethod*, const IRInstruction*)>&;
   using AnnotationWalkerFn = const std::function<void(DexAnnotation*)>&;
   using MatchingInBlockWalkerFn = const std::function<void(
       DexMethod*, cfg::Block*, const std::vector<IRInstruction*>&)>&;
@@ -117,6 +121,33 @@ class walk {
     walk::opcodes(classes, all_methods, walker);
   }
 
+  /**
+   * Like `opcodes()`, for walkers that only read the instructions and keep no
+   * pointer to them once they return. The code that the memory budget mode
+   * evicted (see IRSpill.h) only comes back for the time of the call, so the
+   * walk doesn't make the whole app resident again.
+   */
+  template <class Classes>
+  static void read_opcodes(const Classes& classes, ConstInsnWalkerFn walker) {
+    auto spill = ir_spill::IRSpill::get();
+    walk::methods(classes, [&](DexMethod* m) {
+      auto read = [&](IRCode* code) {
+        if (code == nullptr) {
+          return;
+        }
+        editable_cfg_adapter::iterate(code, [&](MethodItemEntry* mie) {
+          walker(m, mie->insn);
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        });
+      };
+      if (spill != nullptr) {
+        spill->peek(m, read);
+      } else {
+        read(m->get_code());
+      }
+    });
+  }
+
   /**
    * Call `walker` on every annotation on the classes (and its fields, methods,
    * and method parameters) defined in `classes`
@@ -218,10 +249,12 @@ class walk {
   static void iterate_methods(const DexClass* cls, MethodWalkerFn walker) {
     for (auto dmethod : cls->get_dmethods()) {
       TraceContext context(dmethod->get_deobfuscated_name());
+      scratch::Scope scratch_scope;
       walker(dmethod);
     }
     for (auto vmethod : cls->get_vmethods()) {
       TraceContext context(vmethod->get_deobfuscated_name());
+      scratch::Scope scratch_scope;
       walker(vmethod);
     }
   }
@@ -416,10 +449,12 @@ class walk {
             Output out = init;
             for (auto dmethod : cls->get_dmethods()) {
               TraceContext context(dmethod->get_deobfuscated_name());
+              scratch::Scope scratch_scope;
               out = reducer(out, walker(dmethod));
             }
             for (auto vmethod : cls->get_vmethods()) {
               TraceContext context(vmethod->get_deobfuscated_name());
+              scratch::Scope scratch_scope;
               out = reducer(out, walker(vmethod));
             }
             return out;
@@ -474,6 +509,31 @@ class walk {
       walk::parallel::code(classes, all_methods, walker, num_threads);
     }
 
+    /**
+     * Same as `code()`, but schedules each method on its own, the ones with
+     * the most code first. Meant for walks whose cost is dominated by a few
+     * huge methods, which would otherwise be left for last with the rest of
+     * their class on a single thread.
+     */
+    template <class Classes>
+    static void code_by_size(const Classes& classes,
+                             CodeWalkerFn walker,
+                             size_t num_threads = default_num_threads()) {
+      auto wq = workqueue_foreach<DexMethod*>(
+          [&walker](DexMethod* m) {
+            TraceContext context(m->get_deobfuscated_name());
+            scratch::Scope scratch_scope;
+            walker(m, *m->get_code());
+          },
+          num_threads);
+      // Items are dealt round-robin to the threads' queues, so every thread
+      // starts with the largest methods and idle threads steal the small ones.
+      for (auto* m : methods_by_code_size(classes)) {
+        wq.add_item(m);
+      }
+      wq.run_all();
+    }
+
     /**
      * Call `walker` on all opcodes (of methods approved by `filter`) in
      * `classes` in parallel.
@@ -576,5 +636,28 @@ class walk {
       };
       wq.run_all();
     }
+
+    template <class Classes>
+    static std::vector<DexMethod*> methods_by_code_size(
+        const Classes& classes) {
+      std::vector<std::pair<size_t, DexMethod*>> sized;
+      for (const auto& cls : classes) {
+        walk::iterate_code(cls, all_methods, [&sized](DexMethod* m,
+                                                      IRCode& code) {
+          sized.emplace_back(code.count_entries(), m);
+        });
+      }
+      std::stable_sort(sized.begin(), sized.end(),
+                       [](const std::pair<size_t, DexMethod*>& a,
+                          const std::pair<size_t, DexMethod*>& b) {
+                         return a.first > b.first;
+                       });
+      std::vector<DexMethod*> methods;
+      methods.reserve(sized.size());
+      for (const auto& pair : sized) {
+        methods.push_back(pair.second);
+      }
+      return methods;
+    }
   };
 };
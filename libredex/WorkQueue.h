@@ -110,7 +110,8 @@ class WorkQueue {
       Mapper mapper,
       std::function<Output(Output, Output)> reducer,
       std::function<Data(unsigned int /* thread index*/)> data_initializer,
-      unsigned int num_threads);
+      unsigned int num_threads =
+          std::max(1u, boost::thread::hardware_concurrency()));
 
   void add_item(Input task);
 
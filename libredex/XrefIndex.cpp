@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "XrefIndex.h"
+
+#include <algorithm>
+
+#include "IRCode.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace xref {
+
+namespace {
+
+template <typename T>
+const Xrefs& find_or_empty(const std::unordered_map<T*, Xrefs>& map,
+                           T* item) {
+  static const Xrefs empty;
+  auto it = map.find(item);
+  return it == map.end() ? empty : it->second;
+}
+
+} // namespace
+
+XrefIndex::XrefIndex(const Scope& scope) {
+  std::vector<DexMethod*> methods;
+  walk::code(scope, [&methods](DexMethod* method, IRCode&) {
+    methods.push_back(method);
+  });
+
+  // Collect the references of every method in parallel...
+  std::vector<std::vector<Ref>> refs(methods.size());
+  auto collect_wq = workqueue_foreach<size_t>(
+      [&](size_t i) { refs[i] = collect_refs(methods[i]); });
+  for (size_t i = 0; i < methods.size(); ++i) {
+    collect_wq.add_item(i);
+  }
+  collect_wq.run_all();
+
+  // ... then build the map of each kind of reference on its own thread. Going
+  // through the methods in order keeps the index deterministic.
+  auto merge_wq = workqueue_foreach<Kind>([&](Kind kind) {
+    for (size_t i = 0; i < methods.size(); ++i) {
+      add_refs(kind, methods[i], refs[i]);
+    }
+  });
+  for (auto kind : {Kind::FIELD, Kind::METHOD, Kind::TYPE, Kind::STRING}) {
+    merge_wq.add_item(kind);
+  }
+  merge_wq.run_all();
+
+  m_refs_by_method.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); ++i) {
+    m_refs_by_method.emplace(methods[i], std::move(refs[i]));
+  }
+}
+
+std::vector<XrefIndex::Ref> XrefIndex::collect_refs(DexMethod* method) {
+  std::vector<Ref> refs;
+  auto code = method->get_code();
+  if (code == nullptr) {
+    return refs;
+  }
+  for (auto& mie : InstructionIterable(code)) {
+    auto insn = mie.insn;
+    if (insn->has_field()) {
+      refs.push_back(Ref{Kind::FIELD, insn->get_field(), insn});
+    } else if (insn->has_method()) {
+      refs.push_back(Ref{Kind::METHOD, insn->get_method(), insn});
+    } else if (insn->has_type()) {
+      refs.push_back(Ref{Kind::TYPE, insn->get_type(), insn});
+    } else if (insn->has_string()) {
+      refs.push_back(Ref{Kind::STRING, insn->get_string(), insn});
+    }
+  }
+  return refs;
+}
+
+void XrefIndex::add_refs(Kind kind,
+                         DexMethod* method,
+                         const std::vector<Ref>& refs) {
+  for (const auto& ref : refs) {
+    if (ref.kind != kind) {
+      continue;
+    }
+    Xref xref{method, ref.insn};
+    switch (kind) {
+    case Kind::FIELD:
+      m_fields[static_cast<DexFieldRef*>(ref.item)].push_back(xref);
+      break;
+    case Kind::METHOD:
+      m_methods[static_cast<DexMethodRef*>(ref.item)].push_back(xref);
+      break;
+    case Kind::TYPE:
+      m_types[static_cast<DexType*>(ref.item)].push_back(xref);
+      break;
+    case Kind::STRING:
+      m_strings[static_cast<DexString*>(ref.item)].push_back(xref);
+      break;
+    }
+  }
+}
+
+const Xrefs& XrefIndex::field_refs(DexFieldRef* field) const {
+  return find_or_empty(m_fields, field);
+}
+
+const Xrefs& XrefIndex::method_refs(DexMethodRef* method) const {
+  return find_or_empty(m_methods, method);
+}
+
+const Xrefs& XrefIndex::type_refs(DexType* type) const {
+  return find_or_empty(m_types, type);
+}
+
+const Xrefs& XrefIndex::string_refs(DexString* str) const {
+  return find_or_empty(m_strings, str);
+}
+
+Xrefs XrefIndex::field_reads(DexFieldRef* field) const {
+  Xrefs reads;
+  for (const auto& xref : field_refs(field)) {
+    auto op = xref.insn->opcode();
+    if (is_sget(op) || is_iget(op)) {
+      reads.push_back(xref);
+    }
+  }
+  return reads;
+}
+
+Xrefs XrefIndex::field_writes(DexFieldRef* field) const {
+  Xrefs writes;
+  for (const auto& xref : field_refs(field)) {
+    auto op = xref.insn->opcode();
+    if (is_sput(op) || is_iput(op)) {
+      writes.push_back(xref);
+    }
+  }
+  return writes;
+}
+
+template <typename T>
+void XrefIndex::erase_method(std::unordered_map<T*, Xrefs>& map,
+                             T* item,
+                             const DexMethod* method) {
+  auto it = map.find(item);
+  if (it == map.end()) {
+    return;
+  }
+  auto& xrefs = it->second;
+  xrefs.erase(std::remove_if(xrefs.begin(),
+                             xrefs.end(),
+                             [method](const Xref& xref) {
+                               return xref.method == method;
+                             }),
+              xrefs.end());
+  if (xrefs.empty()) {
+    map.erase(it);
+  }
+}
+
+void XrefIndex::remove(DexMethod* method) {
+  auto it = m_refs_by_method.find(method);
+  if (it == m_refs_by_method.end()) {
+    return;
+  }
+  for (const auto& ref : it->second) {
+    switch (ref.kind) {
+    case Kind::FIELD:
+      erase_method(m_fields, static_cast<DexFieldRef*>(ref.item), method);
+      break;
+    case Kind::METHOD:
+      erase_method(m_methods, static_cast<DexMethodRef*>(ref.item), method);
+      break;
+    case Kind::TYPE:
+      erase_method(m_types, static_cast<DexType*>(ref.item), method);
+      break;
+    case Kind::STRING:
+      erase_method(m_strings, static_cast<DexString*>(ref.item), method);
+      break;
+    }
+  }
+  m_refs_by_method.erase(it);
+}
+
+void XrefIndex::update(DexMethod* method) {
+  remove(method);
+  auto refs = collect_refs(method);
+  for (auto kind : {Kind::FIELD, Kind::METHOD, Kind::TYPE, Kind::STRING}) {
+    add_refs(kind, method, refs);
+  }
+  m_refs_by_method.emplace(method, std::move(refs));
+}
+
+bool XrefIndex::is_up_to_date(const Scope& scope) const {
+  XrefIndex fresh(scope);
+  if (fresh.m_refs_by_method.size() != m_refs_by_method.size()) {
+    return false;
+  }
+  for (const auto& pair : fresh.m_refs_by_method) {
+    auto it = m_refs_by_method.find(pair.first);
+    if (it == m_refs_by_method.end() ||
+        !std::equal(pair.second.begin(), pair.second.end(),
+                    it->second.begin(), it->second.end(),
+                    [](const Ref& a, const Ref& b) {
+                      return a.kind == b.kind && a.item == b.item &&
+                             a.insn == b.insn;
+                    })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace xref
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+/*
+ * A whole-program index from the fields, methods, types and strings that
+ * instructions reference to those instructions (and the methods containing
+ * them). It lets a pass answer "who reads this field" or "where is this method
+ * called" without walking all the code of the app again.
+ *
+ * The keys are the references exactly as they appear in the instructions:
+ * a DexFieldRef or DexMethodRef is not resolved, and a DexType is only
+ * indexed where it is the type operand of an instruction (new-instance,
+ * check-cast, const-class, ...), not where it appears in a member reference.
+ *
+ * The index is a snapshot: it is not told about changes to the code. Whoever
+ * holds it owns keeping it current, by calling update() on every method whose
+ * code it changes and remove() on every method it deletes, and nothing
+ * notices if it doesn't. Since other passes don't know about it, an index
+ * must not be kept from one pass to the next. is_up_to_date() compares it
+ * against a fresh one, which passes can check in debug builds.
+ */
+namespace xref {
+
+struct Xref {
+  DexMethod* method;
+  IRInstruction* insn;
+};
+
+using Xrefs = std::vector<Xref>;
+
+class XrefIndex {
+ public:
+  /*
+   * Indexes the code of all the methods in the scope, in parallel.
+   */
+  explicit XrefIndex(const Scope& scope);
+
+  /*
+   * The instructions that reference the given item, grouped by method in the
+   * order of the scope, and in code order within a method.
+   */
+  const Xrefs& field_refs(DexFieldRef* field) const;
+  const Xrefs& method_refs(DexMethodRef* method) const;
+  const Xrefs& type_refs(DexType* type) const;
+  const Xrefs& string_refs(DexString* str) const;
+
+  /*
+   * The sgets/igets and sputs/iputs of the given field reference.
+   */
+  Xrefs field_reads(DexFieldRef* field) const;
+  Xrefs field_writes(DexFieldRef* field) const;
+
+  /*
+   * All the indexed references of each kind. Useful to resolve every
+   * reference once instead of once per instruction.
+   */
+  const std::unordered_map<DexFieldRef*, Xrefs>& fields() const {
+    return m_fields;
+  }
+  const std::unordered_map<DexMethodRef*, Xrefs>& methods() const {
+    return m_methods;
+  }
+  const std::unordered_map<DexType*, Xrefs>& types() const {
+    return m_types;
+  }
+  const std::unordered_map<DexString*, Xrefs>& strings() const {
+    return m_strings;
+  }
+
+  /*
+   * Re-indexes the code of `method` after it was changed. The references of
+   * the method move to the end of the lists they are in.
+   */
+  void update(DexMethod* method);
+
+  /*
+   * Forgets all the references of `method`, e.g. before it is deleted.
+   */
+  void remove(DexMethod* method);
+
+  /*
+   * Whether the index has the same references as one built from `scope` now.
+   * This indexes all the code again, so it is meant for debug checks.
+   */
+  bool is_up_to_date(const Scope& scope) const;
+
+ private:
+  enum class Kind : uint8_t { FIELD, METHOD, TYPE, STRING };
+
+  struct Ref {
+    Kind kind;
+    void* item;
+    IRInstruction* insn;
+  };
+
+  static std::vector<Ref> collect_refs(DexMethod* method);
+  void add_refs(Kind kind, DexMethod* method, const std::vector<Ref>& refs);
+  template <typename T>
+  static void erase_method(std::unordered_map<T*, Xrefs>& map,
+                           T* item,
+                           const DexMethod* method);
+
+  std::unordered_map<DexFieldRef*, Xrefs> m_fields;
+  std::unordered_map<DexMethodRef*, Xrefs> m_methods;
+  std::unordered_map<DexType*, Xrefs> m_types;
+  std::unordered_map<DexString*, Xrefs> m_strings;
+  // What each indexed method references, to be able to take it out of the
+  // index once its code has changed.
+  std::unordered_map<const DexMethod*, std::vector<Ref>> m_refs_by_method;
+};
+
+} // namespace xref
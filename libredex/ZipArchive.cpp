@@ -0,0 +1,445 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ZipArchive.h"
+
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+
+#include "Debug.h"
+#include "Util.h"
+#include "WorkQueue.h"
+
+namespace {
+
+static const int kSignatureSize = 4;
+
+/* CDFile
+ * Central directory file header entry structures.
+ */
+static const uint8_t kCDFile[] = {'P', 'K', 0x01, 0x02};
+
+PACKED(struct pk_cd_file {
+  uint32_t signature;
+  uint16_t vmade;
+  uint16_t vextract;
+  uint16_t flags;
+  uint16_t comp_method;
+  uint16_t mod_time;
+  uint16_t mod_date;
+  uint32_t crc32;
+  uint32_t comp_size;
+  uint32_t ucomp_size;
+  uint16_t fname_len;
+  uint16_t extra_len;
+  uint16_t comment_len;
+  uint16_t diskno;
+  uint16_t interal_attr;
+  uint32_t external_attr;
+  uint32_t disk_offset;
+});
+
+/* CDirEnd:
+ * End of central directory record structures.
+ */
+static const int kMaxCDirEndSearch = 100;
+static const uint8_t kCDirEnd[] = {'P', 'K', 0x05, 0x06};
+
+PACKED(struct pk_cdir_end {
+  uint32_t signature;
+  uint16_t diskno;
+  uint16_t cd_diskno;
+  uint16_t cd_disk_entries;
+  uint16_t cd_entries;
+  uint32_t cd_size;
+  uint32_t cd_disk_offset;
+  uint16_t comment_len;
+});
+
+/* LFile:
+ * Local file header structures.
+ * (Yes, this made more sense in the world of floppies and tapes.)
+ */
+static const uint8_t kLFile[] = {'P', 'K', 0x03, 0x04};
+
+PACKED(struct pk_lfile {
+  uint32_t signature;
+  uint16_t vextract;
+  uint16_t flags;
+  uint16_t comp_method;
+  uint16_t mod_time;
+  uint16_t mod_date;
+  uint32_t crc32;
+  uint32_t comp_size;
+  uint32_t ucomp_size;
+  uint16_t fname_len;
+  uint16_t extra_len;
+});
+
+// Bit 3 of the flags says that the sizes and crc are in a data descriptor
+// after the contents. We always write them in the local header instead.
+static const uint16_t kFlagDataDescriptor = 0x0008;
+
+static const uint16_t kVersionDeflate = 20;
+static const uint16_t kVersionStore = 10;
+static const uint16_t kMadeByUnix = 3 << 8;
+
+// DOS timestamp of 1980-01-01 00:00, so that the output doesn't depend on when
+// it's written.
+static const uint16_t kDefaultModTime = 0;
+static const uint16_t kDefaultModDate = (1 << 5) | 1;
+
+static const size_t kAlignment = 4;
+static const size_t kPageAlignment = 4096;
+
+bool find_central_directory(const uint8_t* mapping,
+                            ssize_t size,
+                            pk_cdir_end& pce) {
+  ssize_t soffset = (size - sizeof(pk_cdir_end));
+  ssize_t eoffset = soffset - kMaxCDirEndSearch;
+  if (soffset < 0) return false;
+  if (eoffset < 0) eoffset = 0;
+  do {
+    const uint8_t* cdsearch = mapping + soffset;
+    if (memcmp(cdsearch, kCDirEnd, kSignatureSize) == 0) {
+      memcpy(&pce, cdsearch, sizeof(pk_cdir_end));
+      return true;
+    }
+  } while (soffset-- > eoffset);
+  fprintf(stderr, "End of central directory record not found, bailing\n");
+  return false;
+}
+
+bool validate_pce(pk_cdir_end& pce, ssize_t size) {
+  /* We only support a limited feature set.  We
+   * don't support disk-spanning, so bail if that's the case.
+   */
+  if (pce.cd_diskno != pce.diskno || pce.cd_diskno != 0 ||
+      pce.cd_entries != pce.cd_disk_entries) {
+    fprintf(stderr, "Disk spanning is not supported, bailing\n");
+    return false;
+  }
+  ssize_t data_size = size - sizeof(pk_cdir_end);
+  if (pce.cd_disk_offset + pce.cd_size > data_size) {
+    fprintf(stderr, "Central directory overflow, invalid pce structure\n");
+    return false;
+  }
+  return true;
+}
+
+int inflate_raw(Bytef* dest,
+                uLongf* destLen,
+                const Bytef* source,
+                uLong sourceLen) {
+  z_stream stream;
+  int err;
+
+  stream.next_in = (Bytef*)source;
+  stream.avail_in = (uInt)sourceLen;
+  stream.next_out = dest;
+  stream.avail_out = (uInt)*destLen;
+  stream.zalloc = (alloc_func)0;
+  stream.zfree = (free_func)0;
+
+  err = inflateInit2(&stream, -MAX_WBITS);
+  if (err != Z_OK) return err;
+
+  err = inflate(&stream, Z_FINISH);
+  if (err != Z_STREAM_END) {
+    inflateEnd(&stream);
+    return err;
+  }
+  *destLen = stream.total_out;
+
+  err = inflateEnd(&stream);
+  return err;
+}
+
+std::string deflate_raw(const std::string& contents) {
+  z_stream stream;
+  stream.zalloc = (alloc_func)0;
+  stream.zfree = (free_func)0;
+  stream.opaque = (voidpf)0;
+  int err = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+  always_assert_log(err == Z_OK, "deflateInit2 failed with code %d", err);
+  std::string out(deflateBound(&stream, contents.size()), '\0');
+  stream.next_in = (Bytef*)contents.data();
+  stream.avail_in = (uInt)contents.size();
+  stream.next_out = (Bytef*)&out[0];
+  stream.avail_out = (uInt)out.size();
+  err = deflate(&stream, Z_FINISH);
+  always_assert_log(err == Z_STREAM_END, "deflate failed with code %d", err);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+bool ends_with(const std::string& s, const char* suffix) {
+  size_t len = strlen(suffix);
+  return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+} // namespace
+
+namespace zip {
+
+bool ZipReader::open(const char* location) {
+  m_file.open(location, boost::iostreams::mapped_file::readonly);
+  if (!m_file.is_open()) {
+    fprintf(stderr, "Cannot open %s\n", location);
+    return false;
+  }
+  auto mapping = reinterpret_cast<const uint8_t*>(m_file.const_data());
+  ssize_t size = m_file.size();
+  pk_cdir_end pce;
+  if (!find_central_directory(mapping, size, pce)) return false;
+  if (!validate_pce(pce, size)) return false;
+
+  const uint8_t* cdir = mapping + pce.cd_disk_offset;
+  const uint8_t* cdir_end = cdir + pce.cd_size;
+  m_entries.resize(pce.cd_entries);
+  m_index.reserve(pce.cd_entries);
+  for (size_t i = 0; i < pce.cd_entries; i++) {
+    pk_cd_file cd;
+    if (cdir + sizeof(pk_cd_file) > cdir_end ||
+        memcmp(cdir, kCDFile, kSignatureSize) != 0) {
+      fprintf(stderr, "Invalid central directory entry, bailing\n");
+      return false;
+    }
+    memcpy(&cd, cdir, sizeof(pk_cd_file));
+    cdir += sizeof(pk_cd_file);
+    if (cdir + cd.fname_len > cdir_end) {
+      fprintf(stderr, "Invalid central directory entry, bailing\n");
+      return false;
+    }
+    auto& entry = m_entries[i];
+    entry.name.assign(reinterpret_cast<const char*>(cdir), cd.fname_len);
+    entry.flags = cd.flags;
+    entry.comp_method = cd.comp_method;
+    entry.mod_time = cd.mod_time;
+    entry.mod_date = cd.mod_date;
+    entry.crc32 = cd.crc32;
+    entry.comp_size = cd.comp_size;
+    entry.ucomp_size = cd.ucomp_size;
+    entry.external_attr = cd.external_attr;
+    cdir += cd.fname_len + cd.extra_len + cd.comment_len;
+
+    // The extra field of the local header may differ from the one in the
+    // central directory, so we need the local header to find the contents.
+    pk_lfile pkf;
+    const uint8_t* lfile = mapping + cd.disk_offset;
+    if (cd.disk_offset + sizeof(pk_lfile) > pce.cd_disk_offset ||
+        memcmp(lfile, kLFile, kSignatureSize) != 0) {
+      fprintf(stderr, "Invalid local file entry, bailing\n");
+      return false;
+    }
+    memcpy(&pkf, lfile, sizeof(pk_lfile));
+    lfile += sizeof(pk_lfile);
+    if (pkf.fname_len != cd.fname_len || pkf.comp_method != cd.comp_method ||
+        memcmp(lfile, entry.name.data(), pkf.fname_len) != 0) {
+      fprintf(stderr,
+              "Directory entry doesn't match local file header, bailing: %s\n",
+              entry.name.c_str());
+      return false;
+    }
+    entry.data = lfile + pkf.fname_len + pkf.extra_len;
+    if (entry.data + entry.comp_size > mapping + pce.cd_disk_offset) {
+      fprintf(stderr, "Entry overflow, bailing: %s\n", entry.name.c_str());
+      return false;
+    }
+    m_index.emplace(entry.name, i);
+  }
+  return true;
+}
+
+const Entry* ZipReader::find(const std::string& name) const {
+  auto it = m_index.find(name);
+  return it == m_index.end() ? nullptr : &m_entries[it->second];
+}
+
+bool ZipReader::read(const Entry& entry, uint8_t* out) const {
+  if (entry.comp_method == kCompMethodStore) {
+    if (entry.comp_size != entry.ucomp_size) {
+      fprintf(stderr, "mis-match on stored size, Bailing\n");
+      return false;
+    }
+    memcpy(out, entry.data, entry.ucomp_size);
+    return true;
+  }
+  if (entry.comp_method != kCompMethodDeflate) {
+    fprintf(stderr, "Unknown compression method %d, Bailing\n",
+            entry.comp_method);
+    return false;
+  }
+  uLongf dlen = entry.ucomp_size;
+  int zlibrv = inflate_raw(out, &dlen, entry.data, entry.comp_size);
+  if (zlibrv != Z_OK) {
+    fprintf(stderr, "uncompress failed with code %d, Bailing\n", zlibrv);
+    return false;
+  }
+  if (dlen != entry.ucomp_size) {
+    fprintf(stderr, "mis-match on uncompressed size, Bailing\n");
+    return false;
+  }
+  return true;
+}
+
+std::string ZipReader::read(const Entry& entry) const {
+  std::string contents(entry.ucomp_size, '\0');
+  always_assert_log(
+      read(entry, reinterpret_cast<uint8_t*>(&contents[0])),
+      "Cannot read %s", entry.name.c_str());
+  return contents;
+}
+
+void ZipWriter::add_raw(const Entry& entry) {
+  PendingEntry pending;
+  pending.entry = entry;
+  pending.entry.flags &= ~kFlagDataDescriptor;
+  m_entries.push_back(std::move(pending));
+}
+
+void ZipWriter::add(const std::string& name,
+                    std::string contents,
+                    uint16_t comp_method) {
+  always_assert(comp_method == kCompMethodStore ||
+                comp_method == kCompMethodDeflate);
+  PendingEntry pending;
+  auto& entry = pending.entry;
+  entry.name = name;
+  entry.flags = 0;
+  entry.comp_method = comp_method;
+  entry.mod_time = kDefaultModTime;
+  entry.mod_date = kDefaultModDate;
+  entry.crc32 = crc32(contents);
+  entry.ucomp_size = contents.size();
+  entry.comp_size = 0;
+  entry.external_attr = 0;
+  entry.data = nullptr;
+  pending.contents = std::move(contents);
+  m_entries.push_back(std::move(pending));
+}
+
+void ZipWriter::write() {
+  auto wq = workqueue_foreach<PendingEntry*>([](PendingEntry* pending) {
+    auto& entry = pending->entry;
+    if (entry.comp_method == kCompMethodDeflate) {
+      pending->compressed = deflate_raw(pending->contents);
+      entry.data = reinterpret_cast<const uint8_t*>(pending->compressed.data());
+      entry.comp_size = pending->compressed.size();
+    } else {
+      entry.data = reinterpret_cast<const uint8_t*>(pending->contents.data());
+      entry.comp_size = pending->contents.size();
+    }
+  });
+  for (auto& pending : m_entries) {
+    if (pending.entry.data == nullptr) {
+      wq.add_item(&pending);
+    }
+  }
+  wq.run_all();
+
+  std::ofstream out(m_location, std::ios::binary | std::ios::trunc);
+  always_assert_log(out, "Cannot write %s", m_location.c_str());
+  static const char kZeros[kPageAlignment] = {};
+  std::vector<pk_cd_file> cd_entries;
+  cd_entries.reserve(m_entries.size());
+  uint64_t offset = 0;
+  for (const auto& pending : m_entries) {
+    const auto& entry = pending.entry;
+    always_assert_log(entry.name.size() <= UINT16_MAX, "Name too long: %s",
+                      entry.name.c_str());
+    uint64_t header_end = offset + sizeof(pk_lfile) + entry.name.size();
+    size_t padding = 0;
+    if (entry.comp_method == kCompMethodStore) {
+      size_t alignment =
+          ends_with(entry.name, ".so") ? kPageAlignment : kAlignment;
+      padding = (alignment - header_end % alignment) % alignment;
+    }
+    uint16_t vextract = entry.comp_method == kCompMethodDeflate
+                            ? kVersionDeflate
+                            : kVersionStore;
+
+    pk_lfile lfile;
+    memcpy(&lfile.signature, kLFile, kSignatureSize);
+    lfile.vextract = vextract;
+    lfile.flags = entry.flags;
+    lfile.comp_method = entry.comp_method;
+    lfile.mod_time = entry.mod_time;
+    lfile.mod_date = entry.mod_date;
+    lfile.crc32 = entry.crc32;
+    lfile.comp_size = entry.comp_size;
+    lfile.ucomp_size = entry.ucomp_size;
+    lfile.fname_len = entry.name.size();
+    lfile.extra_len = padding;
+    out.write(reinterpret_cast<const char*>(&lfile), sizeof(pk_lfile));
+    out.write(entry.name.data(), entry.name.size());
+    out.write(kZeros, padding);
+    out.write(reinterpret_cast<const char*>(entry.data), entry.comp_size);
+
+    pk_cd_file cd;
+    memcpy(&cd.signature, kCDFile, kSignatureSize);
+    // Unix permissions in the external attributes need the "made by" version
+    // to say that the entry comes from a Unix system.
+    cd.vmade = (entry.external_attr >> 16) != 0
+                   ? (kMadeByUnix | kVersionDeflate)
+                   : kVersionDeflate;
+    cd.vextract = vextract;
+    cd.flags = entry.flags;
+    cd.comp_method = entry.comp_method;
+    cd.mod_time = entry.mod_time;
+    cd.mod_date = entry.mod_date;
+    cd.crc32 = entry.crc32;
+    cd.comp_size = entry.comp_size;
+    cd.ucomp_size = entry.ucomp_size;
+    cd.fname_len = entry.name.size();
+    cd.extra_len = 0;
+    cd.comment_len = 0;
+    cd.diskno = 0;
+    cd.interal_attr = 0;
+    cd.external_attr = entry.external_attr;
+    cd.disk_offset = offset;
+    cd_entries.push_back(cd);
+
+    offset = header_end + padding + entry.comp_size;
+    always_assert_log(offset <= UINT32_MAX, "zip64 is not supported: %s",
+                      m_location.c_str());
+  }
+
+  uint64_t cd_offset = offset;
+  for (size_t i = 0; i < m_entries.size(); i++) {
+    const auto& name = m_entries[i].entry.name;
+    out.write(reinterpret_cast<const char*>(&cd_entries[i]),
+              sizeof(pk_cd_file));
+    out.write(name.data(), name.size());
+    offset += sizeof(pk_cd_file) + name.size();
+  }
+  always_assert_log(offset <= UINT32_MAX && m_entries.size() <= UINT16_MAX,
+                    "zip64 is not supported: %s", m_location.c_str());
+
+  pk_cdir_end pce;
+  memcpy(&pce.signature, kCDirEnd, kSignatureSize);
+  pce.diskno = 0;
+  pce.cd_diskno = 0;
+  pce.cd_disk_entries = m_entries.size();
+  pce.cd_entries = m_entries.size();
+  pce.cd_size = offset - cd_offset;
+  pce.cd_disk_offset = cd_offset;
+  pce.comment_len = 0;
+  out.write(reinterpret_cast<const char*>(&pce), sizeof(pk_cdir_end));
+  always_assert_log(out, "Cannot write %s", m_location.c_str());
+}
+
+uint32_t crc32(const std::string& contents) {
+  return ::crc32(::crc32(0L, Z_NULL, 0),
+                 reinterpret_cast<const Bytef*>(contents.data()),
+                 contents.size());
+}
+
+} // namespace zip
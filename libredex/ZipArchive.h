@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Reading and writing of zip archives such as jars and APKs, without
+ * extracting them to disk. Disk spanning and zip64 archives are not supported.
+ */
+namespace zip {
+
+constexpr uint16_t kCompMethodStore = 0;
+constexpr uint16_t kCompMethodDeflate = 8;
+
+struct Entry {
+  std::string name;
+  uint16_t flags;
+  uint16_t comp_method;
+  uint16_t mod_time;
+  uint16_t mod_date;
+  uint32_t crc32;
+  uint32_t comp_size;
+  uint32_t ucomp_size;
+  uint32_t external_attr;
+  // The contents of the entry as stored in the archive, i.e. compressed with
+  // `comp_method`.
+  const uint8_t* data;
+};
+
+class ZipReader {
+ public:
+  /*
+   * Maps the archive in memory and reads its central directory. Returns false
+   * after printing the reason if the file can't be read as a zip archive.
+   */
+  bool open(const char* location);
+
+  const std::vector<Entry>& entries() const { return m_entries; }
+
+  const Entry* find(const std::string& name) const;
+
+  /*
+   * Uncompresses an entry into `out`, which must have room for
+   * `entry.ucomp_size` bytes.
+   */
+  bool read(const Entry& entry, uint8_t* out) const;
+
+  std::string read(const Entry& entry) const;
+
+ private:
+  boost::iostreams::mapped_file m_file;
+  std::vector<Entry> m_entries;
+  std::unordered_map<std::string, size_t> m_index;
+};
+
+/*
+ * Builds an archive from entries copied from other archives and new contents.
+ * Nothing is written until `write()`, which compresses the new contents in
+ * parallel. As zipalign does, stored entries are aligned on 4 bytes, or on a
+ * page for shared libraries so that they can be mapped from the APK.
+ */
+class ZipWriter {
+ public:
+  explicit ZipWriter(std::string location) : m_location(std::move(location)) {}
+
+  /*
+   * Copies an entry without uncompressing it. The archive the entry comes from
+   * must stay open until `write()`.
+   */
+  void add_raw(const Entry& entry);
+
+  void add(const std::string& name,
+           std::string contents,
+           uint16_t comp_method = kCompMethodDeflate);
+
+  void write();
+
+ private:
+  struct PendingEntry {
+    Entry entry;
+    // New contents, before and after compression.
+    std::string contents;
+    std::string compressed;
+  };
+
+  std::string m_location;
+  std::vector<PendingEntry> m_entries;
+};
+
+uint32_t crc32(const std::string& contents);
+
+} // namespace zip
@@ -18,6 +18,7 @@
 #include "Resolver.h"
 #include "VirtualScope.h"
 #include "Walkers.h"
+#include "XrefIndex.h"
 
 namespace {
 size_t mark_classes_final(const Scope& scope, const ClassHierarchy& ch) {
@@ -68,9 +69,9 @@ size_t mark_methods_final(const Scope& scope, const ClassHierarchy& ch) {
   return n_methods_finalized;
 }
 
-size_t mark_fields_final(const Scope& scope) {
+size_t mark_fields_final(const xref::XrefIndex& xrefs) {
   field_op_tracker::FieldStatsMap field_stats =
-      field_op_tracker::analyze(scope);
+      field_op_tracker::analyze(xrefs);
 
   size_t n_fields_finalized = 0;
   for (auto& pair : field_stats) {
@@ -96,7 +97,7 @@ std::vector<DexMethod*> direct_methods(const std::vector<DexClass*>& scope) {
 }
 
 std::unordered_set<DexMethod*> find_private_methods(
-    const std::vector<DexClass*>& scope, const std::vector<DexMethod*>& cv) {
+    const xref::XrefIndex& xrefs, const std::vector<DexMethod*>& cv) {
   std::unordered_set<DexMethod*> candidates;
   for (auto m : cv) {
     TRACE(ACCESS, 3, "Considering for privatization: %s\n", SHOW(m));
@@ -104,17 +105,18 @@ std::unordered_set<DexMethod*> find_private_methods(
       candidates.emplace(m);
     }
   }
-  walk::opcodes(
-      scope,
-      [](DexMethod*) { return true; },
-      [&](DexMethod* caller, IRInstruction* inst) {
-        if (!inst->has_method()) return;
-        auto callee = resolve_method(inst->get_method(), MethodSearch::Any);
-        if (callee == nullptr || callee->get_class() == caller->get_class()) {
-          return;
-        }
+  for (const auto& pair : xrefs.methods()) {
+    auto callee = resolve_method(pair.first, MethodSearch::Any);
+    if (callee == nullptr || !candidates.count(callee)) {
+      continue;
+    }
+    for (const auto& xref : pair.second) {
+      if (callee->get_class() != xref.method->get_class()) {
         candidates.erase(callee);
-      });
+        break;
+      }
+    }
+  }
   return candidates;
 }
 
@@ -154,6 +156,7 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
   auto scope = build_class_scope(stores);
   ClassHierarchy ch = build_type_hierarchy(scope);
   SignatureMap sm = build_signature_map(ch);
+  xref::XrefIndex xrefs(scope);
   if (m_finalize_classes) {
     auto n_classes_final = mark_classes_final(scope, ch);
     pm.incr_metric("finalized_classes", n_classes_final);
@@ -165,7 +168,7 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
     TRACE(ACCESS, 1, "Finalized %lu methods\n", n_methods_final);
   }
   if (m_finalize_fields) {
-    auto n_fields_final = mark_fields_final(scope);
+    auto n_fields_final = mark_fields_final(xrefs);
     pm.incr_metric("finalized_fields", n_fields_final);
     TRACE(ACCESS, 1, "Finalized %lu fields\n", n_fields_final);
   }
@@ -173,7 +176,10 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
   auto dmethods = direct_methods(scope);
   candidates.insert(candidates.end(), dmethods.begin(), dmethods.end());
   if (m_privatize_methods) {
-    auto privates = find_private_methods(scope, candidates);
+    if (debug) {
+      always_assert(xrefs.is_up_to_date(scope));
+    }
+    auto privates = find_private_methods(xrefs, candidates);
     fix_call_sites_private(scope, privates);
     mark_methods_private(privates);
     pm.incr_metric("privatized_methods", privates.size());
@@ -489,7 +489,7 @@ size_t inline_final_gets(
 // on RMU to delete these fields.
 void aggressively_delete_static_finals(const Scope& scope) {
   std::unordered_set<const DexField*> referenced_fields;
-  walk::opcodes(scope, [&](const DexMethod*, const IRInstruction* insn) {
+  walk::read_opcodes(scope, [&](const DexMethod*, const IRInstruction* insn) {
     if (!insn->has_field()) {
       return;
     }
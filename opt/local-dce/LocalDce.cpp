@@ -21,6 +21,7 @@
 #include "IRInstruction.h"
 #include "DexUtil.h"
 #include "Resolver.h"
+#include "ScratchAllocator.h"
 #include "Transform.h"
 #include "Walkers.h"
 
@@ -139,12 +140,24 @@ void LocalDce::dce(IRCode* code) {
   auto& cfg = code->cfg();
   auto blocks = cfg::postorder_sort(cfg.blocks());
   auto regs = code->get_registers_size();
-  std::unordered_map<cfg::BlockId, boost::dynamic_bitset<>> liveness;
+  scratch::Scope scratch_scope;
+  using Liveness = boost::dynamic_bitset<>;
+  using LivenessMap =
+      std::unordered_map<cfg::BlockId,
+                         Liveness,
+                         std::hash<cfg::BlockId>,
+                         std::equal_to<cfg::BlockId>,
+                         scratch::Allocator<std::pair<const cfg::BlockId,
+                                                      Liveness>>>;
+  LivenessMap liveness(blocks.size());
   for (cfg::Block* b : blocks) {
-    liveness.emplace(b->id(), boost::dynamic_bitset<>(regs + 1));
+    liveness.emplace(b->id(), Liveness(regs + 1));
   }
   bool changed;
-  std::vector<std::pair<cfg::Block*, IRList::iterator>> dead_instructions;
+  using DeadInstruction = std::pair<cfg::Block*, IRList::iterator>;
+  std::vector<DeadInstruction, scratch::Allocator<DeadInstruction>>
+      dead_instructions;
+  Liveness prev_liveness(regs + 1);
 
   TRACE(DCE, 5, "%s", SHOW(cfg));
 
@@ -153,8 +166,8 @@ void LocalDce::dce(IRCode* code) {
     changed = false;
     dead_instructions.clear();
     for (auto& b : blocks) {
-      auto prev_liveness = liveness.at(b->id());
       auto& bliveness = liveness.at(b->id());
+      prev_liveness = bliveness;
       bliveness.reset();
       TRACE(DCE, 5, "B%lu: %s\n", b->id(), show(bliveness).c_str());
 
@@ -201,7 +214,11 @@ void LocalDce::dce(IRCode* code) {
   } while (changed);
 
   // Remove dead instructions.
-  std::unordered_set<IRInstruction*> seen;
+  std::unordered_set<IRInstruction*,
+                     std::hash<IRInstruction*>,
+                     std::equal_to<IRInstruction*>,
+                     scratch::Allocator<IRInstruction*>>
+      seen;
   for (const auto& pair : dead_instructions) {
     cfg::Block* b = pair.first;
     IRList::iterator it = pair.second;
@@ -19,6 +19,7 @@
 #include "Trace.h"
 #include "VirtualRenamer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -72,57 +73,125 @@ void debug_logging(std::vector<DexClass*>& classes) {
   TRACE(OBFUSCATE, 3, "Finished applying new names to defs\n");
 }
 
-template<typename DexMember, typename DexMemberRef, typename DexMemberSpec, typename K>
-DexMember* find_renamable_ref(DexMemberRef* ref,
-    std::unordered_map<DexMemberRef*, DexMember*>& ref_def_cache,
-    DexElemManager<DexMember*, DexMemberRef*, DexMemberSpec, K>& name_mapping) {
-  TRACE(OBFUSCATE, 4, "Found a ref opcode\n");
-  DexMember* def = nullptr;
-  auto member_itr = ref_def_cache.find(ref);
-  if (member_itr != ref_def_cache.end()) {
-    def = member_itr->second;
-  } else {
-    def = name_mapping.def_of_ref(ref);
+// The refs to members that are not defs, i.e. that may have to be rewritten
+// to point to a renamed def.
+struct RefsToResolve {
+  std::unordered_set<DexFieldRef*> fields;
+  std::unordered_set<DexMethodRef*> methods;
+};
+
+bool may_refer_to_renamed_def(IRInstruction* instr) {
+  auto op = instr->opcode();
+  if (instr->has_field()) {
+    return !instr->get_field()->is_def();
   }
-  ref_def_cache[ref] = def;
-  return def;
+  // We only check invoke-direct and invoke-static because the method def
+  // we've renamed is a `dmethod`, not a `vmethod`.
+  //
+  // If we attempted to resolve invoke-virtual refs here, we would
+  // conflate this virtual ref with a direct def that happens to have the
+  // same name but isn't actually inherited.
+  return instr->has_method() &&
+         (is_invoke_direct(op) || is_invoke_static(op)) &&
+         !instr->get_method()->is_def();
 }
 
-void update_refs(Scope& scope, DexFieldManager& field_name_mapping,
-    DexMethodManager& method_name_mapping) {
-  std::unordered_map<DexFieldRef*, DexField*> f_ref_def_cache;
-  std::unordered_map<DexMethodRef*, DexMethod*> m_ref_def_cache;
-  walk::opcodes(scope,
-    [&](DexMethod*, IRInstruction* instr) {
-      auto op = instr->opcode();
-      if (instr->has_field()) {
-        DexFieldRef* field_ref = instr->get_field();
-        if (field_ref->is_def()) return;
-        DexField* field_def =
-            find_renamable_ref(field_ref, f_ref_def_cache, field_name_mapping);
-        if (field_def != nullptr) {
-          TRACE(OBFUSCATE, 4, "Found a ref to fixup %s", SHOW(field_ref));
-          instr->set_field(field_def);
+template <typename DexMember,
+          typename DexMemberRef,
+          typename DexMemberSpec,
+          typename K>
+std::unordered_map<DexMemberRef*, DexMember*> resolve_refs(
+    const std::unordered_set<DexMemberRef*>& refs,
+    const DexElemManager<DexMember*, DexMemberRef*, DexMemberSpec, K>&
+        name_mapping) {
+  std::vector<DexMemberRef*> refs_vec(refs.begin(), refs.end());
+  std::vector<DexMember*> defs(refs_vec.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    defs[i] = name_mapping.def_of_ref(refs_vec[i]);
+  });
+  for (size_t i = 0; i < refs_vec.size(); ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+  std::unordered_map<DexMemberRef*, DexMember*> ref_to_def;
+  for (size_t i = 0; i < refs_vec.size(); ++i) {
+    if (defs[i] != nullptr) {
+      ref_to_def.emplace(refs_vec[i], defs[i]);
+    }
+  }
+  return ref_to_def;
+}
+
+template <typename DexMemberRef, typename DexMember>
+DexMember* find_or_null(
+    const std::unordered_map<DexMemberRef*, DexMember*>& ref_to_def,
+    DexMemberRef* ref) {
+  auto it = ref_to_def.find(ref);
+  return it == ref_to_def.end() ? nullptr : it->second;
+}
+
+// Rewrites the refs to renamed members. This is done in three phases, all of
+// them parallel: we collect the distinct refs of the whole app, resolve each
+// of them once against the renamed defs, and then rewrite the instructions.
+void update_refs(Scope& scope,
+                 const DexFieldManager& field_name_mapping,
+                 const DexMethodManager& method_name_mapping) {
+  auto refs = walk::parallel::reduce_methods<RefsToResolve>(
+      scope,
+      [](DexMethod* method) {
+        RefsToResolve refs;
+        auto code = method->get_code();
+        if (code == nullptr) {
+          return refs;
         }
-      } else if (instr->has_method() &&
-                 (is_invoke_direct(op) || is_invoke_static(op))) {
-        // We only check invoke-direct and invoke-static because the method def
-        // we've renamed is a `dmethod`, not a `vmethod`.
-        //
-        // If we attempted to resolve invoke-virtual refs here, we would
-        // conflate this virtual ref with a direct def that happens to have the
-        // same name but isn't actually inherited.
-        DexMethodRef* method_ref = instr->get_method();
-        if (method_ref->is_def()) return;
-        DexMethod* method_def =
-            find_renamable_ref(method_ref, m_ref_def_cache,
-                method_name_mapping);
-        if (method_def != nullptr) {
-          TRACE(OBFUSCATE, 4, "Found a ref to fixup %s", SHOW(method_ref));
-          instr->set_method(method_def);
+        for (auto& mie : InstructionIterable(code)) {
+          auto instr = mie.insn;
+          if (!may_refer_to_renamed_def(instr)) {
+            continue;
+          }
+          if (instr->has_field()) {
+            refs.fields.insert(instr->get_field());
+          } else {
+            refs.methods.insert(instr->get_method());
+          }
         }
+        return refs;
+      },
+      [](RefsToResolve a, RefsToResolve b) {
+        if (a.fields.size() < b.fields.size()) {
+          std::swap(a.fields, b.fields);
+        }
+        if (a.methods.size() < b.methods.size()) {
+          std::swap(a.methods, b.methods);
+        }
+        a.fields.insert(b.fields.begin(), b.fields.end());
+        a.methods.insert(b.methods.begin(), b.methods.end());
+        return a;
+      });
+
+  auto field_defs = resolve_refs(refs.fields, field_name_mapping);
+  auto method_defs = resolve_refs(refs.methods, method_name_mapping);
+
+  walk::parallel::opcodes(scope, [&](DexMethod*, IRInstruction* instr) {
+    if (!may_refer_to_renamed_def(instr)) {
+      return;
+    }
+    if (instr->has_field()) {
+      DexFieldRef* field_ref = instr->get_field();
+      DexField* field_def = find_or_null(field_defs, field_ref);
+      if (field_def != nullptr) {
+        TRACE(OBFUSCATE, 4, "Found a ref to fixup %s", SHOW(field_ref));
+        instr->set_field(field_def);
+      }
+    } else {
+      DexMethodRef* method_ref = instr->get_method();
+      DexMethod* method_def = find_or_null(method_defs, method_ref);
+      if (method_def != nullptr) {
+        TRACE(OBFUSCATE, 4, "Found a ref to fixup %s", SHOW(method_ref));
+        instr->set_method(method_def);
       }
-    });
+    }
+  });
 }
 
 void get_totals(Scope& scope, RenameStats& stats) {
@@ -16,11 +16,6 @@
 
 constexpr int kMaxIdentChar (52);
 
-// Type for the map of descriptor -> [newname -> oldname]
-// This map is used for reverse lookup to find naming collisions
-typedef std::unordered_map<std::string,
-    std::unordered_map<std::string, std::string>> NameMapping;
-
 // Renames a field in the Dex
 void rename_field(DexField* field, const std::string& new_name);
 void rename_method(DexMethod* method, const std::string& new_name);
@@ -479,34 +474,43 @@ public:
   //void lock_elements() { mark_all_unrenamable = true; }
   //void unlock_elements() { mark_all_unrenamable = false; }
 
+  // Returns the wrapper of the element, or nullptr if there is none. This
+  // doesn't modify the maps, so it is safe to call from multiple threads.
+  inline DexNameWrapper<T>* find_elem(DexType* cls, K sig,
+                                      DexString* name) const {
+    auto class_itr = elements.find(cls);
+    if (class_itr == elements.end()) return nullptr;
+    auto sig_itr = class_itr->second.find(sig);
+    if (sig_itr == class_itr->second.end()) return nullptr;
+    auto name_itr = sig_itr->second.find(name);
+    if (name_itr == sig_itr->second.end()) return nullptr;
+    return name_itr->second.get();
+  }
+
   inline bool contains_elem(
-      DexType* cls, K sig, DexString* name) {
-    return elements.count(cls) > 0 &&
-      elements[cls].count(sig) > 0 &&
-      elements[cls][sig].count(name) > 0;
+      DexType* cls, K sig, DexString* name) const {
+    return find_elem(cls, sig, name) != nullptr;
   }
 
-  inline bool contains_elem(R elem) {
+  inline bool contains_elem(R elem) const {
     return contains_elem(
         elem->get_class(), sig_getter_fn(elem), elem->get_name());
   }
 
   inline DexNameWrapper<T>* emplace(T elem) {
-    elements[elem->get_class()][sig_getter_fn(elem)][elem->get_name()] =
-        std::unique_ptr<DexNameWrapper<T>>(elemCtr(elem));
-    if (mark_all_unrenamable)
-      elements[elem->get_class()][sig_getter_fn(elem)][elem->get_name()]
-          ->mark_unrenamable();
-    return elements[
-        elem->get_class()][sig_getter_fn(elem)][elem->get_name()].get();
+    auto& wrap =
+        elements[elem->get_class()][sig_getter_fn(elem)][elem->get_name()];
+    wrap = std::unique_ptr<DexNameWrapper<T>>(elemCtr(elem));
+    if (mark_all_unrenamable) wrap->mark_unrenamable();
+    return wrap.get();
   }
 
   // Mirrors the map get operator, but ensures we create correct wrappers
   // if they don't exist
   inline DexNameWrapper<T>* operator[](T elem) {
-    return contains_elem(elem) ?
-      elements[elem->get_class()]
-        [sig_getter_fn(elem)][elem->get_name()].get() : emplace(elem);
+    auto wrap =
+        find_elem(elem->get_class(), sig_getter_fn(elem), elem->get_name());
+    return wrap != nullptr ? wrap : emplace(elem);
   }
 
   // Commits all the renamings in elements to the dex by modifying the
@@ -552,13 +556,11 @@ public:
 
 private:
   // Returns the def for that class and ref if it exists, nullptr otherwise
-  T find_def(R ref, DexType* cls) {
+  T find_def(R ref, DexType* cls) const {
     if (cls == nullptr) return nullptr;
-    if (contains_elem(cls, sig_getter_fn(ref), ref->get_name())) {
-      DexNameWrapper<T>* wrap =
-        elements[cls][sig_getter_fn(ref)][ref->get_name()].get();
-      if (wrap->is_modified())
-        return wrap->get();
+    auto wrap = find_elem(cls, sig_getter_fn(ref), ref->get_name());
+    if (wrap != nullptr && wrap->is_modified()) {
+      return wrap->get();
     }
     return nullptr;
   }
@@ -566,7 +568,7 @@ private:
   /**
    * Look up in the class and all its interfaces.
    */
-  T find_def_in_class_and_intf(R ref, DexClass* cls) {
+  T find_def_in_class_and_intf(R ref, DexClass* cls) const {
     if (cls == nullptr) return nullptr;
     auto found_def = find_def(ref, cls->get_type());
     if (found_def != nullptr) return found_def;
@@ -580,8 +582,9 @@ private:
  public:
   // Does a lookup over the fields we renamed in the dex to see what the
   // reference should be reset with. Returns nullptr if there is no mapping.
-  // Note: we also have to look in superclasses in the case that this is a ref
-  T def_of_ref(R ref) {
+  // Note: we also have to look in superclasses in the case that this is a ref.
+  // This doesn't modify the manager, so refs can be resolved in parallel.
+  T def_of_ref(R ref) const {
     DexClass* cls = type_class(ref->get_class());
     while (cls && !cls->is_external()) {
       auto found = find_def_in_class_and_intf(ref, cls);
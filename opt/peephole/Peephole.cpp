@@ -1474,6 +1474,128 @@ class PeepholeOptimizer {
   int m_stats_removed = 0;
   int m_stats_inserted = 0;
 
+  // The patterns compiled into a single automaton: for each opcode, the
+  // indices of the matchers whose first instruction accepts that opcode.
+  // Only those matchers, plus the ones in the middle of a match, need to see
+  // a given instruction.
+  std::vector<std::vector<size_t>> m_matchers_by_first_opcode;
+
+  // Scratch state, reused across methods.
+  std::vector<size_t> m_active;
+  std::vector<size_t> m_next_active;
+  std::vector<bool> m_is_active;
+
+  struct Matches {
+    std::vector<IRInstruction*> deletes;
+    std::vector<std::pair<IRInstruction*, std::vector<IRInstruction*>>>
+        inserts;
+    size_t num_matches{0};
+    size_t num_removed{0};
+    size_t num_inserted{0};
+
+    void clear() {
+      deletes.clear();
+      inserts.clear();
+      num_matches = 0;
+      num_removed = 0;
+      num_inserted = 0;
+    }
+  };
+  // The matches of each matcher in the method at hand, reused across methods.
+  std::vector<Matches> m_matches;
+
+  void build_automaton() {
+    for (size_t i = 0; i < m_matchers.size(); ++i) {
+      const auto& first = m_matchers[i].pattern.match.at(0);
+      for (auto op : first.opcodes) {
+        if (op >= m_matchers_by_first_opcode.size()) {
+          m_matchers_by_first_opcode.resize(op + 1);
+        }
+        m_matchers_by_first_opcode[op].push_back(i);
+      }
+    }
+    m_is_active.resize(m_matchers.size(), false);
+    m_matches.resize(m_matchers.size());
+  }
+
+  // Feed `insn` to matcher `i`, recording a match if it completes one, and
+  // keep the matcher active for the next instruction if it is in the middle
+  // of a match.
+  void advance(size_t i, IRInstruction* insn, Matches* matches) {
+    auto& matcher = m_matchers[i];
+    if (matcher.try_match(insn)) {
+      TRACE(PEEPHOLE, 7, "PATTERN %s MATCHED!\n",
+            matcher.pattern.name.c_str());
+      for (auto matched : matcher.matched_instructions) {
+        if (opcode::is_move_result_pseudo(matched->opcode())) {
+          continue;
+        }
+        matches->deletes.push_back(matched);
+      }
+
+      auto replace = matcher.get_replacements();
+      for (const auto& r : replace) {
+        TRACE(PEEPHOLE, 8, "-- %s\n", SHOW(r));
+      }
+
+      matches->num_matches++;
+      matches->num_inserted += replace.size();
+      matches->num_removed += matcher.match_index;
+
+      matches->inserts.emplace_back(insn, replace);
+      matcher.reset();
+    }
+    if (matcher.match_index > 0) {
+      m_next_active.push_back(i);
+    }
+  }
+
+  // Run all the matchers from index `first` on over the code in a single
+  // pass. Each matcher sees exactly the instructions it would see if it ran
+  // on its own, so it finds the same matches.
+  void match_all(IRCode* code, size_t first, std::vector<Matches>* matches) {
+    const auto& deactivate_all = [this]() {
+      for (auto i : m_active) {
+        m_matchers[i].reset();
+        m_is_active[i] = false;
+      }
+      m_active.clear();
+    };
+
+    const auto& blocks = code->cfg().blocks();
+    for (const auto& block : blocks) {
+      // Currently, all patterns do not span over multiple basic blocks. So
+      // reset all matching states on visiting every basic block.
+      deactivate_all();
+
+      for (auto& mei : InstructionIterable(block)) {
+        auto insn = mei.insn;
+        m_next_active.clear();
+        for (auto i : m_active) {
+          advance(i, insn, &(*matches)[i]);
+        }
+        // A matcher that isn't in the middle of a match can only make
+        // progress on an instruction its pattern starts with.
+        auto op = insn->opcode();
+        if (op < m_matchers_by_first_opcode.size()) {
+          for (auto i : m_matchers_by_first_opcode[op]) {
+            if (i >= first && !m_is_active[i]) {
+              advance(i, insn, &(*matches)[i]);
+            }
+          }
+        }
+        for (auto i : m_active) {
+          m_is_active[i] = false;
+        }
+        for (auto i : m_next_active) {
+          m_is_active[i] = true;
+        }
+        std::swap(m_active, m_next_active);
+      }
+    }
+    deactivate_all();
+  }
+
  public:
   explicit PeepholeOptimizer(
       PassManager& mgr, const std::vector<std::string>& disabled_peepholes)
@@ -1491,6 +1613,7 @@ class PeepholeOptimizer {
       }
     }
     m_stats.resize(m_matchers.size(), 0);
+    build_automaton();
   }
 
   PeepholeOptimizer(const PeepholeOptimizer&) = delete;
@@ -1501,52 +1624,47 @@ class PeepholeOptimizer {
     code->build_cfg(/* editable */ false);
 
     // do optimizations one at a time
-    // so they can match on the same pattern without interfering
-    for (size_t i = 0; i < m_matchers.size(); ++i) {
-      auto& matcher = m_matchers[i];
-      std::vector<IRInstruction*> deletes;
-      std::vector<std::pair<IRInstruction*, std::vector<IRInstruction*>>>
-          inserts;
-      const auto& blocks = code->cfg().blocks();
-      for (const auto& block : blocks) {
-        // Currently, all patterns do not span over multiple basic blocks. So
-        // reset all matching states on visiting every basic block.
-        matcher.reset();
-
-        for (auto& mei : InstructionIterable(block)) {
-          if (!matcher.try_match(mei.insn)) {
-            continue;
-          }
-          m_stats.at(i)++;
-          TRACE(PEEPHOLE, 7, "PATTERN %s MATCHED!\n",
-                matcher.pattern.name.c_str());
-          for (auto insn : matcher.matched_instructions) {
-            if (opcode::is_move_result_pseudo(insn->opcode())) {
-              continue;
-            }
-            deletes.push_back(insn);
-          }
+    // so they can match on the same pattern without interfering.
+    //
+    // Rather than scanning the code once per pattern, we match all the
+    // patterns in one pass and apply the first one that matched. Only the
+    // patterns after it need to be matched again, on the updated code, so a
+    // method without any match is scanned exactly once.
+    size_t first = 0;
+    while (first < m_matchers.size()) {
+      for (size_t j = first; j < m_matchers.size(); ++j) {
+        m_matches[j].clear();
+      }
+      match_all(code, first, &m_matches);
 
-          auto replace = matcher.get_replacements();
-          for (const auto& r : replace) {
-            TRACE(PEEPHOLE, 8, "-- %s\n", SHOW(r));
+      size_t i = first;
+      while (i < m_matchers.size() && m_matches[i].num_matches == 0) {
+        ++i;
+      }
+      if (i == m_matchers.size()) {
+        break;
+      }
+      // The later matches were found on code that is about to change.
+      for (size_t j = i + 1; j < m_matchers.size(); ++j) {
+        for (auto& pair : m_matches[j].inserts) {
+          for (auto insn : pair.second) {
+            delete insn;
           }
-
-          m_stats_inserted += replace.size();
-          m_stats_removed += matcher.match_index;
-
-          inserts.emplace_back(mei.insn, replace);
-          matcher.reset();
         }
       }
 
-      for (auto& pair : inserts) {
+      auto& applied = m_matches[i];
+      m_stats.at(i) += applied.num_matches;
+      m_stats_inserted += applied.num_inserted;
+      m_stats_removed += applied.num_removed;
+      for (auto& pair : applied.inserts) {
         std::vector<IRInstruction*> vec{begin(pair.second), end(pair.second)};
         code->insert_after(pair.first, vec);
       }
-      for (auto& insn : deletes) {
+      for (auto& insn : applied.deletes) {
         code->remove_opcode(insn);
       }
+      first = i + 1;
     }
   }
 
@@ -1615,8 +1733,7 @@ void PeepholePass::run_pass(DexStoresVector& stores,
         helpers.emplace_back(std::make_unique<PeepholeOptimizer>(
             mgr, config.disabled_peepholes));
         return helpers.back().get();
-      },
-      std::thread::hardware_concurrency() / 2);
+      });
   for (auto* cls : scope) {
     wq.add_item(cls);
   }
@@ -14,6 +14,7 @@
 #include "ControlFlow.h"
 #include "Debug.h"
 #include "DexUtil.h"
+#include "Dominators.h"
 #include "IRCode.h"
 #include "Show.h"
 #include "Transform.h"
@@ -640,8 +641,9 @@ void Allocator::select_ranges(const IRCode* code,
       vreg_files.emplace(src, vreg_file);
     }
 
+    std::vector<reg_t> range_regs(insn->srcs().begin(), insn->srcs().end());
     reg_t range_base = find_best_range_fit(ig,
-                                           insn->srcs(),
+                                           range_regs,
                                            0,
                                            reg_transform->size,
                                            vreg_files,
@@ -855,7 +857,7 @@ std::unordered_map<reg_t, IRList::iterator> Allocator::find_param_splits(
 
   auto& cfg = code->cfg();
   cfg::Block* start_block = cfg.entry_block();
-  auto postorder_dominator = cfg.immediate_dominators();
+  const auto& dominators = cfg.get_dominator_tree();
   for (auto param : params) {
     auto block_uses = find_first_uses(param, start_block);
     // Since this function only gets called for param regs that need to be
@@ -867,7 +869,7 @@ std::unordered_map<reg_t, IRList::iterator> Allocator::find_param_splits(
       // insert a load at its end.
       cfg::Block* idom = block_uses[0];
       for (size_t index = 1; index < block_uses.size(); ++index) {
-        idom = cfg.idom_intersect(postorder_dominator, idom, block_uses[index]);
+        idom = dominators.common_dominator(idom, block_uses[index]);
       }
       TRACE(REG, 5, "Inserting param load of v%u in B%u\n", param, idom->id());
       // We need to check insn before end of block to make sure we didn't
@@ -1037,6 +1039,9 @@ void Allocator::allocate(IRCode* code) {
 
   bool first{true};
   while (true) {
+    // The interference graph and everything else built in this round is
+    // dropped at the end of it.
+    scratch::Scope scratch_scope;
     SplitCosts split_costs;
     SpillPlan spill_plan;
     SplitPlan split_plan;
@@ -16,6 +16,7 @@
 #include "Liveness.h"
 #include "IRCode.h"
 #include "RegisterType.h"
+#include "ScratchAllocator.h"
 
 namespace regalloc {
 
@@ -182,12 +183,20 @@ class Graph {
  public:
   const Node& get_node(reg_t) const;
 
-  const std::unordered_map<reg_t, Node>& nodes() const { return m_nodes; }
+  // The graph is rebuilt on every round of allocation, so its tables live on
+  // the scratch arena.
+  using NodeMap =
+      std::unordered_map<reg_t,
+                         Node,
+                         std::hash<reg_t>,
+                         std::equal_to<reg_t>,
+                         scratch::Allocator<std::pair<const reg_t, Node>>>;
 
-  std::unordered_map<reg_t, Node>& nodes() { return m_nodes; }
+  const NodeMap& nodes() const { return m_nodes; }
 
-  boost::filtered_range<ActiveFilter, const std::unordered_map<reg_t, Node>>
-  active_nodes() const {
+  NodeMap& nodes() { return m_nodes; }
+
+  boost::filtered_range<ActiveFilter, const NodeMap> active_nodes() const {
     return boost::adaptors::filter(m_nodes, ActiveFilter());
   }
 
@@ -242,15 +251,28 @@ class Graph {
   // Boolean of whether we should separate symregs requiring less than 16 bits
   // from those without this constraint,
   bool m_separate_node{false};
-  std::unordered_map<reg_t, Node> m_nodes;
+  NodeMap m_nodes;
   using Edge = impl::OrderedPair<reg_t>;
-  std::unordered_map<Edge, bool /* not_coalesceable */, boost::hash<Edge>>
+  std::unordered_map<Edge,
+                     bool /* not_coalesceable */,
+                     boost::hash<Edge>,
+                     std::equal_to<Edge>,
+                     scratch::Allocator<std::pair<const Edge, bool>>>
       m_adj_matrix;
-  std::unordered_set<ContainmentEdge, boost::hash<ContainmentEdge>>
+  std::unordered_set<ContainmentEdge,
+                     boost::hash<ContainmentEdge>,
+                     std::equal_to<ContainmentEdge>,
+                     scratch::Allocator<ContainmentEdge>>
       m_containment_graph;
   // This map contains the LivenessDomains for all instructions which could
   // potentialy take on the /range format.
-  std::unordered_map<IRInstruction*, LivenessDomain> m_range_liveness;
+  std::unordered_map<
+      IRInstruction*,
+      LivenessDomain,
+      std::hash<IRInstruction*>,
+      std::equal_to<IRInstruction*>,
+      scratch::Allocator<std::pair<IRInstruction* const, LivenessDomain>>>
+      m_range_liveness;
 
   friend class impl::GraphBuilder;
 };
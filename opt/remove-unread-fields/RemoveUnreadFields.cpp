@@ -8,7 +8,6 @@
 #include "RemoveUnreadFields.h"
 
 #include "DexClass.h"
-#include "FieldOpTracker.h"
 #include "IRCode.h"
 #include "Resolver.h"
 #include "Walkers.h"
@@ -21,12 +20,17 @@ bool can_remove(DexField* field) {
          can_rename(field);
 }
 
+void PassImpl::analyze_pass(const Scope& scope, const PassManager&) {
+  m_field_stats = field_op_tracker::analyze(scope);
+}
+
 void PassImpl::run_pass(DexStoresVector& stores,
                         ConfigFiles& cfg,
                         PassManager& mgr) {
 
   auto scope = build_class_scope(stores);
-  field_op_tracker::FieldStatsMap field_stats = field_op_tracker::analyze(scope);
+  auto field_stats = std::move(m_field_stats);
+  m_field_stats.clear();
 
   uint32_t unread_fields = 0;
   for (auto& pair : field_stats) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "FieldOpTracker.h"
 #include "Pass.h"
 
 /*
@@ -23,9 +24,16 @@ class PassImpl : public Pass {
  public:
   PassImpl() : Pass("RemoveUnreadFieldsPass") {}
 
+  bool has_analysis() const override { return true; }
+
+  void analyze_pass(const Scope& scope, const PassManager& mgr) override;
+
   void run_pass(DexStoresVector& stores,
                 ConfigFiles& cfg,
                 PassManager& mgr) override;
+
+ private:
+  field_op_tracker::FieldStatsMap m_field_stats;
 };
 
 } // namespace remove_unread_fields
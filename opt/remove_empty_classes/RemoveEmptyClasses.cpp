@@ -101,11 +101,8 @@ void process_code(std::unordered_set<const DexType*>* class_references,
   }
 }
 
-size_t remove_empty_classes(Scope& classes) {
-
-  // class_references is a set of type names which represent classes
-  // which should not be deleted even if they are deemed to be empty.
-  std::unordered_set<const DexType*> class_references;
+ClassReferences gather_class_references(const Scope& classes) {
+  ClassReferences class_references;
 
   walk::annotations(classes, [&](DexAnnotation* annotation)
     { process_annotation(&class_references, annotation); });
@@ -114,7 +111,11 @@ size_t remove_empty_classes(Scope& classes) {
             [](DexMethod*) { return true; },
             [&](DexMethod* meth, IRCode& code)
                { process_code(&class_references, meth, code); });
+  return class_references;
+}
 
+size_t remove_empty_classes(Scope& classes,
+                            ClassReferences class_references) {
   size_t classes_before_size = classes.size();
 
   // Ennumerate super classes.
@@ -133,6 +134,14 @@ size_t remove_empty_classes(Scope& classes) {
   return num_classes_removed;
 }
 
+void RemoveEmptyClassesPass::analyze_pass(const Scope& scope,
+                                          const PassManager& mgr) {
+  if (mgr.no_proguard_rules()) {
+    return;
+  }
+  m_class_references = gather_class_references(scope);
+}
+
 void RemoveEmptyClassesPass::run_pass(
     DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {
   if (mgr.no_proguard_rules()) {
@@ -140,7 +149,10 @@ void RemoveEmptyClassesPass::run_pass(
     return;
   }
   auto scope = build_class_scope(stores);
-  auto num_empty_classes_removed = remove_empty_classes(scope);
+  auto class_references = std::move(m_class_references);
+  m_class_references.clear();
+  auto num_empty_classes_removed =
+      remove_empty_classes(scope, std::move(class_references));
 
   mgr.incr_metric(METRIC_REMOVED_EMPTY_CLASSES, num_empty_classes_removed);
 
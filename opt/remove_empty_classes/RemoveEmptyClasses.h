@@ -7,11 +7,24 @@
 
 #pragma once
 
+#include <unordered_set>
+
 #include "PassManager.h"
 
+// The types of the classes which should not be deleted even if they are
+// deemed to be empty.
+using ClassReferences = std::unordered_set<const DexType*>;
+
 class RemoveEmptyClassesPass : public Pass {
  public:
   RemoveEmptyClassesPass() : Pass("RemoveEmptyClassesPass") {}
 
+  bool has_analysis() const override { return true; }
+
+  void analyze_pass(const Scope& scope, const PassManager& mgr) override;
+
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  ClassReferences m_class_references;
 };
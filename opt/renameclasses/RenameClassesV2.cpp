@@ -8,12 +8,14 @@
 #include "RenameClassesV2.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <string>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
@@ -166,13 +168,13 @@ RenameClassesPassV2::build_dont_rename_resources(
 
 std::unordered_set<std::string>
 RenameClassesPassV2::build_dont_rename_class_name_literals(Scope& scope) {
-  std::unordered_set<std::string> dont_rename_class_name_literals;
+  ConcurrentSet<std::string> dont_rename_class_name_literals;
 
   // Gather strings from const-string opcodes
   auto match = std::make_tuple(
     m::const_string(/* const-string {vX}, <any string> */)
   );
-  walk::matching_opcodes(scope, match,
+  walk::parallel::matching_opcodes(scope, match,
       [&](const DexMethod*, const std::vector<IRInstruction*>& insns){
         IRInstruction* const_string = insns[0];
         auto classname = JavaNameUtil::external_to_internal(
@@ -184,13 +186,15 @@ RenameClassesPassV2::build_dont_rename_class_name_literals(Scope& scope) {
           dont_rename_class_name_literals.insert(classname);
         }
       });
-  return dont_rename_class_name_literals;
+  return std::unordered_set<std::string>(
+      dont_rename_class_name_literals.begin(),
+      dont_rename_class_name_literals.end());
 }
 
 std::unordered_set<std::string>
 RenameClassesPassV2::build_dont_rename_for_types_with_reflection(
     Scope& scope, const ProguardMap& pg_map) {
-  std::unordered_set<std::string> dont_rename_class_for_types_with_reflection;
+  ConcurrentSet<std::string> dont_rename_class_for_types_with_reflection;
   std::unordered_set<DexType*> refl_map;
   for (auto const& refl_type_str : m_dont_rename_types_with_reflection) {
     auto deobf_cls_string = pg_map.translate_class(refl_type_str);
@@ -209,7 +213,7 @@ RenameClassesPassV2::build_dont_rename_for_types_with_reflection(
     }
   }
 
-  walk::opcodes(scope,
+  walk::parallel::opcodes(scope,
       [](DexMethod*) { return true; },
       [&](DexMethod* m, IRInstruction* insn) {
         if (insn->has_method()) {
@@ -224,7 +228,9 @@ RenameClassesPassV2::build_dont_rename_for_types_with_reflection(
           dont_rename_class_for_types_with_reflection.insert(classname);
         }
   });
-  return dont_rename_class_for_types_with_reflection;
+  return std::unordered_set<std::string>(
+      dont_rename_class_for_types_with_reflection.begin(),
+      dont_rename_class_for_types_with_reflection.end());
 }
 
 std::unordered_set<std::string> RenameClassesPassV2::build_dont_rename_canaries(
@@ -429,9 +435,10 @@ RenameClassesPassV2::build_dont_rename_annotated() {
   return dont_rename_annotated;
 }
 
+// DexStrings are unique, so the aliases are keyed by pointer.
 class AliasMap {
-  std::map<DexString*, DexString*, dexstrings_comparator> m_class_name_map;
-  std::map<DexString*, DexString*, dexstrings_comparator> m_extras_map;
+  std::unordered_map<DexString*, DexString*> m_class_name_map;
+  std::unordered_map<DexString*, DexString*> m_extras_map;
  public:
   void add_class_alias(DexClass* cls, DexString* alias) {
     m_class_name_map.emplace(cls->get_name(), alias);
@@ -439,18 +446,22 @@ class AliasMap {
   void add_alias(DexString* original, DexString* alias) {
     m_extras_map.emplace(original, alias);
   }
-  bool has(DexString* key) const {
-    return m_class_name_map.count(key) || m_extras_map.count(key);
-  }
-  DexString* at(DexString* key) const {
+  // Returns the alias of `key`, or nullptr if it has none.
+  DexString* find(DexString* key) const {
     auto it = m_class_name_map.find(key);
     if (it != m_class_name_map.end()) {
       return it->second;
     }
-    return m_extras_map.at(key);
+    auto extra_it = m_extras_map.find(key);
+    return extra_it == m_extras_map.end() ? nullptr : extra_it->second;
+  }
+  bool has(DexString* key) const { return find(key) != nullptr; }
+  DexString* at(DexString* key) const {
+    auto alias = find(key);
+    always_assert(alias != nullptr);
+    return alias;
   }
-  const std::map<DexString*, DexString*, dexstrings_comparator>& get_class_map()
-      const {
+  const std::unordered_map<DexString*, DexString*>& get_class_map() const {
     return m_class_name_map;
   }
 };
@@ -764,7 +775,8 @@ void RenameClassesPassV2::rename_classes(
   /* Now rewrite all const-string strings for force renamed classes. */
   auto match = std::make_tuple(m::const_string());
 
-  walk::matching_opcodes(
+  std::atomic<size_t> rewritten_const_strings{0};
+  walk::parallel::matching_opcodes(
       scope, match,
       [&](const DexMethod*, const std::vector<IRInstruction*>& insns) {
         IRInstruction* insn = insns[0];
@@ -778,30 +790,32 @@ void RenameClassesPassV2::rename_classes(
         // internal to begin with?
         DexString* alias_from = nullptr;
         DexString* alias_to = nullptr;
-        if (aliases.has(internal_str)) {
+        if (internal_str != nullptr &&
+            (alias_to = aliases.find(internal_str)) != nullptr) {
           alias_from = internal_str;
-          alias_to = aliases.at(internal_str);
           // Since we matched on external form, we need to map internal alias
           // back.
           // make_string here because the external form of the name may not be
           // present in the string table
           alias_to = DexString::make_string(
               JavaNameUtil::internal_to_external(alias_to->str()));
-        } else if (aliases.has(str)) {
+        } else if ((alias_to = aliases.find(str)) != nullptr) {
           alias_from = str;
-          alias_to = aliases.at(str);
         }
         if (alias_to) {
           DexType* alias_from_type = DexType::get_type(alias_from);
           DexClass* alias_from_cls = type_class(alias_from_type);
           if (m_force_rename_classes.count(alias_from_cls)) {
-            mgr.incr_metric(METRIC_REWRITTEN_CONST_STRINGS, 1);
+            ++rewritten_const_strings;
             insn->set_string(alias_to);
             TRACE(RENAME, 3, "Rewrote const-string \"%s\" to \"%s\"\n",
                 str->c_str(), alias_to->c_str());
           }
         }
       });
+  if (rewritten_const_strings > 0) {
+    mgr.incr_metric(METRIC_REWRITTEN_CONST_STRINGS, rewritten_const_strings);
+  }
 
   /* Now we need to re-write the Signature annotations.  They use
    * Strings rather than Type's, so they have to be explicitly
@@ -832,7 +846,7 @@ void RenameClassesPassV2::rename_classes(
   }
   static DexType *dalviksig =
     DexType::get_type("Ldalvik/annotation/Signature;");
-  walk::annotations(scope, [&](DexAnnotation* anno) {
+  walk::parallel::annotations(scope, [&](DexAnnotation* anno) {
     if (anno->type() != dalviksig) return;
     auto elems = anno->anno_elems();
     for (auto elem : elems) {
@@ -843,11 +857,11 @@ void RenameClassesPassV2::rename_classes(
       for (auto strev : *evs) {
         if (strev->evtype() != DEVT_STRING) continue;
         auto stringev = static_cast<DexEncodedValueString*>(strev);
-        if (aliases.has(stringev->string())) {
+        auto alias = aliases.find(stringev->string());
+        if (alias != nullptr) {
           TRACE(RENAME, 5, "Rewriting Signature from '%s' to '%s'\n",
-              stringev->string()->c_str(),
-              aliases.at(stringev->string())->c_str());
-          stringev->string(aliases.at(stringev->string()));
+              stringev->string()->c_str(), alias->c_str());
+          stringev->string(alias);
         }
       }
     }
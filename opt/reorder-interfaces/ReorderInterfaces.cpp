@@ -25,54 +25,36 @@
  * to increase consistency across Classes.
  */
 namespace {
-typedef std::unordered_map<const DexType*, int> CallFrequencyMap;
 
 /**
  * Helper class to implement the pass
  */
 class ReorderInterfacesImpl {
  public:
-  explicit ReorderInterfacesImpl(Scope& scope) : m_scope(scope) {}
-  void run();
+  ReorderInterfacesImpl(Scope& scope,
+                        const CallFrequencyMap& call_frequency_map)
+      : m_call_frequency_map(call_frequency_map), m_scope(scope) {}
+  void reorder_interfaces();
 
  private:
   // Map to store the number of method invokes for each Interface
-  CallFrequencyMap m_call_frequency_map;
+  const CallFrequencyMap& m_call_frequency_map;
 
   // Pointer to the Scope object used for the pass
   Scope& m_scope;
 
-  void compute_call_frequencies(IRInstruction* insn);
-  void reorder_interfaces();
+  int call_frequency(const DexType* interface) const;
   void reorder_interfaces_for_class(DexClass* cls);
   std::deque<DexType*> sort_interfaces(
       const std::deque<DexType*>& unsorted_list);
 };
 
-/**
- * Run the pass by first computing call frequencies for each interface
- * then sorting the list of Interfaces for each Class.
- */
-void ReorderInterfacesImpl::run() {
-  // Check out each instruction and process if it is a function invoke
-  walk::opcodes(m_scope,
-               [](DexMethod*) { return true; },
-               [this](DexMethod* /* unused */, IRInstruction* insn) {
-                 compute_call_frequencies(insn);
-               });
-
-  // Now that we have the invoke frequencies for each Interface,
-  // reorder the list of Interfaces for each Class.
-  reorder_interfaces();
-}
-
 /**
  * Check whether the given instruction is a call to an Interface.
  * If so, increment the call frequency to that Interface.
- *
- * This method is used when we walk the opcodes in ReorderInterfacesImpl::run.
  */
-void ReorderInterfacesImpl::compute_call_frequencies(IRInstruction* insn) {
+void compute_call_frequencies(const IRInstruction* insn,
+                              CallFrequencyMap& call_frequency_map) {
   // Process only call instructions
   if (is_invoke(insn->opcode())) {
     auto callee = insn->get_method();
@@ -87,13 +69,18 @@ void ReorderInterfacesImpl::compute_call_frequencies(IRInstruction* insn) {
       if (callee_cls) {
         // If we are calling into an Interface, count this call.
         if (is_interface(callee_cls)) {
-          m_call_frequency_map[callee_cls_type]++;
+          call_frequency_map[callee_cls_type]++;
         }
       }
     }
   }
 }
 
+int ReorderInterfacesImpl::call_frequency(const DexType* interface) const {
+  auto it = m_call_frequency_map.find(interface);
+  return it == m_call_frequency_map.end() ? 0 : it->second;
+}
+
 /**
  * Sort the list of given Interfaces with respect to the number of incoming
  * calls and return the sorted list
@@ -104,8 +91,7 @@ std::deque<DexType*> ReorderInterfacesImpl::sort_interfaces(
   // Create list of interfaces and store frequencies
   std::vector<std::pair<DexType*, int>> list_with_frequencies;
   for (auto interface : unsorted_list) {
-    list_with_frequencies.emplace_back(interface,
-                                       m_call_frequency_map[interface]);
+    list_with_frequencies.emplace_back(interface, call_frequency(interface));
   }
 
   // Sort the list with respect to number of calls for each Interface.
@@ -157,19 +143,32 @@ void ReorderInterfacesImpl::reorder_interfaces() {
     reorder_interfaces_for_class(cls);
   }
 }
+} // namespace
+
+/**
+ * Compute the number of function invocations for each Interface.
+ */
+void ReorderInterfacesPass::analyze_pass(const Scope& scope,
+                                         const PassManager& /* unused */) {
+  walk::read_opcodes(scope, [this](const DexMethod* /* unused */,
+                                   const IRInstruction* insn) {
+    compute_call_frequencies(insn, m_call_frequency_map);
+  });
 }
 
 /**
- * Compute the number of function invocations for each Interface and
- * sort the list of Interfaces for each Class.
+ * Now that we have the invoke frequencies for each Interface, sort the list
+ * of Interfaces for each Class.
  */
 void ReorderInterfacesPass::run_pass(DexStoresVector& stores,
                                      ConfigFiles& /* unused */,
                                      PassManager& /* unused */) {
   auto scope = build_class_scope(stores);
 
-  ReorderInterfacesImpl impl(scope);
-  impl.run();
+  auto call_frequency_map = std::move(m_call_frequency_map);
+  m_call_frequency_map.clear();
+  ReorderInterfacesImpl impl(scope, call_frequency_map);
+  impl.reorder_interfaces();
 }
 
 static ReorderInterfacesPass ri_pass;
@@ -7,13 +7,26 @@
 
 #pragma once
 
+#include <unordered_map>
+
+#include "DexClass.h"
 #include "Pass.h"
 
+// The number of method invokes for each Interface
+using CallFrequencyMap = std::unordered_map<const DexType*, int>;
+
 class ReorderInterfacesPass : public Pass {
  public:
   ReorderInterfacesPass() : Pass("ReorderInterfacesPass") {}
 
   virtual void configure_pass(const JsonWrapper& /* unused */) override {}
 
+  bool has_analysis() const override { return true; }
+
+  void analyze_pass(const Scope& scope, const PassManager& mgr) override;
+
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  CallFrequencyMap m_call_frequency_map;
 };
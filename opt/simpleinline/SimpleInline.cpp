@@ -47,6 +47,16 @@ void SimpleInlinePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassM
     });
   }
 
+  if (m_use_method_profile) {
+    if (cfg.get_method_to_weight().empty()) {
+      fprintf(stderr,
+              "WARNING: use_method_profile is set but no method profile was "
+              "provided\n");
+    } else {
+      m_inliner_config.method_to_weight = &cfg.get_method_to_weight();
+    }
+  }
+
   // inline candidates
   MultiMethodInliner inliner(scope, stores, methods, resolver,
                              m_inliner_config);
@@ -80,12 +90,17 @@ void SimpleInlinePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassM
       inliner.get_info().cross_store);
   TRACE(SINL, 3, "not found %ld\n", inliner.get_info().not_found);
   TRACE(SINL, 3, "caller too large %ld\n", inliner.get_info().caller_too_large);
+  TRACE(SINL, 3, "inlined into hot callers %ld\n",
+      inliner.get_info().hot_inlined);
+  TRACE(SINL, 3, "rejected cold callers %ld\n", inliner.get_info().cold_caller);
   TRACE(SINL, 1,
       "%ld inlined calls over %ld methods and %ld methods removed\n",
       inliner.get_info().calls_inlined, inlined_count, deleted);
 
   mgr.incr_metric("calls_inlined", inliner.get_info().calls_inlined);
   mgr.incr_metric("methods_removed", deleted);
+  mgr.incr_metric("hot_calls_inlined", inliner.get_info().hot_inlined);
+  mgr.incr_metric("cold_callers_skipped", inliner.get_info().cold_caller);
 }
 
 /**
@@ -31,6 +31,10 @@ class SimpleInlinePass : public Pass {
     jw.get("inline_small_non_deletables",
            false,
            m_inliner_config.inline_small_non_deletables);
+    jw.get("use_method_profile", false, m_use_method_profile);
+    jw.get("hot_caller_weight", 50, m_inliner_config.hot_caller_weight);
+    jw.get("cold_caller_weight", 1, m_inliner_config.cold_caller_weight);
+    jw.get("hot_callee_max_size", 24, m_inliner_config.hot_callee_max_size);
 
     jw.get("black_list", {}, m_black_list);
     jw.get("caller_black_list", {}, m_caller_black_list);
@@ -71,6 +75,9 @@ class SimpleInlinePass : public Pass {
   // inline virtual methods
   bool m_virtual_inline;
 
+  // drive inlining decisions with the method profile from ConfigFiles
+  bool m_use_method_profile;
+
   MultiMethodInliner::Config m_inliner_config;
 
   // annotations indicating not to inline a function
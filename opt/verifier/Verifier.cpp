@@ -40,10 +40,9 @@ void build_refs(
     const Scope& scope,
     refs_t& class_refs) {
   // TODO: walk through annotations
-  walk::opcodes(
+  walk::read_opcodes(
     scope,
-    [](const DexMethod*) { return true; },
-    [&](const DexMethod* meth, IRInstruction* insn) {
+    [&](const DexMethod* meth, const IRInstruction* insn) {
       if (insn->has_type()) {
         const auto tref = type_class(insn->get_type());
         if (tref) class_refs[tref].emplace(type_class(meth->get_class()));
@@ -152,6 +152,9 @@ def run_redex_binary(state):
     args = [state.args.redex_binary] + [
         '--apkdir', state.extracted_apk_dir,
         '--outdir', state.dex_dir]
+    if state.native_apk:
+        args += ['--input-apk', state.args.input_apk,
+                 '--output-apk', state.args.out]
     if state.args.config:
         args += ['--config', state.args.config]
 
@@ -263,11 +266,46 @@ def move_dexen_to_directories(root, dexpaths):
     return res
 
 
-def unzip_apk(apk, destination_directory):
+def is_root_dex(filename):
+    return re.match(r'classes\d*\.dex$', filename) is not None
+
+
+def unzip_apk(apk, destination_directory, include=lambda filename: True):
     with zipfile.ZipFile(apk) as z:
+        members = []
         for info in z.infolist():
-            per_file_compression[info.filename] = info.compress_type
-        z.extractall(destination_directory)
+            if include(info.filename):
+                per_file_compression[info.filename] = info.compress_type
+                members.append(info)
+        z.extractall(destination_directory, members)
+
+
+def can_use_native_apk(args, extracted_apk_dir, root_dexen):
+    """
+    redex-all can read the dex files from the input apk and write the output
+    apk itself (--input-apk / --output-apk) when all the dex files are
+    classesN.dex files in the root of the apk, and nothing but those and the
+    files of the extracted apk has to go into the output apk.
+    """
+    if args.unpack_only or args.stop_pass or args.sign:
+        # Signing after redex-all has aligned the apk would break the
+        # alignment.
+        return False
+    if 'classes.dex' not in root_dexen:
+        return False
+    for mode in unpacker.SECONDARY_DEX_MODES:
+        if not isinstance(mode, unpacker.Api21DexMode) and \
+                mode.detect(extracted_apk_dir):
+            return False
+    if isdir(join(extracted_apk_dir, 'assets/secondary-program-dex-jars')):
+        # Api21DexMode writes a metadata file for the secondary dex files.
+        return False
+    if unpacker.ApplicationModule.detect(extracted_apk_dir):
+        return False
+    for _, _, filenames in os.walk(extracted_apk_dir):
+        if 'libs.xzs' in filenames or 'libs.zstd' in filenames:
+            return False
+    return True
 
 
 def zipalign(unaligned_apk_path, output_apk_path, ignore_zipalign, page_align):
@@ -554,8 +592,8 @@ class State(object):
     # This structure is only used for passing arguments between prepare_redex,
     # launch_redex_binary, finalize_redex
     def __init__(self, application_modules, args, config_dict, debugger,
-                 dex_dir, dexen, dex_mode, extracted_apk_dir, temporary_libs_dir,
-                 stop_pass_idx):
+                 dex_dir, dexen, dex_mode, extracted_apk_dir, native_apk,
+                 temporary_libs_dir, stop_pass_idx):
         self.application_modules = application_modules
         self.args = args
         self.config_dict = config_dict
@@ -564,6 +602,7 @@ class State(object):
         self.dexen = dexen
         self.dex_mode = dex_mode
         self.extracted_apk_dir = extracted_apk_dir
+        self.native_apk = native_apk
         self.temporary_libs_dir = temporary_libs_dir
         self.stop_pass_idx = stop_pass_idx
 
@@ -642,15 +681,26 @@ def prepare_redex(args):
         extracted_apk_dir = make_temp_dir('.redex_extracted_apk', debug_mode)
 
     log('Extracting apk...')
-    unzip_apk(args.input_apk, extracted_apk_dir)
-
-    dex_mode = unpacker.detect_secondary_dex_mode(extracted_apk_dir)
-    log('Detected dex mode ' + str(type(dex_mode).__name__))
+    # The dex files in the root of the apk are only extracted if redex-all
+    # can't read them from the apk itself.
+    with zipfile.ZipFile(args.input_apk) as z:
+        root_dexen = [name for name in z.namelist() if is_root_dex(name)]
+    unzip_apk(args.input_apk, extracted_apk_dir,
+              lambda filename: not is_root_dex(filename))
+    native_apk = can_use_native_apk(args, extracted_apk_dir, root_dexen)
     if not dex_dir:
         dex_dir = make_temp_dir('.redex_dexen', debug_mode)
 
-    log('Unpacking dex files')
-    dex_mode.unpackage(extracted_apk_dir, dex_dir)
+    if native_apk:
+        log('redex-all reads and writes the dex files of the apk')
+        dex_mode = None
+    else:
+        unzip_apk(args.input_apk, extracted_apk_dir, is_root_dex)
+        dex_mode = unpacker.detect_secondary_dex_mode(extracted_apk_dir)
+        log('Detected dex mode ' + str(type(dex_mode).__name__))
+
+        log('Unpacking dex files')
+        dex_mode.unpackage(extracted_apk_dir, dex_dir)
 
     log('Detecting Application Modules')
     application_modules = unpacker.ApplicationModule.detect(extracted_apk_dir)
@@ -707,7 +757,10 @@ def prepare_redex(args):
 
     # Move each dex to a separate temporary directory to be operated by
     # redex.
-    dexen = move_dexen_to_directories(dex_dir, dex_glob(dex_dir))
+    if native_apk:
+        dexen = []
+    else:
+        dexen = move_dexen_to_directories(dex_dir, dex_glob(dex_dir))
     for store in store_files:
         dexen.append(store)
     log('Unpacking APK finished in {:.2f} seconds'.format(
@@ -736,7 +789,8 @@ def prepare_redex(args):
             (key, value, key_value_str, prev_value))
         config_dict[key] = value
 
-    log('Running redex-all on {} dex files '.format(len(dexen)))
+    if not native_apk:
+        log('Running redex-all on {} dex files '.format(len(dexen)))
     if args.lldb:
         debugger = 'lldb'
     elif args.gdb:
@@ -753,6 +807,7 @@ def prepare_redex(args):
         dexen=dexen,
         dex_mode=dex_mode,
         extracted_apk_dir=extracted_apk_dir,
+        native_apk=native_apk,
         temporary_libs_dir=temporary_libs_dir,
         stop_pass_idx=stop_pass_idx)
 
@@ -763,6 +818,11 @@ def finalize_redex(state):
     if state.temporary_libs_dir is not None:
         shutil.rmtree(state.temporary_libs_dir)
 
+    if state.native_apk:
+        # redex-all has written the output apk already.
+        finalize_redex_outputs(state)
+        return
+
     repack_start_time = timer()
 
     log('Repacking dex files')
@@ -790,6 +850,10 @@ def finalize_redex(state):
                       state.args.keyalias, state.args.keypass, state.args.ignore_zipalign, state.args.page_align_libs)
     log('Creating output APK finished in {:.2f} seconds'.format(
         timer() - repack_start_time))
+    finalize_redex_outputs(state)
+
+
+def finalize_redex_outputs(state):
     copy_file_to_out_dir(state.dex_dir, state.args.out,
                          'redex-line-number-map', 'line number map', 'redex-line-number-map')
     copy_file_to_out_dir(state.dex_dir, state.args.out, 'redex-line-number-map-v2',
@@ -7,6 +7,11 @@
 
 #include "file-utils.h"
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 size_t FileHandle::fwrite_impl(const void* p, size_t size, size_t count) {
   auto ret = ::fwrite(p, size, count, fh_);
   return ret;
@@ -22,6 +27,48 @@ size_t FileHandle::fread(void* p, size_t size, size_t count) {
   return ::fread(p, size, count, fh_);
 }
 
+size_t FileHandle::copy_from(FileHandle& in) {
+  size_t copied = 0;
+#if defined(__linux__) && defined(__NR_copy_file_range)
+  flush();
+  if (fh_ != nullptr && in.fh_ != nullptr && ::fflush(fh_) == 0) {
+    int in_fd = fileno(in.fh_);
+    int out_fd = fileno(fh_);
+    // The stdio position of `in`, which may be behind the position of its
+    // file descriptor because of buffering.
+    loff_t in_off = ::ftell(in.fh_);
+    while (in_off >= 0) {
+      auto ret = syscall(__NR_copy_file_range, in_fd, &in_off, out_fd,
+                         nullptr, 1 << 30, 0);
+      if (ret <= 0) {
+        // Either the end of the input, or the copy is not supported between
+        // these files; the loop below takes care of whatever is left.
+        break;
+      }
+      copied += ret;
+    }
+    if (copied > 0) {
+      // Sync the stdio streams with the file descriptors we moved.
+      CHECK(::fseek(in.fh_, in_off, SEEK_SET) == 0);
+      CHECK(::fseek(fh_, ::lseek(out_fd, 0, SEEK_CUR), SEEK_SET) == 0);
+      bytes_written_ += copied;
+    }
+  }
+#endif
+
+  constexpr int kBufSize = 0x80000;
+  std::unique_ptr<char[]> buf(new char[kBufSize]);
+  do {
+    auto num_read = in.fread(buf.get(), 1, kBufSize);
+    CHECK(!in.ferror());
+    if (num_read > 0) {
+      CHECK(this->fwrite(buf.get(), 1, num_read) == num_read);
+      copied += num_read;
+    }
+  } while (!in.feof());
+  return copied;
+}
+
 bool FileHandle::feof() { return ::feof(fh_) != 0; }
 
 bool FileHandle::ferror() { return ::ferror(fh_) != 0; }
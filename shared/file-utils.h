@@ -48,6 +48,11 @@ class FileHandle {
   virtual size_t fwrite(const void* p, size_t size, size_t count);
   size_t fread(void* ptr, size_t size, size_t count);
 
+  // Appends the rest of `in` to this file and returns the number of bytes
+  // copied. Where the platform allows it, the data is copied by the kernel
+  // without going through user space buffers.
+  size_t copy_from(FileHandle& in);
+
   template <typename T>
   std::unique_ptr<T> read_object() {
     auto ret = std::unique_ptr<T>(new T);
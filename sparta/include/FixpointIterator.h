@@ -36,9 +36,16 @@ namespace sparta {
  *  static const NodeId target(const Graph& graph, const EdgeId& e) { ... }
  *
  *  // Edges is an arbitrary type representing a collection of edges. The only
- *  // requirement is that it must define a standard iterator interface.
+ *  // requirement is that it must define a standard iterator interface and
+ *  // `empty()`. Returning a reference to the edges stored in the graph avoids
+ *  // a copy at each call.
  *  static Edges predecessors(const Graph& graph, const NodeId& m) { ... }
  *  static Edges successors(const Graph& graph, const NodeId& m) { ... }
+ *
+ *  // Optional: maps the nodes to integers smaller than `size(graph)`, which
+ *  // lets the MonotonicFixpointIterator use arrays instead of hash tables.
+ *  static size_t index(const Graph& graph, const NodeId& m) { ... }
+ *  static size_t size(const Graph& graph) { ... }
  * }
  *
  */
@@ -64,18 +71,19 @@ class FixpointIterator {
         std::is_same<decltype(GraphInterface::entry(std::declval<Graph>())),
                      NodeId>::value,
         "No implementation of entry()");
+    using Predecessors = typename std::decay<decltype(
+        GraphInterface::predecessors(std::declval<Graph>(),
+                                     std::declval<NodeId>()))>::type;
+    using Successors = typename std::decay<decltype(GraphInterface::successors(
+        std::declval<Graph>(), std::declval<NodeId>()))>::type;
     static_assert(
-        !std::is_same<typename std::iterator_traits<typename decltype(
-                          GraphInterface::predecessors(
-                              std::declval<Graph>(),
-                              std::declval<NodeId>()))::iterator>::value_type,
+        !std::is_same<typename std::iterator_traits<
+                          typename Predecessors::iterator>::value_type,
                       void>::value,
         "No implementation of predecessors() that returns an iterable type");
     static_assert(
-        !std::is_same<typename std::iterator_traits<typename decltype(
-                          GraphInterface::successors(
-                              std::declval<Graph>(),
-                              std::declval<NodeId>()))::iterator>::value_type,
+        !std::is_same<typename std::iterator_traits<
+                          typename Successors::iterator>::value_type,
                       void>::value,
         "No implementation of successors() that returns an iterable type");
     static_assert(
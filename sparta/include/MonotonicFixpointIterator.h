@@ -20,6 +20,160 @@
 
 namespace sparta {
 
+namespace mfp_impl {
+
+template <typename... Ts>
+struct make_void {
+  using type = void;
+};
+
+/*
+ * A graph interface may map the nodes of a graph to small integers, e.g., the
+ * block identifiers of a control-flow graph, by providing:
+ *
+ *   static size_t index(const Graph&, const NodeId&);
+ *   static size_t size(const Graph&);
+ *
+ * where `size` is larger than all the indices of the nodes in the graph. The
+ * fixpoint iterator then keeps its tables in flat arrays indexed by node.
+ */
+template <typename GraphInterface, typename = void>
+struct has_dense_node_ids : std::false_type {};
+
+template <typename GraphInterface>
+struct has_dense_node_ids<
+    GraphInterface,
+    typename make_void<
+        decltype(GraphInterface::index(
+            std::declval<const typename GraphInterface::Graph&>(),
+            std::declval<const typename GraphInterface::NodeId&>())),
+        decltype(GraphInterface::size(
+            std::declval<const typename GraphInterface::Graph&>()))>::type>
+    : std::true_type {};
+
+/*
+ * A table that associates values to the nodes of a graph.
+ */
+template <typename GraphInterface,
+          typename Value,
+          typename NodeHash,
+          bool dense = has_dense_node_ids<GraphInterface>::value>
+class NodeTable final {
+ public:
+  using Graph = typename GraphInterface::Graph;
+  using NodeId = typename GraphInterface::NodeId;
+
+  NodeTable(const Graph&, size_t size_hint) : m_table(size_hint) {}
+
+  const Value* find(const NodeId& node) const {
+    auto it = m_table.find(node);
+    return it == m_table.end() ? nullptr : &it->second;
+  }
+
+  Value& operator[](const NodeId& node) { return m_table[node]; }
+
+  void erase(const NodeId& node) { m_table.erase(node); }
+
+  void clear() { m_table.clear(); }
+
+ private:
+  std::unordered_map<NodeId, Value, NodeHash> m_table;
+};
+
+template <typename GraphInterface, typename Value, typename NodeHash>
+class NodeTable<GraphInterface, Value, NodeHash, /* dense */ true> final {
+ public:
+  using Graph = typename GraphInterface::Graph;
+  using NodeId = typename GraphInterface::NodeId;
+
+  NodeTable(const Graph& graph, size_t)
+      : m_graph(graph),
+        m_values(GraphInterface::size(graph)),
+        m_present(GraphInterface::size(graph), false) {}
+
+  const Value* find(const NodeId& node) const {
+    size_t i = GraphInterface::index(m_graph, node);
+    return (i < m_present.size() && m_present[i]) ? &m_values[i] : nullptr;
+  }
+
+  Value& operator[](const NodeId& node) {
+    size_t i = GraphInterface::index(m_graph, node);
+    if (i >= m_present.size()) {
+      m_values.resize(i + 1);
+      m_present.resize(i + 1, false);
+    }
+    if (!m_present[i]) {
+      // Same as inserting a default-constructed value in a hash table.
+      m_values[i] = Value();
+      m_present[i] = true;
+    }
+    return m_values[i];
+  }
+
+  void erase(const NodeId& node) {
+    size_t i = GraphInterface::index(m_graph, node);
+    if (i < m_present.size()) {
+      m_present[i] = false;
+    }
+  }
+
+  void clear() { std::fill(m_present.begin(), m_present.end(), false); }
+
+ private:
+  const Graph& m_graph;
+  std::vector<Value> m_values;
+  std::vector<bool> m_present;
+};
+
+/*
+ * The targets of the edges returned by `GraphInterface::successors()`. When
+ * the graph interface returns a reference to the edges stored in the graph,
+ * the WTO can be computed without allocating a vector of nodes at each step.
+ */
+template <typename GraphInterface>
+class SuccessorNodes final {
+ public:
+  using Graph = typename GraphInterface::Graph;
+  using NodeId = typename GraphInterface::NodeId;
+  using Edges = decltype(GraphInterface::successors(
+      std::declval<const Graph&>(), std::declval<const NodeId&>()));
+  using EdgeIterator = decltype(
+      std::declval<const typename std::decay<Edges>::type&>().begin());
+
+  class iterator {
+   public:
+    iterator(const Graph& graph, EdgeIterator it) : m_graph(&graph), m_it(it) {}
+
+    NodeId operator*() const { return GraphInterface::target(*m_graph, *m_it); }
+
+    iterator& operator++() {
+      ++m_it;
+      return *this;
+    }
+
+    bool operator!=(const iterator& other) const { return m_it != other.m_it; }
+
+   private:
+    const Graph* m_graph;
+    EdgeIterator m_it;
+  };
+
+  SuccessorNodes(const Graph& graph, const NodeId& node)
+      : m_graph(graph), m_edges(GraphInterface::successors(graph, node)) {}
+
+  bool empty() const { return m_edges.empty(); }
+
+  iterator begin() const { return iterator(m_graph, m_edges.begin()); }
+
+  iterator end() const { return iterator(m_graph, m_edges.end()); }
+
+ private:
+  const Graph& m_graph;
+  Edges m_edges;
+};
+
+} // namespace mfp_impl
+
 /*
  * This data structure contains the current state of the fixpoint iteration,
  * which is provided to the user when an extrapolation step is executed, so as
@@ -29,47 +183,42 @@ namespace sparta {
  * analyzed in the current local stabilization loop (please see Bourdoncle's
  * paper for more details on the recursive iteration strategy).
  */
-template <typename NodeId, typename Domain, typename NodeHash>
+template <typename GraphInterface, typename Domain, typename NodeHash>
 class MonotonicFixpointIteratorContext final {
  public:
+  using Graph = typename GraphInterface::Graph;
+  using NodeId = typename GraphInterface::NodeId;
+
   MonotonicFixpointIteratorContext() = delete;
   MonotonicFixpointIteratorContext(const MonotonicFixpointIteratorContext&) =
       delete;
 
   uint32_t get_local_iterations_for(const NodeId& node) const {
-    auto it = m_local_iterations.find(node);
-    if (it == m_local_iterations.end()) {
-      return 0;
-    }
-    return it->second;
+    auto count = m_local_iterations.find(node);
+    return count == nullptr ? 0 : *count;
   }
 
   uint32_t get_global_iterations_for(const NodeId& node) const {
-    auto it = m_global_iterations.find(node);
-    if (it == m_global_iterations.end()) {
-      return 0;
-    }
-    return it->second;
+    auto count = m_global_iterations.find(node);
+    return count == nullptr ? 0 : *count;
   }
 
  private:
-  explicit MonotonicFixpointIteratorContext(const Domain& init)
-      : m_init(init) {}
+  using IterationTable =
+      mfp_impl::NodeTable<GraphInterface, uint32_t, NodeHash>;
 
-  const Domain& get_initial_value() const { return m_init; }
+  MonotonicFixpointIteratorContext(const Graph& graph,
+                                   const Domain& init,
+                                   size_t size_hint)
+      : m_init(init),
+        m_global_iterations(graph, size_hint),
+        m_local_iterations(graph, size_hint) {}
 
-  void increase_iteration_count(
-      const NodeId& node,
-      std::unordered_map<NodeId, uint32_t, NodeHash>* table) {
-    auto insertion = table->insert({node, 1});
-    if (insertion.second == false) {
-      ++insertion.first->second;
-    }
-  }
+  const Domain& get_initial_value() const { return m_init; }
 
   void increase_iteration_count_for(const NodeId& node) {
-    increase_iteration_count(node, &m_local_iterations);
-    increase_iteration_count(node, &m_global_iterations);
+    ++m_local_iterations[node];
+    ++m_global_iterations[node];
   }
 
   void reset_local_iteration_count_for(const NodeId& node) {
@@ -77,8 +226,8 @@ class MonotonicFixpointIteratorContext final {
   }
 
   const Domain& m_init;
-  std::unordered_map<NodeId, uint32_t, NodeHash> m_global_iterations;
-  std::unordered_map<NodeId, uint32_t, NodeHash> m_local_iterations;
+  IterationTable m_global_iterations;
+  IterationTable m_local_iterations;
 
   template <typename T1, typename T2, typename T3>
   friend class MonotonicFixpointIterator;
@@ -93,6 +242,10 @@ class MonotonicFixpointIteratorContext final {
  *
  *   F. Bourdoncle. Efficient chaotic iteration strategies with widenings.
  *   In Formal Methods in Programming and Their Applications, pp 128-141.
+ *
+ * If the graph interface maps nodes to dense indices (see
+ * `mfp_impl::has_dense_node_ids`), the abstract states and the auxiliary data
+ * structures of the WTO are stored in flat arrays rather than hash tables.
  */
 template <typename GraphInterface,
           typename Domain,
@@ -103,7 +256,8 @@ class MonotonicFixpointIterator
   using Graph = typename GraphInterface::Graph;
   using NodeId = typename GraphInterface::NodeId;
   using EdgeId = typename GraphInterface::EdgeId;
-  using Context = MonotonicFixpointIteratorContext<NodeId, Domain, NodeHash>;
+  using Context =
+      MonotonicFixpointIteratorContext<GraphInterface, Domain, NodeHash>;
 
   /*
    * When the number of nodes in the CFG is known, it's better to provide it to
@@ -112,20 +266,11 @@ class MonotonicFixpointIterator
    */
   MonotonicFixpointIterator(const Graph& graph, size_t cfg_size_hint = 4)
       : m_graph(graph),
-        m_wto(GraphInterface::entry(graph),
-              [=, &graph](const NodeId& x) {
-                const auto& succ_edges = GraphInterface::successors(graph, x);
-                std::vector<NodeId> succ_nodes;
-                std::transform(succ_edges.begin(),
-                               succ_edges.end(),
-                               std::back_inserter(succ_nodes),
-                               std::bind(&GraphInterface::target,
-                                         std::ref(graph),
-                                         std::placeholders::_1));
-                return succ_nodes;
-              }),
-        m_entry_states(cfg_size_hint),
-        m_exit_states(cfg_size_hint) {}
+        m_cfg_size_hint(cfg_size_hint),
+        m_wto(build_wto(
+            graph, mfp_impl::has_dense_node_ids<GraphInterface>())),
+        m_entry_states(graph, cfg_size_hint),
+        m_exit_states(graph, cfg_size_hint) {}
 
   /*
    * This method is invoked on the head of an SCC at each iteration, whenever
@@ -157,7 +302,7 @@ class MonotonicFixpointIterator
    */
   void run(const Domain& init) {
     clear();
-    Context context(init);
+    Context context(m_graph, init, m_cfg_size_hint);
     for (const WtoComponent<NodeId>& component : m_wto) {
       analyze_component(&context, component);
     }
@@ -167,15 +312,15 @@ class MonotonicFixpointIterator
    * Returns the invariant computed by the fixpoint iterator at a node entry.
    */
   Domain get_entry_state_at(const NodeId& node) const {
-    auto it = m_entry_states.find(node);
-    return (it == m_entry_states.end()) ? Domain::bottom() : it->second;
+    auto state = m_entry_states.find(node);
+    return (state == nullptr) ? Domain::bottom() : *state;
   }
 
   /*
    * Returns the invariant computed by the fixpoint iterator at a node exit.
    */
   Domain get_exit_state_at(const NodeId& node) const {
-    auto it = m_exit_states.find(node);
+    auto state = m_exit_states.find(node);
     // It's impossible to get rid of this condition by initializing all exit
     // states to _|_ prior to starting the fixpoint iteration. The reason is
     // that we only have a partial view of the control-flow graph, i.e., all
@@ -190,10 +335,29 @@ class MonotonicFixpointIterator
     // When computing the entry state of A, we perform the join of the exit
     // states of all its predecessors, which include U. Since U is invisible to
     // the fixpoint iterator, there is no way to initialize its exit state.
-    return (it == m_exit_states.end()) ? Domain::bottom() : it->second;
+    return (state == nullptr) ? Domain::bottom() : *state;
   }
 
  private:
+  using WTO = WeakTopologicalOrdering<NodeId, NodeHash>;
+  using StateTable = mfp_impl::NodeTable<GraphInterface, Domain, NodeHash>;
+
+  static WTO build_wto(const Graph& graph, std::false_type /* dense */) {
+    return WTO(GraphInterface::entry(graph), [&graph](const NodeId& x) {
+      return mfp_impl::SuccessorNodes<GraphInterface>(graph, x);
+    });
+  }
+
+  static WTO build_wto(const Graph& graph, std::true_type /* dense */) {
+    return WTO(
+        GraphInterface::entry(graph),
+        [&graph](const NodeId& x) {
+          return mfp_impl::SuccessorNodes<GraphInterface>(graph, x);
+        },
+        [&graph](const NodeId& x) { return GraphInterface::index(graph, x); },
+        GraphInterface::size(graph));
+  }
+
   void clear() {
     m_entry_states.clear();
     m_exit_states.clear();
@@ -207,8 +371,12 @@ class MonotonicFixpointIterator
       placeholder->join_with(context->get_initial_value());
     }
     for (EdgeId edge : GraphInterface::predecessors(m_graph, node)) {
+      // See `get_exit_state_at` for why the exit state may be missing. We
+      // avoid copying the exit state when it's there.
+      auto exit_state =
+          m_exit_states.find(GraphInterface::source(m_graph, edge));
       placeholder->join_with(this->analyze_edge(
-          edge, get_exit_state_at(GraphInterface::source(m_graph, edge))));
+          edge, exit_state == nullptr ? Domain::bottom() : *exit_state));
     }
   }
 
@@ -247,8 +415,8 @@ class MonotonicFixpointIterator
         analyze_component(context, component);
       }
       // The current state of the iteration is represented by a pointer to the
-      // slot associated with the head node in the hash table of entry states.
-      // The state is updated in place within the hash table via side effects,
+      // slot associated with the head node in the table of entry states.
+      // The state is updated in place within the table via side effects,
       // which avoids costly copies and allocations.
       Domain* current_state = &m_entry_states[head];
       Domain new_state;
@@ -271,9 +439,10 @@ class MonotonicFixpointIterator
   }
 
   const Graph& m_graph;
-  WeakTopologicalOrdering<NodeId, NodeHash> m_wto;
-  std::unordered_map<NodeId, Domain, NodeHash> m_entry_states;
-  std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
+  size_t m_cfg_size_hint;
+  WTO m_wto;
+  StateTable m_entry_states;
+  StateTable m_exit_states;
 };
 
 /*
@@ -302,12 +471,10 @@ class BackwardsFixpointIterationAdaptor {
   static NodeId exit(const Graph& graph) {
     return GraphInterface::entry(graph);
   }
-  static std::vector<EdgeId> predecessors(const Graph& graph,
-                                          const NodeId& node) {
+  static decltype(auto) predecessors(const Graph& graph, const NodeId& node) {
     return GraphInterface::successors(graph, node);
   }
-  static std::vector<EdgeId> successors(const Graph& graph,
-                                        const NodeId& node) {
+  static decltype(auto) successors(const Graph& graph, const NodeId& node) {
     return GraphInterface::predecessors(graph, node);
   }
   static NodeId source(const Graph& graph, const EdgeId& edge) {
@@ -316,6 +483,16 @@ class BackwardsFixpointIterationAdaptor {
   static NodeId target(const Graph& graph, const EdgeId& edge) {
     return GraphInterface::source(graph, edge);
   }
+  // Node indices don't depend on the direction of edges.
+  template <typename GI = GraphInterface>
+  static auto index(const Graph& graph, const NodeId& node)
+      -> decltype(GI::index(graph, node)) {
+    return GI::index(graph, node);
+  }
+  template <typename GI = GraphInterface>
+  static auto size(const Graph& graph) -> decltype(GI::size(graph)) {
+    return GI::size(graph);
+  }
 };
 
 } // namespace sparta
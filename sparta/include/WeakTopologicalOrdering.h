@@ -13,7 +13,6 @@
 #include <iterator>
 #include <limits>
 #include <ostream>
-#include <stack>
 #include <unordered_map>
 #include <vector>
 
@@ -31,9 +30,15 @@ class WeakTopologicalOrdering;
 namespace wto_impl {
 
 // Forward declaration
-template <typename NodeId, typename NodeHash>
+template <typename NodeId, typename Successors, typename DfnTable>
 class WtoBuilder;
 
+template <typename NodeId, typename NodeHash>
+class HashedDfnTable;
+
+template <typename NodeId, typename NodeIndex>
+class DenseDfnTable;
+
 /*
  * Iterator over the subcomponents of a strongly connected component (head
  * node excluded). This is a regular C++ iterator meant for traversing a
@@ -190,24 +195,42 @@ class WeakTopologicalOrdering final {
 
   /*
    * In order to construct a WTO, we just need to specify the root of the graph
-   * and the successor function.
+   * and the successor function. The successor function may return any range of
+   * nodes that provides `empty()`, `begin()` and `end()`, which lets graphs
+   * that already store their successors avoid allocating a new vector for each
+   * call.
    */
-  WeakTopologicalOrdering(
-      const NodeId& root,
-      std::function<std::vector<NodeId>(const NodeId&)> successors) {
-    if (successors(root).empty()) {
-      // If the CFG consists of a single node with no control-flow edges, we
-      // don't need to run the general algorithm. This avoids building all the
-      // auxiliary data structures required by Bourdoncle's algorithm.
-      // This optimization benefits the simple parallel fixpoint iterator, which
-      // computes a WTO for each toplevel component of the CFG, most of them
-      // single nodes in practice.
-      m_components.emplace_back(root, WtoComponent<NodeId>::Kind::Vertex,
-                                /* position */ 0,
-                                /* next_component_position */ -1);
+  template <typename Successors>
+  WeakTopologicalOrdering(const NodeId& root, Successors successors) {
+    if (is_single_node(root, successors)) {
       return;
     }
-    wto_impl::WtoBuilder<NodeId, NodeHash> builder(successors, &m_components);
+    wto_impl::WtoBuilder<NodeId,
+                         Successors,
+                         wto_impl::HashedDfnTable<NodeId, NodeHash>>
+        builder(successors, {}, &m_components);
+    builder.build(root);
+  }
+
+  /*
+   * When the nodes of the graph can be mapped to small integers, e.g., the
+   * block identifiers of a control-flow graph, `index` maps a node to its
+   * integer and `num_indices` is an upper bound on all of them. The auxiliary
+   * data structures of the algorithm are then flat arrays instead of hash
+   * tables.
+   */
+  template <typename Successors, typename NodeIndex>
+  WeakTopologicalOrdering(const NodeId& root,
+                          Successors successors,
+                          NodeIndex index,
+                          size_t num_indices) {
+    if (is_single_node(root, successors)) {
+      return;
+    }
+    wto_impl::WtoBuilder<NodeId,
+                         Successors,
+                         wto_impl::DenseDfnTable<NodeId, NodeIndex>>
+        builder(successors, {index, num_indices}, &m_components);
     builder.build(root);
   }
 
@@ -226,16 +249,86 @@ class WeakTopologicalOrdering final {
   // It's also more cache-friendly when repeatedly traversing the WTO during
   // a fixpoint iteration.
   std::vector<WtoComponent<NodeId>> m_components;
+
+  template <typename Successors>
+  bool is_single_node(const NodeId& root, Successors& successors) {
+    if (!successors(root).empty()) {
+      return false;
+    }
+    // If the CFG consists of a single node with no control-flow edges, we
+    // don't need to run the general algorithm. This avoids building all the
+    // auxiliary data structures required by Bourdoncle's algorithm.
+    // This optimization benefits the simple parallel fixpoint iterator, which
+    // computes a WTO for each toplevel component of the CFG, most of them
+    // single nodes in practice.
+    m_components.emplace_back(root, WtoComponent<NodeId>::Kind::Vertex,
+                              /* position */ 0,
+                              /* next_component_position */ -1);
+    return true;
+  }
 };
 
 namespace wto_impl {
 
+/*
+ * The depth-first numbers of the nodes, where 0 stands for a node that hasn't
+ * been visited yet.
+ */
 template <typename NodeId, typename NodeHash>
+class HashedDfnTable final {
+ public:
+  uint32_t get(const NodeId& node) const {
+    auto it = m_dfn.find(node);
+    if (it != m_dfn.end()) {
+      return it->second;
+    }
+    return 0;
+  }
+
+  void set(const NodeId& node, uint32_t number) {
+    if (number == 0) {
+      m_dfn.erase(node);
+    } else {
+      m_dfn[node] = number;
+    }
+  }
+
+ private:
+  std::unordered_map<NodeId, uint32_t, NodeHash> m_dfn;
+};
+
+template <typename NodeId, typename NodeIndex>
+class DenseDfnTable final {
+ public:
+  DenseDfnTable(NodeIndex index, size_t num_indices)
+      : m_index(index), m_dfn(num_indices, 0) {}
+
+  uint32_t get(const NodeId& node) const {
+    size_t i = m_index(node);
+    return i < m_dfn.size() ? m_dfn[i] : 0;
+  }
+
+  void set(const NodeId& node, uint32_t number) {
+    size_t i = m_index(node);
+    if (i >= m_dfn.size()) {
+      m_dfn.resize(i + 1, 0);
+    }
+    m_dfn[i] = number;
+  }
+
+ private:
+  NodeIndex m_index;
+  std::vector<uint32_t> m_dfn;
+};
+
+template <typename NodeId, typename Successors, typename DfnTable>
 class WtoBuilder final {
  public:
-  WtoBuilder(std::function<std::vector<NodeId>(const NodeId&)> successors,
+  WtoBuilder(Successors& successors,
+             DfnTable dfn,
              std::vector<WtoComponent<NodeId>>* wto_space)
       : m_successors(successors),
+        m_dfn(std::move(dfn)),
         m_wto_space(wto_space),
         m_free_position(0),
         m_num(0) {}
@@ -249,7 +342,7 @@ class WtoBuilder final {
   // algorithm.
 
   uint32_t visit(const NodeId& vertex, int32_t* partition) {
-    m_stack.push(vertex);
+    m_stack.push_back(vertex);
     uint32_t head = set_dfn(vertex, ++m_num);
     bool loop = false;
     for (const NodeId& succ : m_successors(vertex)) {
@@ -268,15 +361,15 @@ class WtoBuilder final {
     if (head == get_dfn(vertex)) {
       // We encode the special value +oo used in the paper with UINT32_MAX.
       set_dfn(vertex, std::numeric_limits<uint32_t>::max());
-      NodeId element = m_stack.top();
-      m_stack.pop();
+      NodeId element = m_stack.back();
+      m_stack.pop_back();
       if (loop) {
         // Nodes are required to be comparable using `operator==()`. We don't
         // assume `operator!=()` to be defined on nodes.
         while (!(element == vertex)) {
           set_dfn(element, 0);
-          element = m_stack.top();
-          m_stack.pop();
+          element = m_stack.back();
+          m_stack.pop_back();
         }
         push_component(vertex, *partition);
       }
@@ -296,30 +389,20 @@ class WtoBuilder final {
     }
   }
 
-  uint32_t get_dfn(const NodeId& node) {
-    auto it = m_dfn.find(node);
-    if (it != m_dfn.end()) {
-      return it->second;
-    }
-    return 0;
-  }
+  uint32_t get_dfn(const NodeId& node) { return m_dfn.get(node); }
 
   uint32_t set_dfn(const NodeId& node, uint32_t number) {
-    if (number == 0) {
-      m_dfn.erase(node);
-    } else {
-      m_dfn[node] = number;
-    }
+    m_dfn.set(node, number);
     return number;
   }
 
-  std::function<std::vector<NodeId>(const NodeId&)> m_successors;
+  Successors& m_successors;
+  // These are auxiliary data structures used by Bourdoncle's algorithm.
+  DfnTable m_dfn;
   std::vector<WtoComponent<NodeId>>* m_wto_space;
   // The next available position at the end of the vector of components.
   int32_t m_free_position;
-  // These are auxiliary data structures used by Bourdoncle's algorithm.
-  std::unordered_map<NodeId, uint32_t, NodeHash> m_dfn;
-  std::stack<NodeId> m_stack;
+  std::vector<NodeId> m_stack;
   uint32_t m_num;
 };
 
@@ -120,6 +120,7 @@ class Program final {
       m_predecessors;
 
   friend class ProgramInterface;
+  friend class DenseProgramInterface;
 };
 
 class ProgramInterface {
@@ -142,19 +143,39 @@ class ProgramInterface {
   static NodeId target(const Graph&, const EdgeId& e) { return e->second; }
 };
 
+/*
+ * The same interface, where the numeric labels of the program are used as node
+ * indices, so that the fixpoint iterator stores its states in arrays.
+ */
+class DenseProgramInterface : public ProgramInterface {
+ public:
+  static size_t index(const Graph&, const NodeId& node) {
+    return std::stoul(node.label);
+  }
+  static size_t size(const Graph& graph) {
+    return graph.m_statements.size() + 1;
+  }
+};
+
 /*
  * The abstract domain for liveness is just the powerset domain of variables.
  */
 using LivenessDomain = HashedSetAbstractDomain<std::string>;
 
-class FixpointEngine final
+template <typename Interface>
+class LivenessFixpointEngine final
     : public MonotonicFixpointIterator<
-          BackwardsFixpointIterationAdaptor<ProgramInterface>,
+          BackwardsFixpointIterationAdaptor<Interface>,
           LivenessDomain,
           boost::hash<ControlPoint>> {
  public:
-  explicit FixpointEngine(const Program& program)
-      : MonotonicFixpointIterator(program), m_program(program) {}
+  using EdgeId = typename Interface::EdgeId;
+
+  explicit LivenessFixpointEngine(const Program& program)
+      : MonotonicFixpointIterator<BackwardsFixpointIterationAdaptor<Interface>,
+                                  LivenessDomain,
+                                  boost::hash<ControlPoint>>(program),
+        m_program(program) {}
 
   void analyze_node(const ControlPoint& node,
                     LivenessDomain* current_state) const override {
@@ -175,19 +196,31 @@ class FixpointEngine final
     // Since we performed a backward analysis by reversing the control-flow
     // graph, the set of live variables before executing a node is given by
     // the exit state at the node.
-    return get_exit_state_at(ControlPoint(node));
+    return this->get_exit_state_at(ControlPoint(node));
   }
 
   LivenessDomain get_live_out_vars_at(const std::string& node) {
     // Similarly, the set of live variables after executing a node is given by
     // the entry state at the node.
-    return get_entry_state_at(ControlPoint(node));
+    return this->get_entry_state_at(ControlPoint(node));
   }
 
  private:
   const Program& m_program;
 };
 
+using FixpointEngine = LivenessFixpointEngine<ProgramInterface>;
+using DenseFixpointEngine = LivenessFixpointEngine<DenseProgramInterface>;
+
+static_assert(
+    !mfp_impl::has_dense_node_ids<
+        BackwardsFixpointIterationAdaptor<ProgramInterface>>::value,
+    "ProgramInterface has no node indices");
+static_assert(
+    mfp_impl::has_dense_node_ids<
+        BackwardsFixpointIterationAdaptor<DenseProgramInterface>>::value,
+    "DenseProgramInterface has node indices");
+
 class MonotonicFixpointIteratorTest : public ::testing::Test {
  protected:
   MonotonicFixpointIteratorTest() : m_program1("1"), m_program2("1") {}
@@ -360,3 +393,20 @@ TEST_F(MonotonicFixpointIteratorTest, program2) {
   ASSERT_TRUE(fp.get_live_in_vars_at("7").is_bottom());
   ASSERT_TRUE(fp.get_live_out_vars_at("7").is_bottom());
 }
+
+TEST_F(MonotonicFixpointIteratorTest, denseNodeIds) {
+  for (const Program* program : {&this->m_program1, &this->m_program2}) {
+    FixpointEngine fp(*program);
+    fp.run(LivenessDomain());
+    DenseFixpointEngine dense_fp(*program);
+    dense_fp.run(LivenessDomain());
+    for (const std::string node : {"1", "2", "3", "4", "5", "6", "7"}) {
+      EXPECT_TRUE(fp.get_live_in_vars_at(node).equals(
+          dense_fp.get_live_in_vars_at(node)))
+          << node;
+      EXPECT_TRUE(fp.get_live_out_vars_at(node).equals(
+          dense_fp.get_live_out_vars_at(node)))
+          << node;
+    }
+  }
+}
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "BlockProfile.h"
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+namespace {
+
+// The block of `cfg` with a const of `literal` in it.
+cfg::Block* block_of_const(const cfg::ControlFlowGraph& cfg, int64_t literal) {
+  for (cfg::Block* b : cfg.blocks()) {
+    for (const auto& mie : InstructionIterable(b)) {
+      if (mie.insn->opcode() == OPCODE_CONST &&
+          mie.insn->get_literal() == literal) {
+        return b;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// The instructions from the const of `literal` to the next return.
+std::vector<MethodItemEntry*> block_insns(IRCode* code, int64_t literal) {
+  std::vector<MethodItemEntry*> result;
+  for (auto& mie : InstructionIterable(code)) {
+    if (result.empty() && !(mie.insn->opcode() == OPCODE_CONST &&
+                            mie.insn->get_literal() == literal)) {
+      continue;
+    }
+    result.push_back(&mie);
+    if (mie.insn->opcode() == OPCODE_RETURN) {
+      break;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+struct BlockProfileTest : public RedexTest {
+  BlockProfileTest() {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(get_object_type());
+    m_method = static_cast<DexMethod*>(DexMethod::make_method("LFoo;.bar:(I)I"));
+    m_method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_method->set_code(assembler::ircode_from_string(R"(
+      (
+        (load-param v0)
+        (const v1 0)
+        (if-eqz v0 :cold)
+
+        (const v1 1)
+        (return v1)
+
+        (:cold)
+        (const v1 2)
+        (return v1)
+      )
+    )"));
+    creator.add_method(m_method);
+    m_scope.push_back(creator.create());
+  }
+
+  // Counts the way InstrumentPass numbers the blocks: the entry and the hot
+  // block ran 100 times, the cold block never did.
+  std::unordered_map<std::string, cfg::BlockCounts> input_counts() {
+    auto code = m_method->get_code();
+    code->build_cfg(/* editable */ false);
+    cfg::BlockCounts counts;
+    counts.emplace(block_of_const(code->cfg(), 0)->id(), 100);
+    counts.emplace(block_of_const(code->cfg(), 1)->id(), 100);
+    code->clear_cfg();
+    return {{show(m_method), counts}};
+  }
+
+  DexMethod* m_method;
+  Scope m_scope;
+};
+
+TEST_F(BlockProfileTest, countsFollowTheInstructions) {
+  BlockProfile profile(m_scope, input_counts());
+  auto code = m_method->get_code();
+  EXPECT_TRUE(profile.has_counts(m_method));
+
+  // A pass adds an instruction to the cold block.
+  auto cold = block_insns(code, 2);
+  auto insn = new IRInstruction(OPCODE_CONST);
+  insn->set_dest(2)->set_literal(3);
+  code->insert_before(code->iterator_to(*cold.back()), insn);
+
+  code->build_cfg(/* editable */ true);
+  auto& cfg = code->cfg();
+  auto counts = profile.block_counts(m_method, cfg);
+  EXPECT_EQ(counts.size(), 3);
+  EXPECT_EQ(counts.at(block_of_const(cfg, 0)->id()), 100);
+  EXPECT_EQ(counts.at(block_of_const(cfg, 1)->id()), 100);
+  EXPECT_EQ(counts.at(block_of_const(cfg, 2)->id()), 0);
+  code->clear_cfg();
+}
+
+TEST_F(BlockProfileTest, newCodeTakesThePredecessorCount) {
+  BlockProfile profile(m_scope, input_counts());
+  auto code = m_method->get_code();
+
+  // A pass replaces the instructions of the hot block with new ones.
+  for (auto mie : block_insns(code, 1)) {
+    mie->insn = new IRInstruction(*mie->insn);
+  }
+
+  code->build_cfg(/* editable */ true);
+  auto& cfg = code->cfg();
+  auto counts = profile.block_counts(m_method, cfg);
+  EXPECT_EQ(counts.at(block_of_const(cfg, 1)->id()), 100);
+  EXPECT_EQ(counts.at(block_of_const(cfg, 2)->id()), 0);
+  code->clear_cfg();
+}
+
+TEST_F(BlockProfileTest, otherMethodsHaveNoCounts) {
+  BlockProfile profile(m_scope, {{"LFoo;.baz:()V", {{0, 1}}}});
+  EXPECT_FALSE(profile.has_counts(m_method));
+  auto code = m_method->get_code();
+  code->build_cfg(/* editable */ true);
+  EXPECT_TRUE(profile.block_counts(m_method, code->cfg()).empty());
+  code->clear_cfg();
+}
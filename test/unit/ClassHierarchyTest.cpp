@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ClassHierarchy.h"
+#include "DexUtil.h"
+#include "RedexTest.h"
+#include "ScopeHelper.h"
+#include "TypeSystem.h"
+
+struct ClassHierarchyTest : public RedexTest {};
+
+TEST_F(ClassHierarchyTest, externalClassesPublishedLaterAreIncluded) {
+  Scope scope = create_empty_scope();
+  auto obj_t = get_object_type();
+  auto ext_t = DexType::make_type("LExt;");
+  create_external_class(ext_t, obj_t, {});
+  auto a_t = DexType::make_type("LA;");
+  scope.push_back(create_internal_class(a_t, ext_t, {}));
+
+  auto hierarchy = build_type_hierarchy(scope);
+  EXPECT_EQ(get_children(hierarchy, obj_t).count(ext_t), 1);
+  EXPECT_EQ(get_children(hierarchy, ext_t), TypeSet{a_t});
+
+  // The hierarchy of the external classes is built once...
+  auto external = g_redex->external_hierarchy();
+  EXPECT_EQ(g_redex->external_hierarchy(), external);
+
+  // ...and rebuilt once it is stale.
+  auto ext2_t = DexType::make_type("LExt2;");
+  create_external_class(ext2_t, ext_t, {});
+  hierarchy = build_type_hierarchy(scope);
+  EXPECT_EQ(get_children(hierarchy, ext_t), (TypeSet{a_t, ext2_t}));
+}
+
+TEST_F(ClassHierarchyTest, externalInterfaceChildren) {
+  Scope scope = create_empty_scope();
+  auto obj_t = get_object_type();
+  auto ext_i_t = DexType::make_type("LExtI;");
+  create_external_class(ext_i_t, obj_t, {}, ACC_PUBLIC | ACC_INTERFACE);
+  auto i_t = DexType::make_type("LI;");
+  scope.push_back(
+      create_internal_class(i_t, obj_t, {ext_i_t}, ACC_PUBLIC | ACC_INTERFACE));
+
+  EXPECT_EQ(TypeSystem(scope).get_interface_children(ext_i_t), TypeSet{i_t});
+
+  auto ext_j_t = DexType::make_type("LExtJ;");
+  create_external_class(ext_j_t, obj_t, {ext_i_t}, ACC_PUBLIC | ACC_INTERFACE);
+  EXPECT_EQ(TypeSystem(scope).get_interface_children(ext_i_t),
+            (TypeSet{i_t, ext_j_t}));
+}
@@ -232,3 +232,121 @@ TEST_F(ConcurrentContainersTest, concurrentMapTest) {
   map.clear();
   EXPECT_EQ(0, map.size());
 }
+
+TEST_F(ConcurrentContainersTest, readMostlyConcurrentMapTest) {
+  ReadMostlyConcurrentMap<std::string, uint32_t> map;
+
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      std::string s = std::to_string(sample[i]);
+      map.insert({s, sample[i]});
+      EXPECT_EQ(1, map.count(s));
+      EXPECT_EQ(sample[i], map.get(s, 0));
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), map.size());
+  EXPECT_EQ(m_data_set.size(), std::distance(map.begin(), map.end()));
+
+  std::unordered_map<uint32_t, size_t> occurrences;
+  for (uint32_t x : m_data) {
+    ++occurrences[x];
+  }
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      std::string s = std::to_string(sample[i]);
+      map.update(s,
+                 [&s](const std::string& key, uint32_t& value, bool key_exists) {
+                   EXPECT_EQ(s, key);
+                   EXPECT_TRUE(key_exists);
+                   ++value;
+                 });
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), map.size());
+  auto check_initial_values =
+      [&](const ReadMostlyConcurrentMap<std::string, uint32_t>& map) {
+        for (uint32_t x : m_data) {
+          std::string s = std::to_string(x);
+          EXPECT_EQ(1, map.count(s));
+          auto it = map.find(s);
+          ASSERT_NE(map.end(), it);
+          EXPECT_EQ(s, it->first);
+          EXPECT_EQ(x + occurrences[x], it->second);
+          EXPECT_EQ(x + occurrences[x], map.at(s));
+        }
+      };
+  check_initial_values(map);
+  map.compact();
+  check_initial_values(map);
+
+  auto copy = map;
+
+  run_on_subset_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.erase(std::to_string(sample[i]));
+    }
+  });
+  map.compact();
+
+  for (uint32_t x : m_subset_data) {
+    std::string s = std::to_string(x);
+    EXPECT_EQ(0, map.count(s));
+    EXPECT_EQ(map.end(), map.find(s));
+  }
+
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.erase(std::to_string(sample[i]));
+    }
+  });
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.end(), map.begin());
+  EXPECT_THROW(map.at("0"), std::out_of_range);
+
+  // Check that copy is unchanged.
+  check_initial_values(copy);
+
+  auto moved = std::move(copy);
+  check_initial_values(moved);
+
+  map.insert({{"a", 1}, {"b", 2}, {"c", 3}});
+  map.insert_or_assign({"a", 4});
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ(4, map.at("a"));
+  map.clear();
+  EXPECT_EQ(0, map.size());
+}
+
+TEST_F(ConcurrentContainersTest, readMostlyConcurrentMapReadWhileWriting) {
+  // Half of the threads insert the data while the other half keep looking it
+  // up: a key that was found once must always be found with the same value.
+  ReadMostlyConcurrentMap<uint32_t, uint32_t> map;
+  std::vector<boost::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    if (t % 2 == 0) {
+      threads.emplace_back([&map, &sample = m_samples[t]]() {
+        for (uint32_t x : sample) {
+          map.emplace(x, x + 1);
+        }
+      });
+    } else {
+      threads.emplace_back([&map, this]() {
+        std::unordered_set<uint32_t> found;
+        for (size_t round = 0; round < 10; ++round) {
+          for (uint32_t x : m_data) {
+            auto value = map.get(x, 0);
+            if (value != 0) {
+              EXPECT_EQ(x + 1, value);
+              found.insert(x);
+            } else {
+              EXPECT_EQ(0, found.count(x));
+            }
+          }
+        }
+      });
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
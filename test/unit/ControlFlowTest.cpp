@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 
 #include "ControlFlow.h"
+#include "Dominators.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 
@@ -1184,3 +1185,129 @@ TEST(ControlFlow, line_numbers) {
 
   delete g_redex;
 }
+
+TEST(ControlFlow, profile_guided_layout) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :hot)
+
+      (const v1 1)
+      (goto :exit)
+
+      (:hot)
+      (const v2 2)
+
+      (:exit)
+      (return-void)
+    )
+  )");
+
+  code->build_cfg(/* editable */ true);
+  auto& cfg = code->cfg();
+  BlockCounts counts;
+  for (Block* b : cfg.blocks()) {
+    auto first = b->get_first_insn();
+    if (first != b->end() && first->insn->opcode() == OPCODE_CONST &&
+        first->insn->get_literal() == 1) {
+      // the cold block has no count
+      continue;
+    }
+    counts.emplace(b->id(), 100);
+  }
+  cfg.set_block_counts(counts);
+  code->clear_cfg();
+
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-nez v0 :cold)
+
+      (const v2 2)
+
+      (:exit)
+      (return-void)
+
+      (:cold)
+      (const v1 1)
+      (goto :exit)
+    )
+  )");
+  EXPECT_EQ(assembler::to_s_expr(expected.get()),
+            assembler::to_s_expr(code.get()))
+      << "expected:\n"
+      << show(expected) << "\n"
+      << "actual:\n"
+      << show(code) << "\n";
+}
+
+TEST(ControlFlow, dominatorTreeAndLoops) {
+  //                 +---------+
+  //                 v         |
+  //     +---+     +---+     +---+     +---+
+  //     | 0 | --> | 1 | --> | 2 | --> | 5 |
+  //     +---+     +---+     +---+     +---+
+  //                |                    ^
+  //  +-------------+                    |
+  //  |    +---------+                   |
+  //  |    v         |                   |
+  //  |  +---+     +---+                 |
+  //  +> | 3 | --> | 4 | ----------------+
+  //     +---+     +---+
+  ControlFlowGraph cfg;
+  auto b0 = cfg.create_block();
+  auto b1 = cfg.create_block();
+  auto b2 = cfg.create_block();
+  auto b3 = cfg.create_block();
+  auto b4 = cfg.create_block();
+  auto b5 = cfg.create_block();
+  cfg.set_entry_block(b0);
+  cfg.add_edge(b0, b1, EDGE_GOTO);
+  cfg.add_edge(b1, b2, EDGE_GOTO);
+  cfg.add_edge(b2, b1, EDGE_GOTO);
+  cfg.add_edge(b1, b3, EDGE_GOTO);
+  cfg.add_edge(b3, b4, EDGE_GOTO);
+  cfg.add_edge(b4, b3, EDGE_GOTO);
+  cfg.add_edge(b4, b5, EDGE_GOTO);
+  cfg.add_edge(b2, b5, EDGE_GOTO);
+
+  const auto& dom = cfg.get_dominator_tree();
+  EXPECT_EQ(dom.idom(b0), nullptr);
+  EXPECT_EQ(dom.idom(b1), b0);
+  EXPECT_EQ(dom.idom(b2), b1);
+  EXPECT_EQ(dom.idom(b3), b1);
+  EXPECT_EQ(dom.idom(b4), b3);
+  EXPECT_EQ(dom.idom(b5), b1);
+  EXPECT_TRUE(dom.dominates(b1, b4));
+  EXPECT_TRUE(dom.dominates(b4, b4));
+  EXPECT_FALSE(dom.dominates(b2, b5));
+  EXPECT_EQ(dom.common_dominator(b2, b4), b1);
+  EXPECT_THAT(dom.frontier(b2), ::testing::UnorderedElementsAre(b1, b5));
+  EXPECT_THAT(dom.frontier(b4), ::testing::UnorderedElementsAre(b3, b5));
+  EXPECT_EQ(&dom, &cfg.get_dominator_tree());
+
+  const auto& pdom = cfg.get_post_dominator_tree();
+  EXPECT_EQ(pdom.idom(b5), nullptr);
+  EXPECT_EQ(pdom.idom(b2), b5);
+  EXPECT_EQ(pdom.idom(b4), b5);
+  EXPECT_EQ(pdom.idom(b1), b5);
+  EXPECT_TRUE(pdom.dominates(b5, b0));
+  EXPECT_FALSE(pdom.dominates(b2, b1));
+
+  const auto& loops = cfg.get_loop_info();
+  EXPECT_EQ(loops.loops().size(), 2);
+  EXPECT_TRUE(loops.is_loop_header(b1));
+  EXPECT_TRUE(loops.is_loop_header(b3));
+  EXPECT_EQ(loops.loop_depth(b0), 0);
+  EXPECT_EQ(loops.loop_depth(b2), 1);
+  EXPECT_EQ(loops.loop_depth(b4), 1);
+  EXPECT_EQ(loops.loop_depth(b5), 0);
+
+  // Nest the 3-4 loop in the 1-2 loop: the cached analyses are recomputed.
+  cfg.add_edge(b4, b1, EDGE_GOTO);
+  const auto& new_loops = cfg.get_loop_info();
+  EXPECT_EQ(new_loops.loop_depth(b2), 1);
+  EXPECT_EQ(new_loops.loop_depth(b3), 2);
+  EXPECT_EQ(new_loops.loop_depth(b4), 2);
+  EXPECT_EQ(new_loops.loop_depth(b5), 0);
+}
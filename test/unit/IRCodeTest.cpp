@@ -154,3 +154,30 @@ TEST_F(IRCodeTest, try_region) {
   EXPECT_EQ(split, second->m_start_addr);
   EXPECT_EQ(num * op->size() - split, second->m_insn_count);
 }
+
+TEST_F(IRCodeTest, epoch) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (return v0)
+    )
+  )");
+  auto epoch = code->get_epoch();
+
+  // Editing an instruction in place isn't tracked...
+  code->begin()->insn->set_literal(1);
+  EXPECT_EQ(code->get_epoch(), epoch);
+
+  // ... but adding or removing one is.
+  code->insert_before(code->begin(), new IRInstruction(OPCODE_NOP));
+  EXPECT_GT(code->get_epoch(), epoch);
+  epoch = code->get_epoch();
+  code->remove_opcode(code->begin());
+  EXPECT_GT(code->get_epoch(), epoch);
+
+  // So is going through the editable CFG.
+  epoch = code->get_epoch();
+  code->build_cfg(/* editable */ true);
+  code->clear_cfg();
+  EXPECT_GT(code->get_epoch(), epoch);
+}
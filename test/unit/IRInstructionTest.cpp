@@ -133,6 +133,57 @@ TEST(IRInstruction, NormalizeInvoke) {
   delete g_redex;
 }
 
+TEST(IRInstruction, ManySources) {
+  g_redex = new RedexContext();
+
+  auto method = DexMethod::make_method(
+      "LFoo;", "x", "V", {"I", "I", "I", "I", "I", "I", "I", "I", "I"});
+  IRInstruction* insn = new IRInstruction(OPCODE_INVOKE_STATIC);
+  insn->set_method(method);
+  insn->set_arg_word_count(9);
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    insn->set_src(i, i + 1);
+  }
+  auto copy = new IRInstruction(*insn);
+  EXPECT_EQ(*insn, *copy);
+  EXPECT_EQ(std::vector<uint16_t>(copy->srcs().begin(), copy->srcs().end()),
+            std::vector<uint16_t>({1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+  insn->set_arg_word_count(3);
+  EXPECT_NE(*insn, *copy);
+  EXPECT_EQ(std::vector<uint16_t>(insn->srcs().begin(), insn->srcs().end()),
+            std::vector<uint16_t>({1, 2, 3}));
+
+  insn->set_arg_word_count(10);
+  EXPECT_EQ(insn->src(2), 3);
+  EXPECT_EQ(insn->src(3), 0);
+  EXPECT_EQ(insn->src(9), 0);
+
+  *copy = *insn;
+  EXPECT_EQ(*insn, *copy);
+
+  // Moves take the heap-allocated srcs over instead of copying them.
+  auto heap_srcs = &*insn->srcs().begin();
+  IRInstruction moved(std::move(*insn));
+  EXPECT_EQ(moved, *copy);
+  EXPECT_EQ(&*moved.srcs().begin(), heap_srcs);
+  EXPECT_EQ(insn->srcs_size(), 0);
+
+  IRInstruction assigned(OPCODE_INVOKE_STATIC);
+  assigned.set_arg_word_count(12);
+  assigned = std::move(moved);
+  EXPECT_EQ(assigned, *copy);
+  EXPECT_EQ(&*assigned.srcs().begin(), heap_srcs);
+  EXPECT_EQ(moved.srcs_size(), 0);
+
+  static_assert(std::is_nothrow_move_constructible<IRInstruction>::value,
+                "IRInstruction moves must not copy");
+
+  delete insn;
+  delete copy;
+  delete g_redex;
+}
+
 /*
  * Helper function to run select and then extract the resulting instruction
  * from the instruction list. The only reason it's a list is that const-cast
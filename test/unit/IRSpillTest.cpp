@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "IRSpill.h"
+#include "RedexTest.h"
+#include "Walkers.h"
+
+namespace {
+
+const char* kCode = R"(
+  (
+    (load-param v0)
+    (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 420)
+    (.pos:dbg_1 "LFoo;.baz:()I" "Foo.java" 440 dbg_0)
+    (.try_start c0)
+    (sparse-switch v0 (:a :b))
+    (const-string "hello")
+    (move-result-pseudo-object v1)
+    (:a 0)
+    (const-wide v2 12345678901234)
+    (.try_end c0)
+    (:b 1)
+    (return v0)
+    (.catch (c0) "Ljava/lang/Exception;")
+    (const v0 -1)
+    (return v0)
+  )
+)";
+
+std::string spill_path() {
+  return (boost::filesystem::temp_directory_path() /
+          boost::filesystem::unique_path())
+      .string();
+}
+
+} // namespace
+
+struct IRSpillTest : public RedexTest {
+  IRSpillTest() {
+    for (auto name : {"LFoo;.bar:(I)I", "LFoo;.baz:()I"}) {
+      auto method = static_cast<DexMethod*>(DexMethod::make_method(name));
+      method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    }
+  }
+};
+
+TEST_F(IRSpillTest, roundTrip) {
+  auto code = assembler::ircode_from_string(kCode);
+  code->set_registers_size(4);
+
+  std::string encoded;
+  ASSERT_TRUE(ir_spill::serialize(*code, &encoded));
+  auto decoded = ir_spill::deserialize(encoded.data(), encoded.size());
+  EXPECT_EQ(assembler::to_string(decoded.get()),
+            assembler::to_string(code.get()));
+  EXPECT_EQ(decoded->get_registers_size(), 4);
+}
+
+TEST_F(IRSpillTest, evictAndRestore) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto method = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.bar:(I)I"));
+  method->set_code(assembler::ircode_from_string(kCode));
+  creator.add_method(method);
+  Scope scope{creator.create()};
+  auto expected = assembler::to_string(method->get_code());
+
+  ir_spill::IRSpill spill(spill_path());
+  // The method was used since it was created, so it stays.
+  EXPECT_EQ(spill.sweep(scope, true), 0);
+  EXPECT_EQ(spill.sweep(scope, true), 1);
+  EXPECT_EQ(spill.restored_count(), 0);
+
+  spill.peek(method, [&](IRCode* code) {
+    EXPECT_EQ(assembler::to_string(code), expected);
+  });
+  EXPECT_EQ(spill.restored_count(), 1);
+  // Peeking doesn't count as a use, so there is nothing left to evict.
+  EXPECT_EQ(spill.sweep(scope, true), 0);
+
+  EXPECT_EQ(assembler::to_string(method->get_code()), expected);
+  EXPECT_EQ(spill.restored_count(), 2);
+  EXPECT_EQ(spill.sweep(scope, true), 0);
+}
+
+TEST_F(IRSpillTest, readOpcodesLeavesCodeEvicted) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto method = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.bar:(I)I"));
+  method->set_code(assembler::ircode_from_string(kCode));
+  creator.add_method(method);
+  Scope scope{creator.create()};
+
+  ir_spill::IRSpill spill(spill_path());
+  spill.sweep(scope, true);
+  EXPECT_EQ(spill.sweep(scope, true), 1);
+
+  size_t count = 0;
+  walk::read_opcodes(scope, [&](const DexMethod*, const IRInstruction*) {
+    ++count;
+  });
+  EXPECT_EQ(count, 8);
+  EXPECT_EQ(spill.restored_count(), 1);
+  // The walk didn't bring the code back for good.
+  walk::read_opcodes(scope, [&](const DexMethod*, const IRInstruction*) {});
+  EXPECT_EQ(spill.restored_count(), 2);
+  spill.restore_all();
+}
+
+TEST_F(IRSpillTest, parentsOfOtherMethodsStay) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto bar = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.bar:(I)I"));
+  bar->set_code(assembler::ircode_from_string(kCode));
+  creator.add_method(bar);
+  auto baz = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.baz:()I"));
+  baz->set_code(assembler::ircode_from_string(R"(
+    (
+      (.pos:dbg_0 "LFoo;.baz:()I" "Foo.java" 440)
+      (const v0 0)
+      (return v0)
+    )
+  )"));
+  creator.add_method(baz);
+  Scope scope{creator.create()};
+
+  // Give baz a position whose parent lives in bar, as if it held code that
+  // was inlined into bar and copied over.
+  DexPosition* bar_pos = nullptr;
+  for (auto& mie : *bar->get_code()) {
+    if (mie.type == MFLOW_POSITION) {
+      bar_pos = mie.pos.get();
+      break;
+    }
+  }
+  DexPosition* baz_pos = nullptr;
+  for (auto& mie : *baz->get_code()) {
+    if (mie.type == MFLOW_POSITION) {
+      baz_pos = mie.pos.get();
+    }
+  }
+  baz_pos->parent = bar_pos;
+  auto expected = assembler::to_string(bar->get_code());
+
+  ir_spill::IRSpill spill(spill_path());
+  spill.sweep(scope, true);
+  // Neither the parent side nor the child side goes.
+  EXPECT_EQ(spill.sweep(scope, true), 0);
+  EXPECT_EQ(spill.restored_count(), 0);
+  EXPECT_EQ(baz_pos->parent, bar_pos);
+  EXPECT_EQ(bar_pos->line, 420);
+
+  // Once the reference is gone, both can be evicted.
+  baz_pos->parent = nullptr;
+  EXPECT_EQ(spill.sweep(scope, true), 2);
+  EXPECT_EQ(assembler::to_string(bar->get_code()), expected);
+  spill.restore_all();
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <mutex>
+
+#include "ConfigFiles.h"
+#include "DexStore.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "ScopeHelper.h"
+
+namespace {
+
+using Events = std::vector<std::string>;
+
+class RecordingPass : public Pass {
+ public:
+  RecordingPass(const std::string& name,
+                bool analysis,
+                Events& events,
+                std::mutex& lock)
+      : Pass(name), m_analysis(analysis), m_events(events), m_lock(lock) {}
+
+  bool has_analysis() const override { return m_analysis; }
+
+  void analyze_pass(const Scope&, const PassManager&) override {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_events.push_back("analyze " + name());
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_events.push_back("run " + name());
+  }
+
+ private:
+  bool m_analysis;
+  Events& m_events;
+  std::mutex& m_lock;
+};
+
+struct PassManagerTest : public RedexTest {
+  Events run_passes(bool concurrent_analysis) {
+    Events events;
+    std::mutex lock;
+    RecordingPass a("A", true, events, lock);
+    RecordingPass b("B", true, events, lock);
+    RecordingPass c("C", false, events, lock);
+    RecordingPass d("D", true, events, lock);
+
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (auto name : {"A", "B", "C", "D", "D"}) {
+      config["redex"]["passes"].append(name);
+    }
+    PassManager manager({&a, &b, &c, &d}, config);
+    manager.set_testing_mode();
+
+    DexMetadata dm;
+    dm.set_id("classes");
+    DexStore store(dm);
+    store.add_classes(create_empty_scope());
+    std::vector<DexStore> stores;
+    stores.emplace_back(std::move(store));
+
+    Json::Value conf_obj(Json::objectValue);
+    conf_obj["concurrent_pass_analysis"] = concurrent_analysis;
+    ConfigFiles cfg(conf_obj);
+    manager.run_passes(stores, cfg);
+    return events;
+  }
+};
+
+} // namespace
+
+TEST_F(PassManagerTest, analysesRunRightBeforeTheirPass) {
+  EXPECT_THAT(run_passes(false),
+              ::testing::ElementsAre("analyze A", "run A", "analyze B",
+                                     "run B", "run C", "analyze D", "run D",
+                                     "analyze D", "run D"));
+}
+
+TEST_F(PassManagerTest, consecutiveAnalysesAreGrouped) {
+  auto events = run_passes(true);
+  ASSERT_EQ(events.size(), 9);
+  // The analyses of A and B run together, in either order. C has none, and
+  // the two runs of D can't share one.
+  EXPECT_THAT(Events(events.begin(), events.begin() + 2),
+              ::testing::UnorderedElementsAre("analyze A", "analyze B"));
+  EXPECT_THAT(Events(events.begin() + 2, events.end()),
+              ::testing::ElementsAre("run A", "run B", "run C", "analyze D",
+                                     "run D", "analyze D", "run D"));
+}
@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 
+#include <boost/filesystem.hpp>
+#include <fstream>
 #include <sstream>
 
 #include "ProguardMap.h"
@@ -53,4 +55,15 @@ TEST(ProguardMapTest, HandlesGeneratedComments) {
   ProguardMap pm(ss);
   EXPECT_EQ("LA;", pm.translate_class("Lcom/foo/bar;"));
   EXPECT_EQ("LA;.a:I", pm.translate_field("Lcom/foo/bar;.do1:I"));
-}
\ No newline at end of file
+}
+TEST(ProguardMapTest, EmptyFiles) {
+  auto path = boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path();
+  std::ofstream(path.string()).close();
+  for (const auto& filename : {path.string(), std::string("/dev/null")}) {
+    ProguardMap pm(filename);
+    EXPECT_TRUE(pm.empty());
+    EXPECT_EQ("Lcom/foo/bar;", pm.translate_class("Lcom/foo/bar;"));
+  }
+  boost::filesystem::remove(path);
+}
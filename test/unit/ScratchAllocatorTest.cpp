@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ScratchAllocator.h"
+
+TEST(ScratchAllocatorTest, rewindReusesMemory) {
+  scratch::Arena arena;
+  auto mark = arena.mark();
+  auto* a = static_cast<char*>(arena.allocate(100, 1));
+  auto* b = static_cast<char*>(arena.allocate(8, 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0);
+  EXPECT_GE(b, a + 100);
+
+  // Too large for the rest of the chunk, and then for any chunk.
+  arena.allocate(scratch::Arena::kChunkSize - 50, 1);
+  arena.allocate(3 * scratch::Arena::kChunkSize, 1);
+  auto capacity = arena.capacity();
+  EXPECT_EQ(capacity, 5 * scratch::Arena::kChunkSize);
+
+  arena.rewind(mark);
+  EXPECT_EQ(arena.allocate(100, 1), a);
+  arena.allocate(scratch::Arena::kChunkSize - 50, 1);
+  arena.allocate(3 * scratch::Arena::kChunkSize, 1);
+  EXPECT_EQ(arena.capacity(), capacity);
+}
+
+TEST(ScratchAllocatorTest, nestedScopes) {
+  using Vector = std::vector<uint32_t, scratch::Allocator<uint32_t>>;
+  const void* outer_data;
+  {
+    scratch::Scope outer;
+    Vector outer_vec(10, 1);
+    outer_data = outer_vec.data();
+    for (int i = 0; i < 3; ++i) {
+      scratch::Scope inner;
+      Vector inner_vec(1000, 2);
+      EXPECT_EQ(outer_vec, Vector(10, 1));
+      std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                         scratch::Allocator<std::pair<const int, int>>>
+          map;
+      for (int j = 0; j < 1000; ++j) {
+        map.emplace(j, j);
+      }
+      EXPECT_EQ(map.at(999), 999);
+    }
+  }
+  scratch::Scope scope;
+  Vector vec(10, 3);
+  // The outer scope gave its memory back.
+  EXPECT_EQ(vec.data(), outer_data);
+}
+
+namespace {
+
+struct Pooled {
+  static void* operator new(size_t size) {
+    return scratch::Pool<Pooled>::allocate(size);
+  }
+  static void operator delete(void* p, size_t size) {
+    scratch::Pool<Pooled>::deallocate(p, size);
+  }
+  uint64_t payload[4];
+};
+
+} // namespace
+
+TEST(ScratchAllocatorTest, poolRecyclesObjects) {
+  auto* a = new Pooled();
+  auto* b = new Pooled();
+  delete a;
+  delete b;
+  EXPECT_EQ(new Pooled(), b);
+  EXPECT_EQ(new Pooled(), a);
+  delete a;
+  delete b;
+}
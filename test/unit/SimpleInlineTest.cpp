@@ -7,12 +7,16 @@
 
 #include <gtest/gtest.h>
 
+#include "ApiLevelChecker.h"
+#include "Creators.h"
 #include "DexAsm.h"
+#include "DexStore.h"
 #include "DexUtil.h"
 #include "Inliner.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "RedexTest.h"
+#include "Resolver.h"
 
 struct SimpleInlineTest : public RedexTest {};
 
@@ -141,3 +145,110 @@ TEST_F(SimpleInlineTest, debugPositionsAfterReturn) {
   )";
   test_inliner(caller_str, callee_str, expected_str);
 }
+
+DexMethod* make_static_method(ClassCreator& creator,
+                              const std::string& name,
+                              const std::string& code) {
+  auto method = static_cast<DexMethod*>(
+      DexMethod::make_method("LFoo;." + name + ":()V"));
+  method->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                        assembler::ircode_from_string(code),
+                        /* is_virtual */ false);
+  creator.add_method(method);
+  return method;
+}
+
+size_t count_calls(DexMethod* caller, DexMethod* callee) {
+  size_t count = 0;
+  for (const auto& mie : InstructionIterable(caller->get_code())) {
+    if (is_invoke(mie.insn->opcode()) && mie.insn->get_method() == callee) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Returns the InliningInfo of the run.
+auto inline_with_profile(
+    DexClass* cls,
+    DexMethod* callee,
+    const std::unordered_map<std::string, unsigned int>& method_to_weight) {
+  api::LevelChecker::init(0);
+  DexMetadata dm;
+  dm.set_id("classes");
+  DexStore store(dm);
+  Scope scope{cls};
+  store.add_classes(scope);
+  DexStoresVector stores;
+  stores.emplace_back(std::move(store));
+
+  MultiMethodInliner::Config config;
+  config.method_to_weight = &method_to_weight;
+  MultiMethodInliner inliner(
+      scope, stores, {callee},
+      [](DexMethodRef* method, MethodSearch search) {
+        return resolve_method(method, search);
+      },
+      config);
+  inliner.inline_methods();
+  return inliner.get_info();
+}
+
+const char* const kCallCallee = R"(
+  (
+    (invoke-static () "LFoo;.callee:()V")
+    (return-void)
+  )
+)";
+
+/*
+ * Hot callers get callees that are too large to inline into all of their
+ * callers.
+ */
+TEST_F(SimpleInlineTest, hotCallerInlinesLargerCallee) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto callee = make_static_method(creator, "callee", R"(
+    (
+      (const v0 0)
+      (const v0 1)
+      (const v0 2)
+      (const v0 3)
+      (const v0 4)
+      (return-void)
+    )
+  )");
+  auto hot = make_static_method(creator, "hot", kCallCallee);
+  auto unprofiled = make_static_method(creator, "unprofiled", kCallCallee);
+
+  auto info =
+      inline_with_profile(creator.create(), callee, {{"LFoo;.hot:()V", 100}});
+  EXPECT_EQ(count_calls(hot, callee), 0);
+  EXPECT_EQ(count_calls(unprofiled, callee), 1);
+  EXPECT_EQ(info.hot_inlined, 1);
+  EXPECT_EQ(info.cold_caller, 0);
+}
+
+/*
+ * Cold callers only get callees that inlining deletes, while the callers that
+ * aren't in the profile keep the usual rules.
+ */
+TEST_F(SimpleInlineTest, coldCallerKeepsSharedCallee) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto callee = make_static_method(creator, "callee", R"(
+    (
+      (const v0 0)
+      (return-void)
+    )
+  )");
+  auto cold = make_static_method(creator, "cold", kCallCallee);
+  auto unprofiled = make_static_method(creator, "unprofiled", kCallCallee);
+
+  auto info =
+      inline_with_profile(creator.create(), callee, {{"LFoo;.cold:()V", 0}});
+  EXPECT_EQ(count_calls(cold, callee), 1);
+  EXPECT_EQ(count_calls(unprofiled, callee), 0);
+  EXPECT_EQ(info.hot_inlined, 0);
+  EXPECT_EQ(info.cold_caller, 1);
+}
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+#include "Walkers.h"
+
+struct WalkersTest : public RedexTest {};
+
+TEST_F(WalkersTest, codeBySizeStartsWithTheLargestMethods) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(get_object_type());
+  auto make = [&](const char* name, const char* code) {
+    auto method = static_cast<DexMethod*>(DexMethod::make_method(name));
+    method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    method->set_code(assembler::ircode_from_string(code));
+    creator.add_method(method);
+    return method;
+  };
+  auto small = make("LFoo;.small:()V", "((return-void))");
+  auto large = make("LFoo;.large:()V", R"(
+    (
+      (const v0 0)
+      (const v1 1)
+      (add-int v0 v0 v1)
+      (return-void)
+    )
+  )");
+  auto medium = make("LFoo;.medium:()V", R"(
+    (
+      (const v0 0)
+      (return-void)
+    )
+  )");
+  auto no_code = static_cast<DexMethod*>(
+      DexMethod::make_method("LFoo;.abstract:()V"));
+  no_code->make_concrete(ACC_PUBLIC | ACC_ABSTRACT, true);
+  creator.add_method(no_code);
+  Scope scope{creator.create()};
+
+  std::vector<DexMethod*> visited;
+  walk::parallel::code_by_size(scope,
+                               [&](DexMethod* m, IRCode&) {
+                                 visited.push_back(m);
+                               },
+                               /* num_threads */ 1);
+  EXPECT_EQ(visited, std::vector<DexMethod*>({large, medium, small}));
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "XrefIndex.h"
+
+struct XrefIndexTest : public RedexTest {};
+
+TEST_F(XrefIndexTest, indexAndUpdate) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(get_object_type());
+  auto field = static_cast<DexField*>(DexField::make_field("LFoo;.bar:I"));
+  field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  cc.add_field(field);
+  auto reader = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.read:()I"
+     (
+      (sget "LFoo;.bar:I")
+      (move-result-pseudo v0)
+      (const-string "hello")
+      (move-result-pseudo-object v1)
+      (invoke-static () "LFoo;.write:()V")
+      (return v0)
+     )
+    )
+  )");
+  auto writer = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.write:()V"
+     (
+      (const v0 1)
+      (sput v0 "LFoo;.bar:I")
+      (new-instance "LFoo;")
+      (move-result-pseudo-object v1)
+      (return-void)
+     )
+    )
+  )");
+  cc.add_method(reader);
+  cc.add_method(writer);
+  auto cls = cc.create();
+
+  xref::XrefIndex xrefs({cls});
+  EXPECT_TRUE(xrefs.is_up_to_date({cls}));
+
+  EXPECT_EQ(xrefs.field_refs(field).size(), 2);
+  auto reads = xrefs.field_reads(field);
+  ASSERT_EQ(reads.size(), 1);
+  EXPECT_EQ(reads[0].method, reader);
+  EXPECT_EQ(reads[0].insn->opcode(), OPCODE_SGET);
+  auto writes = xrefs.field_writes(field);
+  ASSERT_EQ(writes.size(), 1);
+  EXPECT_EQ(writes[0].method, writer);
+
+  const auto& calls = xrefs.method_refs(writer);
+  ASSERT_EQ(calls.size(), 1);
+  EXPECT_EQ(calls[0].method, reader);
+  EXPECT_EQ(xrefs.method_refs(reader).size(), 0);
+
+  ASSERT_EQ(xrefs.type_refs(cls->get_type()).size(), 1);
+  EXPECT_EQ(xrefs.type_refs(cls->get_type())[0].method, writer);
+  EXPECT_EQ(xrefs.string_refs(DexString::make_string("hello")).size(), 1);
+
+  // Drop the write and check that update() forgets it.
+  auto code = writer->get_code();
+  for (auto it = code->begin(); it != code->end(); ++it) {
+    if (it->type == MFLOW_OPCODE && it->insn->opcode() == OPCODE_SPUT) {
+      code->remove_opcode(it);
+      break;
+    }
+  }
+  EXPECT_FALSE(xrefs.is_up_to_date({cls}));
+  xrefs.update(writer);
+  EXPECT_TRUE(xrefs.is_up_to_date({cls}));
+  EXPECT_EQ(xrefs.field_writes(field).size(), 0);
+  EXPECT_EQ(xrefs.field_reads(field).size(), 1);
+  EXPECT_EQ(xrefs.type_refs(cls->get_type()).size(), 1);
+
+  xrefs.remove(reader);
+  EXPECT_EQ(xrefs.field_refs(field).size(), 0);
+  EXPECT_EQ(xrefs.method_refs(writer).size(), 0);
+  EXPECT_EQ(xrefs.fields().count(field), 0);
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "ZipArchive.h"
+
+namespace {
+
+class ZipArchiveTest : public ::testing::Test {
+ protected:
+  ZipArchiveTest()
+      : m_dir(boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path()) {
+    boost::filesystem::create_directories(m_dir);
+  }
+
+  ~ZipArchiveTest() { boost::filesystem::remove_all(m_dir); }
+
+  std::string path(const std::string& name) { return (m_dir / name).string(); }
+
+  // The offset of the contents of an entry in the archive.
+  size_t offset(const zip::ZipReader& reader, const zip::Entry& entry) {
+    return entry.data - reader.entries().front().data +
+           reader.entries().front().name.size() + 30;
+  }
+
+  boost::filesystem::path m_dir;
+};
+
+std::string repeat(const std::string& s, size_t n) {
+  std::string result;
+  for (size_t i = 0; i < n; i++) {
+    result += s;
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_F(ZipArchiveTest, writeAndRead) {
+  auto text = repeat("Lcom/facebook/Foo;", 1000);
+  auto lib = repeat("\x7f"
+                    "ELF",
+                    5000);
+  {
+    zip::ZipWriter writer(path("out.apk"));
+    writer.add("classes.dex", text);
+    writer.add("res/raw/a.bin", "abc", zip::kCompMethodStore);
+    writer.add("lib/x86/libfoo.so", lib, zip::kCompMethodStore);
+    writer.add("empty", "");
+    writer.write();
+  }
+
+  zip::ZipReader reader;
+  ASSERT_TRUE(reader.open(path("out.apk").c_str()));
+  ASSERT_EQ(reader.entries().size(), 4);
+  EXPECT_EQ(reader.entries()[0].name, "classes.dex");
+  EXPECT_EQ(reader.entries()[1].name, "res/raw/a.bin");
+  EXPECT_EQ(reader.entries()[2].name, "lib/x86/libfoo.so");
+  EXPECT_EQ(reader.entries()[3].name, "empty");
+
+  const auto* dex = reader.find("classes.dex");
+  ASSERT_NE(dex, nullptr);
+  EXPECT_EQ(dex->comp_method, zip::kCompMethodDeflate);
+  EXPECT_LT(dex->comp_size, dex->ucomp_size);
+  EXPECT_EQ(dex->crc32, zip::crc32(text));
+  EXPECT_EQ(reader.read(*dex), text);
+  EXPECT_EQ(reader.read(*reader.find("res/raw/a.bin")), "abc");
+  EXPECT_EQ(reader.read(*reader.find("lib/x86/libfoo.so")), lib);
+  EXPECT_EQ(reader.read(*reader.find("empty")), "");
+  EXPECT_EQ(reader.find("classes2.dex"), nullptr);
+
+  // Stored entries are aligned, on a page for shared libraries.
+  EXPECT_EQ(offset(reader, *reader.find("res/raw/a.bin")) % 4, 0);
+  EXPECT_EQ(offset(reader, *reader.find("lib/x86/libfoo.so")) % 4096, 0);
+}
+
+TEST_F(ZipArchiveTest, copyRawEntries) {
+  auto text = repeat("Lcom/facebook/Bar;", 1000);
+  {
+    zip::ZipWriter writer(path("in.apk"));
+    writer.add("classes.dex", text);
+    writer.add("AndroidManifest.xml", "<manifest/>");
+    writer.add("lib/x86/libfoo.so", "\x7f"
+                                    "ELF",
+               zip::kCompMethodStore);
+    writer.write();
+  }
+  zip::ZipReader input;
+  ASSERT_TRUE(input.open(path("in.apk").c_str()));
+  {
+    zip::ZipWriter writer(path("out.apk"));
+    writer.add("classes.dex", "dex\n035");
+    for (const auto& entry : input.entries()) {
+      if (entry.name != "classes.dex") {
+        writer.add_raw(entry);
+      }
+    }
+    writer.write();
+  }
+
+  zip::ZipReader output;
+  ASSERT_TRUE(output.open(path("out.apk").c_str()));
+  ASSERT_EQ(output.entries().size(), 3);
+  EXPECT_EQ(output.read(*output.find("classes.dex")), "dex\n035");
+  const auto* manifest = output.find("AndroidManifest.xml");
+  ASSERT_NE(manifest, nullptr);
+  EXPECT_EQ(manifest->comp_size,
+            input.find("AndroidManifest.xml")->comp_size);
+  EXPECT_EQ(output.read(*manifest), "<manifest/>");
+  const auto* lib = output.find("lib/x86/libfoo.so");
+  EXPECT_EQ(output.read(*lib), "\x7f"
+                               "ELF");
+  EXPECT_EQ(offset(output, *lib) % 4096, 0);
+}
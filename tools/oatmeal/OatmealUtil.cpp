@@ -6,6 +6,7 @@
  */
 
 #include "OatmealUtil.h"
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <sys/stat.h>
@@ -27,23 +28,17 @@ size_t get_filesize(FileHandle& fh) {
 }
 
 void stream_file(FileHandle& in, FileHandle& out) {
-  constexpr int kBufSize = 0x80000;
-  std::unique_ptr<char[]> buf(new char[kBufSize]);
-
-  do {
-    auto num_read = in.fread(buf.get(), 1, kBufSize);
-    CHECK(!in.ferror());
-    if (num_read > 0) {
-      write_buf(out, ConstBuffer{buf.get(), num_read});
-    }
-  } while (!in.feof());
+  out.copy_from(in);
+  CHECK(!in.ferror());
 }
 
 void write_padding(FileHandle& fh, char byte, size_t num) {
-  // This might be inefficient, but the most padding we ever do at
-  // once is 4k, so this shouldn't be too bad.
-  for (size_t i = 0; i < num; i++) {
-    CHECK(fh.fwrite(&byte, sizeof(char), 1) == sizeof(char));
+  char buf[0x1000];
+  memset(buf, byte, std::min(num, sizeof(buf)));
+  while (num > 0) {
+    auto len = std::min(num, sizeof(buf));
+    write_buf(fh, ConstBuffer{buf, len});
+    num -= len;
   }
 }
 
@@ -168,6 +168,25 @@ struct WritableBuffer {
 
 void write_padding(FileHandle& fh, char byte, size_t num);
 
+// A FileHandle that writes into memory, to build a part of the output on
+// another thread and write it out later.
+class MemoryFileHandle : public FileHandle {
+ public:
+  MemoryFileHandle() : FileHandle(nullptr) {}
+
+  size_t fwrite(const void* p, size_t size, size_t count) override {
+    auto bytes = static_cast<const char*>(p);
+    data_.insert(data_.end(), bytes, bytes + size * count);
+    bytes_written_ += size * count;
+    return count;
+  }
+
+  ConstBuffer buffer() const { return ConstBuffer{data_.data(), data_.size()}; }
+
+ private:
+  std::vector<char> data_;
+};
+
 template <typename T>
 void write_obj(FileHandle& fh, const T& obj) {
   write_buf(fh, ConstBuffer{reinterpret_cast<const char*>(&obj), sizeof(T)});
@@ -51,6 +51,7 @@
 #include <memory>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <vector>
 
 #define PACK __attribute__((packed))
@@ -3048,12 +3049,38 @@ void write_dex_files(const std::vector<DexInput>& dex_input,
                      const std::vector<DexFileListingType>& dex_files,
                      const QuickData* quick_data,
                      FileHandle& cksum_fh) {
-  foreach_pair(dex_input,
-               dex_files,
-               [&](const DexInput& input, const DexFileListingType& dex_file) {
-                 CHECK(dex_file.file_offset == cksum_fh.bytes_written());
-                 write_dex_file(input, quick_data, cksum_fh);
-               });
+  if (quick_data == nullptr || dex_input.size() < 2) {
+    foreach_pair(
+        dex_input,
+        dex_files,
+        [&](const DexInput& input, const DexFileListingType& dex_file) {
+          CHECK(dex_file.file_offset == cksum_fh.bytes_written());
+          write_dex_file(input, quick_data, cksum_fh);
+        });
+    return;
+  }
+
+  // Quickening is CPU bound, so quicken all the dexes at once in memory, and
+  // then write them out in order.
+  START_TRACE()
+  std::vector<std::unique_ptr<MemoryFileHandle>> quickened(dex_input.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < dex_input.size(); i++) {
+    quickened[i] = std::unique_ptr<MemoryFileHandle>(new MemoryFileHandle());
+    threads.emplace_back([&, i]() {
+      quicken_dex(dex_input[i].filename.c_str(), quick_data, *quickened[i]);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  END_TRACE("quicken_dexes")
+
+  for (size_t i = 0; i < dex_input.size(); i++) {
+    CHECK(dex_files[i].file_offset == cksum_fh.bytes_written());
+    write_buf(cksum_fh, quickened[i]->buffer());
+    quickened[i].reset();
+  }
 }
 
 // We only ship to 32 bit platforms so this is always 4.
@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
 #include <fstream>
@@ -13,6 +14,7 @@
 #include <set>
 #include <streambuf>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <signal.h>
@@ -29,6 +31,7 @@
 #include <boost/program_options.hpp>
 #include <json/json.h>
 
+#include "BlockProfile.h"
 #include "CommentFilter.h"
 #include "Debug.h"
 #include "DexClass.h"
@@ -49,6 +52,8 @@
 #include "ToolsCommon.h"
 #include "Walkers.h"
 #include "Warning.h"
+#include "WorkQueue.h"
+#include "ZipArchive.h"
 
 namespace {
 const std::string k_usage_header = "usage: redex-all [options...] dex-files...";
@@ -64,6 +69,8 @@ struct Arguments {
   std::vector<std::string> proguard_config_paths;
   std::string out_dir;
   std::vector<std::string> dex_files;
+  std::string input_apk;
+  std::string output_apk;
   // Entry data contains the list of dex files, config file and original
   // command line arguments. For development usage
   Json::Value entry_data;
@@ -91,10 +98,34 @@ UNUSED void dump_args(const Arguments& args) {
   for (const auto& e : args.dex_files) {
     std::cout << "  " << e << std::endl;
   }
+  std::cout << "input_apk: " << args.input_apk << std::endl;
+  std::cout << "output_apk: " << args.output_apk << std::endl;
   std::cout << "config: " << std::endl;
   std::cout << args.config << std::endl;
 }
 
+bool is_dex_file(const std::string& filename) {
+  return filename.size() >= 5 &&
+         filename.compare(filename.size() - 4, 4, ".dex") == 0;
+}
+
+// The names of the primary and secondary dex files at the root of an APK.
+std::string root_dex_name(size_t i) {
+  return i == 0 ? "classes.dex" : "classes" + std::to_string(i + 1) + ".dex";
+}
+
+bool is_root_dex(const std::string& name) {
+  return name.find('/') == std::string::npos &&
+         name.compare(0, 7, "classes") == 0 && is_dex_file(name);
+}
+
+// The signature files, which are directly under META-INF/, don't match the
+// output APK anymore.
+bool is_signature_file(const std::string& name) {
+  return name.compare(0, 9, "META-INF/") == 0 &&
+         name.find('/', 9) == std::string::npos;
+}
+
 Json::Value parse_json_value(const std::string& value_string) {
   std::istringstream temp_stream(value_string);
   Json::Value temp_json;
@@ -230,6 +261,12 @@ Arguments parse_args(int argc, char* argv[]) {
   od.add_options()("show-passes", "show registered passes");
   od.add_options()("dex-files", po::value<std::vector<std::string>>(),
                    "dex files");
+  od.add_options()("input-apk", po::value<std::string>(&args.input_apk),
+                   "APK to read the primary and secondary dex files from, "
+                   "instead of dex files given on the command line");
+  od.add_options()("output-apk", po::value<std::string>(&args.output_apk),
+                   "APK to write with the optimized dex files, based on "
+                   "--input-apk and on the resources in --apkdir if any");
 
   // Development usage only, and Python script will generate the following
   // arguments.
@@ -270,12 +307,28 @@ Arguments parse_args(int argc, char* argv[]) {
 
   if (vm.count("dex-files")) {
     args.dex_files = vm["dex-files"].as<std::vector<std::string>>();
-  } else {
+  } else if (args.input_apk.empty()) {
     std::cerr << "error: no input dex files" << std::endl << std::endl;
     print_usage();
     exit(EXIT_SUCCESS);
   }
 
+  if (!args.input_apk.empty()) {
+    // Other dex stores can be given by their metadata, but only the dex
+    // files of the root store are written to the output APK.
+    for (const auto& filename : args.dex_files) {
+      if (is_dex_file(filename) || !args.output_apk.empty()) {
+        std::cerr << "error: " << filename << " can't be used with "
+                  << (is_dex_file(filename) ? "--input-apk" : "--output-apk")
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+  } else if (!args.output_apk.empty()) {
+    std::cerr << "error: --output-apk requires --input-apk" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   if (vm.count("warn")) {
     const auto& warns = vm["warn"].as<std::vector<int>>();
     for (int warn : warns) {
@@ -466,6 +519,16 @@ Json::Value get_input_stats(const dex_stats_t& stats,
   return d;
 }
 
+Json::Value get_memory_budget_stats(const PassManager& mgr) {
+  const auto& stats = mgr.get_memory_budget_stats();
+  Json::Value obj(Json::ValueType::objectValue);
+  obj["budget_mb"] = Json::UInt(stats.budget_mb);
+  obj["peak_rss_mb"] = Json::UInt(stats.peak_rss_mb);
+  obj["evicted_methods"] = Json::UInt(stats.evicted_methods);
+  obj["restored_methods"] = Json::UInt(stats.restored_methods);
+  return obj;
+}
+
 Json::Value get_output_stats(
     const dex_stats_t& stats,
     const std::vector<dex_stats_t>& dexes_stats,
@@ -476,6 +539,9 @@ Json::Value get_output_stats(
   d["dexes_stats"] = get_detailed_stats(dexes_stats);
   d["pass_stats"] = get_pass_stats(mgr);
   d["lowering_stats"] = get_lowering_stats(instruction_lowering_stats);
+  if (mgr.get_memory_budget_stats().budget_mb > 0) {
+    d["memory_budget_stats"] = get_memory_budget_stats(mgr);
+  }
   return d;
 }
 
@@ -547,6 +613,45 @@ void write_debug_line_mapping(
   // method-id => offset info, so set the start of offset to be after that.
   int binary_offset =
       3 * bit_32_size + (bit_64_size + 2 * bit_32_size) * num_method;
+  auto scope = build_class_scope(stores);
+  std::vector<std::pair<DexMethod*, const std::vector<DebugLineItem>*>>
+      methods;
+  walk::methods(scope, [&](DexMethod* method) {
+    auto dex_code = method->get_dex_code();
+    if (dex_code == nullptr) {
+      return;
+    }
+    auto it = code_debug_lines.find(dex_code);
+    if (it != code_debug_lines.end()) {
+      methods.emplace_back(method, &it->second);
+    }
+  });
+
+  // Encode the debug line info of each method in parallel; they are written
+  // in the order of the scope below.
+  std::vector<std::string> binary_lines(methods.size());
+  std::vector<std::string> readable_lines(methods.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    auto method = methods[i].first;
+    const auto& debug_lines = *methods[i].second;
+    uint64_t method_id = method_to_id.at(method);
+    auto& binary = binary_lines[i];
+    binary.reserve(bit_64_size + debug_lines.size() * 2 * bit_32_size);
+    binary.append((const char*)&method_id, bit_64_size);
+    std::ostringstream readable;
+    readable << method->get_deobfuscated_name() << "\n";
+    for (const auto& item : debug_lines) {
+      binary.append((const char*)&item.offset, bit_32_size);
+      binary.append((const char*)&item.line, bit_32_size);
+      readable << item.offset << " " << item.line << "\n";
+    }
+    readable_lines[i] = readable.str();
+  });
+  for (size_t i = 0; i < methods.size(); ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+
   std::ofstream ofs(debug_line_mapping_filename_v2.c_str(),
                     std::ofstream::out | std::ofstream::trunc);
   uint32_t magic = 0xfaceb000; // serves as endianess check
@@ -555,45 +660,72 @@ void write_debug_line_mapping(
   ofs.write((const char*)&version, bit_32_size);
   ofs.write((const char*)&num_method, bit_32_size);
   FILE* fd = fopen(debug_line_mapping_filename.c_str(), "a");
-  std::ostringstream line_out;
-  std::stringstream readable_line_out;
-
-  auto scope = build_class_scope(stores);
-  walk::methods(scope, [&](DexMethod* method) {
-    auto dex_code = method->get_dex_code();
-    if (dex_code == nullptr ||
-        code_debug_lines.find(dex_code) == code_debug_lines.end()) {
-      return;
-    }
-
-    uint64_t method_id = method_to_id.at(method);
+  for (size_t i = 0; i < methods.size(); ++i) {
+    uint64_t method_id = method_to_id.at(methods[i].first);
     // write human readable file
     fprintf(fd, "0x%016" PRIx64 " %u\n", method_id, offset);
-    readable_line_out << method->get_deobfuscated_name() << "\n";
     // write method id => offset info for binary file
     ofs.write((const char*)&method_id, bit_64_size);
     ofs.write((const char*)&binary_offset, bit_32_size);
 
-    auto debug_lines = code_debug_lines.at(dex_code);
-    uint32_t num_line_info = debug_lines.size();
+    uint32_t num_line_info = methods[i].second->size();
     offset = offset + 1 + num_line_info;
-    uint32_t info_section_size = bit_64_size + num_line_info * 2 * bit_32_size;
+    uint32_t info_section_size = binary_lines[i].size();
     ofs.write((const char*)&info_section_size, bit_32_size);
     binary_offset = binary_offset + info_section_size;
-
-    // Generate debug line info for binary file.
-    line_out.write((const char*)&method_id, bit_64_size);
-    for (auto it = debug_lines.begin(); it != debug_lines.end(); ++it) {
-      line_out.write((const char*)&it->offset, bit_32_size);
-      line_out.write((const char*)&it->line, bit_32_size);
-      readable_line_out << it->offset << " " << it->line << "\n";
-    }
-  });
-  ofs << line_out.str();
-  fprintf(fd, "\n%s", readable_line_out.str().c_str());
+  }
+  for (const auto& binary : binary_lines) {
+    ofs.write(binary.data(), binary.size());
+  }
+  fprintf(fd, "\n");
+  for (const auto& readable : readable_lines) {
+    fwrite(readable.data(), 1, readable.size(), fd);
+  }
   fclose(fd);
 }
 
+/**
+ * Loads the primary and secondary dex files of an APK without extracting them.
+ */
+void load_dexes_from_apk(const std::string& apk_path,
+                         DexStore* store,
+                         dex_stats_t* input_totals,
+                         std::vector<dex_stats_t>* input_dexes_stats) {
+  zip::ZipReader apk;
+  if (!apk.open(apk_path.c_str())) {
+    std::cerr << "error: cannot read input apk: " << apk_path << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::vector<const zip::Entry*> entries;
+  while (auto entry = apk.find(root_dex_name(entries.size()))) {
+    entries.push_back(entry);
+  }
+  if (entries.empty()) {
+    std::cerr << "error: no classes.dex in " << apk_path << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // Classes are loaded in parallel within each dex, so only the
+  // decompression is parallelized across dex files.
+  std::vector<std::string> contents(entries.size());
+  auto wq = workqueue_foreach<size_t>(
+      [&](size_t i) { contents[i] = apk.read(*entries[i]); });
+  for (size_t i = 0; i < entries.size(); i++) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+  for (size_t i = 0; i < entries.size(); i++) {
+    std::string location = apk_path + "/" + entries[i]->name;
+    dex_stats_t dex_stats;
+    DexClasses classes = load_classes_from_dex(
+        location.c_str(), reinterpret_cast<const uint8_t*>(contents[i].data()),
+        contents[i].size(), &dex_stats);
+    std::string().swap(contents[i]);
+    *input_totals += dex_stats;
+    input_dexes_stats->push_back(dex_stats);
+    store->add_classes(std::move(classes));
+  }
+}
+
 /**
  * Pre processing steps: load dex and configurations
  */
@@ -631,9 +763,12 @@ void redex_frontend(ConfigFiles& cfg, /* input */
     Timer t("Load classes from dexes");
     dex_stats_t input_totals;
     std::vector<dex_stats_t> input_dexes_stats;
+    if (!args.input_apk.empty()) {
+      load_dexes_from_apk(args.input_apk, &stores[0], &input_totals,
+                          &input_dexes_stats);
+    }
     for (const auto& filename : args.dex_files) {
-      if (filename.size() >= 5 &&
-          filename.compare(filename.size() - 4, 4, ".dex") == 0) {
+      if (is_dex_file(filename)) {
         dex_stats_t dex_stats;
         DexClasses classes =
             load_classes_from_dex(filename.c_str(), &dex_stats);
@@ -712,6 +847,7 @@ void redex_frontend(ConfigFiles& cfg, /* input */
 void redex_backend(const PassManager& manager,
                    const std::string& output_dir,
                    const ConfigFiles& cfg,
+                   const BlockProfile* block_profile,
                    DexStoresVector& stores,
                    Json::Value& stats) {
   Timer redex_backend_timer("Redex_backend");
@@ -721,7 +857,7 @@ void redex_backend(const PassManager& manager,
     cfg.get_json_config().get("lower_with_cfg", false, lower_with_cfg);
     Timer t("Instruction lowering");
     instruction_lowering_stats =
-        instruction_lowering::run(stores, lower_with_cfg);
+        instruction_lowering::run(stores, lower_with_cfg, block_profile);
   }
 
   TRACE(MAIN, 1, "Writing out new DexClasses...\n");
@@ -811,13 +947,8 @@ void redex_backend(const PassManager& manager,
     if (opt_decisions_args.get("enable_logs", false).asBool()) {
       auto opt_decisions_output_path = cfg.metafile(
           opt_decisions_args.get("output_file_name", "").asString());
-      auto opt_data =
-          opt_metadata::OptDataMapper::get_instance().serialize_sql();
-      Json::StyledStreamWriter writer;
-      {
-        std::ofstream opt_data_out(opt_decisions_output_path);
-        writer.write(opt_data_out, opt_data);
-      }
+      std::ofstream opt_data_out(opt_decisions_output_path);
+      opt_metadata::OptDataMapper::get_instance().serialize_sql(opt_data_out);
     }
   }
 
@@ -837,6 +968,105 @@ void redex_backend(const PassManager& manager,
   }
 }
 
+/**
+ * Writes the output APK from the input one. The optimized dex files replace
+ * the input ones and the signature files are dropped, since the APK has to be
+ * signed again. If the passes ran on an unzipped APK directory, its files
+ * replace the entries of the input APK, as passes may have changed, added or
+ * removed resources. Unchanged entries are copied without being recompressed.
+ */
+void write_output_apk(const Arguments& args,
+                      const std::string& apk_dir,
+                      size_t num_dexes) {
+  zip::ZipReader input;
+  if (!input.open(args.input_apk.c_str())) {
+    std::cerr << "error: cannot read input apk: " << args.input_apk
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  struct OutputEntry {
+    std::string name;
+    // The file to read the contents from, if they may have changed.
+    std::string path;
+    const zip::Entry* original;
+    std::string contents;
+  };
+  std::vector<OutputEntry> entries;
+  for (size_t i = 0; i < num_dexes; i++) {
+    auto name = root_dex_name(i);
+    entries.push_back({name, args.out_dir + "/" + name, input.find(name), ""});
+  }
+  std::unordered_set<std::string> in_input;
+  for (const auto& entry : input.entries()) {
+    if (is_root_dex(entry.name) || is_signature_file(entry.name)) {
+      continue;
+    }
+    if (apk_dir.empty() || entry.name.back() == '/') {
+      entries.push_back({entry.name, "", &entry, ""});
+      continue;
+    }
+    auto path = apk_dir + "/" + entry.name;
+    if (boost::filesystem::is_regular_file(path)) {
+      entries.push_back({entry.name, path, &entry, ""});
+      in_input.insert(entry.name);
+    }
+  }
+  if (!apk_dir.empty()) {
+    std::vector<std::string> added;
+    auto root = boost::filesystem::path(apk_dir).generic_string();
+    for (const auto& file :
+         boost::filesystem::recursive_directory_iterator(apk_dir)) {
+      if (!boost::filesystem::is_regular_file(file.path())) {
+        continue;
+      }
+      auto name = file.path().generic_string().substr(root.size() + 1);
+      if (!in_input.count(name) && !is_root_dex(name) &&
+          !is_signature_file(name)) {
+        added.push_back(name);
+      }
+    }
+    std::sort(added.begin(), added.end());
+    for (const auto& name : added) {
+      entries.push_back({name, apk_dir + "/" + name, nullptr, ""});
+    }
+  }
+
+  auto wq = workqueue_foreach<OutputEntry*>([](OutputEntry* entry) {
+    std::ifstream in(entry->path, std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    entry->contents = contents.str();
+    const auto* original = entry->original;
+    if (original != nullptr &&
+        original->ucomp_size == entry->contents.size() &&
+        original->crc32 == zip::crc32(entry->contents)) {
+      // Unchanged, the original compressed contents can be copied.
+      entry->path.clear();
+      std::string().swap(entry->contents);
+    }
+  });
+  for (auto& entry : entries) {
+    if (!entry.path.empty()) {
+      wq.add_item(&entry);
+    }
+  }
+  wq.run_all();
+
+  zip::ZipWriter output(args.output_apk);
+  for (auto& entry : entries) {
+    if (entry.path.empty()) {
+      output.add_raw(*entry.original);
+    } else {
+      bool store = entry.original != nullptr &&
+                   entry.original->comp_method == zip::kCompMethodStore;
+      output.add(entry.name, std::move(entry.contents),
+                 store ? zip::kCompMethodStore : zip::kCompMethodDeflate);
+    }
+  }
+  output.write();
+}
+
 void dump_class_method_info_map(const std::string file_path,
                                 DexStoresVector& stores) {
   std::ofstream ofs(file_path, std::ofstream::out | std::ofstream::trunc);
@@ -946,6 +1176,14 @@ int main(int argc, char* argv[]) {
 
     redex_frontend(cfg, args, *pg_config, stores, stats);
 
+    // The block profile refers to the code as it is before any pass runs.
+    std::unique_ptr<BlockProfile> block_profile;
+    if (!cfg.get_block_counts().empty()) {
+      Timer t("Tagging profiled blocks");
+      block_profile = std::make_unique<BlockProfile>(build_class_scope(stores),
+                                                     cfg.get_block_counts());
+    }
+
     auto const& passes = PassRegistry::get().get_passes();
     PassManager manager(passes, std::move(pg_config), args.config,
                         args.redex_options);
@@ -956,7 +1194,12 @@ int main(int argc, char* argv[]) {
 
     if (args.stop_pass_idx == boost::none) {
       // Call redex_backend by default
-      redex_backend(manager, args.out_dir, cfg, stores, stats);
+      redex_backend(manager, args.out_dir, cfg, block_profile.get(), stores,
+                    stats);
+      if (!args.output_apk.empty()) {
+        Timer t("Writing output apk");
+        write_output_apk(args, apk_dir, stores[0].get_dexen().size());
+      }
       if (!args.config.get("class_method_info_map", "").empty()) {
         dump_class_method_info_map(
             cfg.metafile(
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+
+/*
+ * Lookups in a map of pointers, as in the interning tables of RedexContext,
+ * from an increasing number of threads. The Mixed benchmarks also insert a
+ * new key every 64 lookups. Built into redex-bench; run them alone with
+ * --benchmark_filter='BM_(Lookup|Mixed)<'.
+ */
+namespace {
+
+constexpr size_t kKeys = 1 << 16;
+
+struct Keys {
+  Keys() : storage(new uint64_t[2 * kKeys]) {
+    for (size_t i = 0; i < 2 * kKeys; ++i) {
+      keys.push_back(&storage[i]);
+    }
+  }
+  std::unique_ptr<uint64_t[]> storage;
+  // The first half is in the map; the second half is inserted by the Mixed
+  // benchmarks.
+  std::vector<const uint64_t*> keys;
+};
+
+const Keys& keys() {
+  static const Keys s_keys;
+  return s_keys;
+}
+
+template <typename Map>
+void BM_Lookup(benchmark::State& state) {
+  static Map* map;
+  const auto& k = keys().keys;
+  if (state.thread_index() == 0) {
+    map = new Map();
+    for (size_t i = 0; i < kKeys; ++i) {
+      map->emplace(k[i], i);
+    }
+  }
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map->get(k[i++ % kKeys], 0));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete map;
+  }
+}
+
+template <typename Map>
+void BM_Mixed(benchmark::State& state) {
+  static Map* map;
+  const auto& k = keys().keys;
+  if (state.thread_index() == 0) {
+    map = new Map();
+    for (size_t i = 0; i < kKeys; ++i) {
+      map->emplace(k[i], i);
+    }
+  }
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    if (i % 64 == 0) {
+      map->emplace(k[kKeys + (i / 64) % kKeys], i);
+    }
+    benchmark::DoNotOptimize(map->get(k[i++ % kKeys], 0));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete map;
+  }
+}
+
+using LockedMap = ConcurrentMap<const uint64_t*, size_t>;
+using ReadMostlyMap = ReadMostlyConcurrentMap<const uint64_t*, size_t>;
+
+BENCHMARK_TEMPLATE(BM_Lookup, LockedMap)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Lookup, ReadMostlyMap)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Mixed, LockedMap)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Mixed, ReadMostlyMap)->ThreadRange(1, 64)->UseRealTime();
+
+} // namespace
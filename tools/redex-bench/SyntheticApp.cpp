@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SyntheticApp.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "Creators.h"
+#include "DexAnnotation.h"
+#include "DexUtil.h"
+#include "IRAssembler.h"
+
+namespace bench {
+
+namespace {
+
+constexpr size_t kChainLength = 4;
+
+std::string class_name(size_t i) {
+  return "Lcom/redex/bench/C" + std::to_string(i) + ";";
+}
+
+std::string static_method_name(size_t cls, size_t method) {
+  return class_name(cls) + ".m" + std::to_string(method) + ":(I)I";
+}
+
+std::string static_field_name(size_t cls) {
+  return class_name(cls) + ".s:I";
+}
+
+std::string instance_field_name(size_t cls) {
+  return class_name(cls) + ".i:I";
+}
+
+class Generator {
+ public:
+  explicit Generator(const SyntheticAppConfig& config)
+      : m_config(config), m_random(config.seed) {}
+
+  std::string static_method_code(size_t cls) {
+    std::ostringstream ss;
+    ss << "((load-param v0)\n";
+    ss << "(const v1 " << pick(1000) << ")\n";
+    for (size_t b = 0; b < m_config.blocks_per_method; ++b) {
+      ss << "(add-int v1 v1 v0)\n";
+      ss << "(if-lez v1 :L" << b << ")\n";
+      ss << "(const-string \"str" << pick(m_config.strings) << "\")\n";
+      ss << "(move-result-pseudo-object v2)\n";
+      ss << "(sget \"" << static_field_name(nearby(cls)) << "\")\n";
+      ss << "(move-result-pseudo v3)\n";
+      ss << "(add-int v1 v1 v3)\n";
+      ss << "(invoke-static (v1) \""
+         << static_method_name(nearby(cls), pick(m_config.methods_per_class))
+         << "\")\n";
+      ss << "(move-result v1)\n";
+      ss << "(:L" << b << ")\n";
+    }
+    ss << "(return v1))";
+    return ss.str();
+  }
+
+  std::string virtual_method_code(size_t cls) {
+    std::ostringstream ss;
+    ss << "((load-param-object v0)\n";
+    ss << "(iget v0 \"" << instance_field_name(cls) << "\")\n";
+    ss << "(move-result-pseudo v1)\n";
+    ss << "(return v1))";
+    return ss.str();
+  }
+
+ private:
+  size_t pick(size_t n) { return m_random() % n; }
+
+  // Most references stay within a window of classes around `cls`, as they
+  // would within a package, and the rest go anywhere.
+  size_t nearby(size_t cls) {
+    if (pick(8) == 0) {
+      return pick(m_config.classes);
+    }
+    return (cls + m_config.classes + pick(32) - 16) % m_config.classes;
+  }
+
+  const SyntheticAppConfig& m_config;
+  std::mt19937 m_random;
+};
+
+} // namespace
+
+Scope make_synthetic_app(const SyntheticAppConfig& config) {
+  Generator generator(config);
+  Scope scope;
+  for (size_t i = 0; i < config.classes; ++i) {
+    ClassCreator creator(DexType::make_type(class_name(i).c_str()));
+    bool chain_start = i % kChainLength == 0;
+    creator.set_super(chain_start
+                          ? get_object_type()
+                          : DexType::make_type(class_name(i - 1).c_str()));
+
+    auto sfield = static_cast<DexField*>(
+        DexField::make_field(static_field_name(i)));
+    sfield->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                          DexEncodedValue::zero_for_type(get_int_type()));
+    creator.add_field(sfield);
+    auto ifield = static_cast<DexField*>(
+        DexField::make_field(instance_field_name(i)));
+    ifield->make_concrete(ACC_PUBLIC);
+    creator.add_field(ifield);
+
+    for (size_t j = 0; j < config.methods_per_class; ++j) {
+      auto method = static_cast<DexMethod*>(
+          DexMethod::make_method(static_method_name(i, j)));
+      method->make_concrete(
+          ACC_PUBLIC | ACC_STATIC,
+          assembler::ircode_from_string(generator.static_method_code(i)),
+          /* is_virtual */ false);
+      creator.add_method(method);
+    }
+    auto vmethod = static_cast<DexMethod*>(
+        DexMethod::make_method(class_name(i) + ".v:()I"));
+    vmethod->make_concrete(
+        ACC_PUBLIC,
+        assembler::ircode_from_string(generator.virtual_method_code(i)),
+        /* is_virtual */ true);
+    creator.add_method(vmethod);
+
+    auto cls = creator.create();
+    if (chain_start) {
+      cls->rstate.set_root();
+    }
+    scope.push_back(cls);
+  }
+  return scope;
+}
+
+} // namespace bench
@@ -0,0 +1,38 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DexClass.h"
+
+namespace bench {
+
+struct SyntheticAppConfig {
+  size_t classes{2000};
+  size_t methods_per_class{8};
+  size_t blocks_per_method{6};
+  // Distinct string literals shared by the whole app.
+  size_t strings{5000};
+  // The same seed always gives the same app.
+  uint32_t seed{42};
+};
+
+/*
+ * Creates a made-up app in the current RedexContext, shaped roughly like the
+ * code of a real one: short inheritance chains, static methods made of
+ * branchy blocks that load fields and strings and mostly call into nearby
+ * classes, and a virtual method per class that overrides its parent's.
+ *
+ * The first class of each chain is a root, so that reachability has
+ * something to start from.
+ */
+Scope make_synthetic_app(const SyntheticAppConfig& config);
+
+} // namespace bench
@@ -0,0 +1,431 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Regression benchmarks for the core operations of libredex.
+ *
+ *   redex-bench [--benchmark_out=results.json] [--synthetic_classes=N]
+ *               [classes.dex ...]
+ *
+ * Without dex files, every benchmark runs on a synthetic app (see
+ * SyntheticApp.h) that is the same from run to run. With dex files, e.g. the
+ * ones of a sample APK, they run on those instead.
+ *
+ * Besides the timings, each benchmark reports the resident memory at its end
+ * as `rss_mb`, and the process' high-water mark as `peak_rss_mb`. Run a single
+ * benchmark with --benchmark_filter for the latter to be about it alone.
+ * --benchmark_out writes all of it as JSON.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <json/json.h>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+#include "ClassHierarchy.h"
+#include "ConfigFiles.h"
+#include "ConstantPropagationAnalysis.h"
+#include "CrossDexRefMinimizer.h"
+#include "DexLoader.h"
+#include "DexOutput.h"
+#include "DexPosition.h"
+#include "DexStore.h"
+#include "DexUtil.h"
+#include "GraphColoring.h"
+#include "InstructionLowering.h"
+#include "IRCode.h"
+#include "LiveRange.h"
+#include "Liveness.h"
+#include "Reachability.h"
+#include "RedexContext.h"
+#include "SyntheticApp.h"
+#include "Transform.h"
+#include "Walkers.h"
+
+namespace {
+
+std::vector<std::string> g_dex_files;
+bench::SyntheticAppConfig g_synthetic_config;
+
+size_t get_peak_rss_mb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss >> 20;
+#else
+  return usage.ru_maxrss >> 10;
+#endif
+}
+
+size_t get_rss_mb() {
+#ifdef __linux__
+  long size = 0;
+  long resident = 0;
+  auto statm = fopen("/proc/self/statm", "r");
+  if (statm != nullptr) {
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(statm);
+  }
+  return (resident * sysconf(_SC_PAGESIZE)) >> 20;
+#else
+  return get_peak_rss_mb();
+#endif
+}
+
+/*
+ * A fresh RedexContext holding the app under test, for the lifetime of one
+ * benchmark.
+ */
+class App {
+ public:
+  App() {
+    g_redex = new RedexContext();
+    if (g_dex_files.empty()) {
+      m_scope = bench::make_synthetic_app(g_synthetic_config);
+    } else {
+      for (const auto& dex : g_dex_files) {
+        auto classes = load_classes_from_dex(dex.c_str());
+        m_scope.insert(m_scope.end(), classes.begin(), classes.end());
+      }
+      // There are no keep rules here, so root as many classes as the
+      // synthetic app does.
+      for (size_t i = 0; i < m_scope.size(); i += 4) {
+        m_scope[i]->rstate.set_root();
+      }
+    }
+    for (auto* m : methods()) {
+      m_originals.emplace(m, std::make_unique<IRCode>(*m->get_code()));
+    }
+  }
+
+  ~App() {
+    delete g_redex;
+    g_redex = nullptr;
+  }
+
+  const Scope& scope() const { return m_scope; }
+
+  DexStoresVector stores() const {
+    DexStore store("classes");
+    store.add_classes(m_scope);
+    DexStoresVector stores;
+    stores.emplace_back(std::move(store));
+    return stores;
+  }
+
+  std::vector<DexMethod*> methods() const {
+    std::vector<DexMethod*> methods;
+    walk::code(m_scope,
+               [&methods](DexMethod* m, IRCode&) { methods.push_back(m); });
+    return methods;
+  }
+
+  // Brings back the code as it was after loading, for destructive benchmarks.
+  void reset_code() {
+    for (auto& pair : m_originals) {
+      pair.first->set_dex_code(nullptr);
+      pair.first->set_code(std::make_unique<IRCode>(*pair.second));
+    }
+  }
+
+  size_t instruction_count() const {
+    size_t count = 0;
+    for (auto& pair : m_originals) {
+      count += pair.second->count_opcodes();
+    }
+    return count;
+  }
+
+ private:
+  Scope m_scope;
+  std::unordered_map<DexMethod*, std::unique_ptr<IRCode>> m_originals;
+};
+
+void report(benchmark::State& state, size_t items) {
+  state.SetItemsProcessed(state.iterations() * items);
+  state.counters["rss_mb"] = get_rss_mb();
+  state.counters["peak_rss_mb"] = get_peak_rss_mb();
+}
+
+void allocate_registers(IRCode* code) {
+  code->build_cfg(/* editable */ false);
+  transform::remove_unreachable_blocks(code);
+  live_range::renumber_registers(code, /* width_aware */ false);
+  regalloc::graph_coloring::Allocator allocator;
+  allocator.allocate(code);
+  code->clear_cfg();
+}
+
+void write_dex(const std::string& path, DexClasses* classes) {
+  Json::Value json(Json::objectValue);
+  ConfigFiles cfg(json);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make("", ""));
+  write_classes_to_dex(path,
+                       classes,
+                       nullptr /* LocatorIndex* */,
+                       false /* name-based locators */,
+                       0,
+                       0,
+                       cfg,
+                       pos_mapper.get(),
+                       nullptr,
+                       nullptr,
+                       nullptr /* IODIMetadata* */);
+}
+
+// Lowers the code of the app so that it can be written out.
+void prepare_for_output(App* app) {
+  for (auto* m : app->methods()) {
+    allocate_registers(m->get_code());
+  }
+  auto stores = app->stores();
+  instruction_lowering::run(stores);
+}
+
+std::string temp_path(const std::string& name) {
+  return (boost::filesystem::temp_directory_path() /
+          boost::filesystem::unique_path("redex-bench-%%%%-%%%%-" + name))
+      .string();
+}
+
+std::string g_synthetic_dex;
+
+// The dex files to load: the given ones, or the synthetic app written out.
+std::vector<std::string> dex_inputs() {
+  if (!g_dex_files.empty()) {
+    return g_dex_files;
+  }
+  if (g_synthetic_dex.empty()) {
+    App app;
+    prepare_for_output(&app);
+    DexClasses classes(app.scope().begin(), app.scope().end());
+    g_synthetic_dex = temp_path("classes.dex");
+    write_dex(g_synthetic_dex, &classes);
+  }
+  return {g_synthetic_dex};
+}
+
+void BM_LoadDex(benchmark::State& state) {
+  auto inputs = dex_inputs();
+  size_t classes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    delete g_redex;
+    g_redex = new RedexContext();
+    state.ResumeTiming();
+    classes = 0;
+    for (const auto& dex : inputs) {
+      classes += load_classes_from_dex(dex.c_str(), /* balloon */ true).size();
+    }
+  }
+  report(state, classes);
+  delete g_redex;
+  g_redex = nullptr;
+}
+
+void BM_InternStrings(benchmark::State& state) {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < 100000; ++i) {
+    names.push_back("Lcom/redex/bench/Interned" + std::to_string(i) + ";");
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    delete g_redex;
+    g_redex = new RedexContext();
+    state.ResumeTiming();
+    for (const auto& name : names) {
+      benchmark::DoNotOptimize(DexString::make_string(name));
+    }
+  }
+  report(state, names.size());
+  delete g_redex;
+  g_redex = nullptr;
+}
+
+void BM_LookupTypes(benchmark::State& state) {
+  App app;
+  std::vector<std::string> names;
+  for (auto* cls : app.scope()) {
+    names.push_back(cls->get_type()->get_name()->str());
+  }
+  for (auto _ : state) {
+    for (const auto& name : names) {
+      benchmark::DoNotOptimize(DexType::get_type(name.c_str()));
+    }
+  }
+  report(state, names.size());
+}
+
+void BM_BuildAndLinearizeCfg(benchmark::State& state) {
+  App app;
+  auto methods = app.methods();
+  for (auto _ : state) {
+    for (auto* m : methods) {
+      auto* code = m->get_code();
+      code->build_cfg(/* editable */ true);
+      code->clear_cfg();
+    }
+  }
+  report(state, app.instruction_count());
+}
+
+void BM_Liveness(benchmark::State& state) {
+  App app;
+  auto methods = app.methods();
+  for (auto* m : methods) {
+    m->get_code()->build_cfg(/* editable */ false);
+    m->get_code()->cfg().calculate_exit_block();
+  }
+  for (auto _ : state) {
+    for (auto* m : methods) {
+      LivenessFixpointIterator fixpoint_iter(m->get_code()->cfg());
+      fixpoint_iter.run(LivenessDomain());
+    }
+  }
+  report(state, app.instruction_count());
+}
+
+void BM_ConstantPropagation(benchmark::State& state) {
+  using namespace constant_propagation;
+  App app;
+  auto methods = app.methods();
+  for (auto* m : methods) {
+    m->get_code()->build_cfg(/* editable */ false);
+  }
+  for (auto _ : state) {
+    for (auto* m : methods) {
+      intraprocedural::FixpointIterator fp_iter(m->get_code()->cfg(),
+                                                ConstantPrimitiveAnalyzer());
+      fp_iter.run(ConstantEnvironment());
+    }
+  }
+  report(state, app.instruction_count());
+}
+
+void BM_RegAlloc(benchmark::State& state) {
+  App app;
+  for (auto _ : state) {
+    state.PauseTiming();
+    app.reset_code();
+    auto methods = app.methods();
+    state.ResumeTiming();
+    for (auto* m : methods) {
+      allocate_registers(m->get_code());
+    }
+  }
+  report(state, app.instruction_count());
+}
+
+void BM_Reachability(benchmark::State& state) {
+  App app;
+  auto stores = app.stores();
+  reachability::IgnoreSets ignore_sets;
+  for (auto _ : state) {
+    int num_ignore_check_strings = 0;
+    benchmark::DoNotOptimize(reachability::compute_reachable_objects(
+        stores, ignore_sets, &num_ignore_check_strings));
+  }
+  report(state, app.scope().size());
+}
+
+void BM_ClassHierarchy(benchmark::State& state) {
+  App app;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(build_type_hierarchy(app.scope()));
+  }
+  report(state, app.scope().size());
+}
+
+/*
+ * The class ordering of InterDex with minimize_cross_dex_refs and its default
+ * weights, starting a new dex every 1000 classes.
+ */
+void BM_InterDexPlacement(benchmark::State& state) {
+  App app;
+  interdex::CrossDexRefMinimizerConfig config;
+  config.method_ref_weight = 100;
+  config.field_ref_weight = 90;
+  config.type_ref_weight = 100;
+  config.string_ref_weight = 90;
+  for (auto _ : state) {
+    interdex::CrossDexRefMinimizer minimizer(config);
+    for (auto* cls : app.scope()) {
+      minimizer.insert(cls);
+    }
+    size_t placed = 0;
+    while (!minimizer.empty()) {
+      bool new_dex = placed++ % 1000 == 0;
+      auto* cls = new_dex ? minimizer.worst() : minimizer.front();
+      minimizer.erase(cls, /* emitted */ true, /* reset */ new_dex);
+    }
+  }
+  report(state, app.scope().size());
+}
+
+void BM_WriteDex(benchmark::State& state) {
+  App app;
+  DexClasses classes(app.scope().begin(), app.scope().end());
+  auto path = temp_path("classes.dex");
+  for (auto _ : state) {
+    state.PauseTiming();
+    app.reset_code();
+    prepare_for_output(&app);
+    state.ResumeTiming();
+    write_dex(path, &classes);
+  }
+  report(state, classes.size());
+  boost::filesystem::remove(path);
+}
+
+BENCHMARK(BM_LoadDex)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_InternStrings)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LookupTypes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_BuildAndLinearizeCfg)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_Liveness)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ConstantPropagation)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_RegAlloc)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_Reachability)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ClassHierarchy)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_InterDexPlacement)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WriteDex)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  const char* kClassesFlag = "--synthetic_classes=";
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], kClassesFlag, strlen(kClassesFlag)) == 0) {
+      g_synthetic_config.classes = atoi(argv[i] + strlen(kClassesFlag));
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Unknown argument %s\n", argv[i]);
+      return 1;
+    } else {
+      g_dex_files.emplace_back(argv[i]);
+    }
+  }
+  benchmark::AddCustomContext(
+      "input", g_dex_files.empty()
+                   ? "synthetic:" + std::to_string(g_synthetic_config.classes)
+                   : std::to_string(g_dex_files.size()) + " dex files");
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (!g_synthetic_dex.empty()) {
+    boost::filesystem::remove(g_synthetic_dex);
+  }
+  return 0;
+}
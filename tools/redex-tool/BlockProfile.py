@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Writes the profiled_blocks_file of the Redex config (see docs/Config.md) from
+the output of InstrumentPass's basic block tracing.
+
+The metadata file is the one InstrumentPass writes, with one
+"<offset>,<method name>,<number of blocks>" line per instrumented method. Each
+dump holds the values of the sBasicBlockStats array after one run of the
+instrumented app, one per line. A method's blocks are the bits of the
+sBasicBlockStats entries from its offset on, 15 blocks per entry. The count of
+a block is the number of runs it executed in.
+
+InstrumentPass must have been the first pass of the instrumented build, so
+that its block ids are those of the input code.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+import argparse
+import sys
+
+BLOCKS_PER_VECTOR = 15
+
+
+def read_metadata(path):
+    methods = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            offset, name, num_blocks = line.split(",")
+            methods.append((name, int(offset), int(num_blocks)))
+    return methods
+
+
+def read_dump(path):
+    with open(path) as f:
+        return [int(line) for line in f if line.strip()]
+
+
+def count_blocks(methods, dumps):
+    counts = {}
+    for stats in dumps:
+        for name, offset, num_blocks in methods:
+            for block in range(num_blocks):
+                index = offset + block // BLOCKS_PER_VECTOR
+                if index >= len(stats):
+                    break
+                if stats[index] & (1 << (block % BLOCKS_PER_VECTOR)):
+                    key = (name, block)
+                    counts[key] = counts.get(key, 0) + 1
+    return counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("metadata", help="InstrumentPass metadata file")
+    parser.add_argument("dumps", nargs="+", help="sBasicBlockStats dumps")
+    parser.add_argument(
+        "-o", "--output", help="the block profile to write (defaults to stdout)"
+    )
+    args = parser.parse_args()
+
+    methods = read_metadata(args.metadata)
+    counts = count_blocks(methods, [read_dump(path) for path in args.dumps])
+    out = open(args.output, "w") if args.output else sys.stdout
+    for (name, block), count in sorted(counts.items()):
+        out.write("%s %d %d\n" % (name, block, count))
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -34,136 +34,186 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
-static std::unordered_map<DexClass*, int> class_ids;
-static std::unordered_map<DexMethod*, int> method_ids;
-static std::unordered_map<DexField*, int> field_ids;
-static std::unordered_map<DexString*, int> string_ids;
+// Number of rows per INSERT statement. sqlite parses one multi-row statement
+// much faster than the same rows as separate statements.
+constexpr size_t kRowsPerInsert = 500;
 
-void dump_field_refs(FILE* fdout, const char* prefix, DexField* field, int field_id) {
-  static int next_string_ref = 0;
+// Formats the values of a row, without the surrounding parentheses.
+template <typename... Args>
+std::string values(const char* fmt, Args... args) {
+  int len = snprintf(nullptr, 0, fmt, args...);
+  std::vector<char> buf(len + 1);
+  snprintf(buf.data(), buf.size(), fmt, args...);
+  return std::string(buf.data(), len);
+}
+
+/*
+ * Writes the rows of one table as batched multi-row INSERT statements.
+ */
+class TableWriter {
+ public:
+  TableWriter(FILE* fdout, const char* prefix, const char* table)
+      : m_fdout(fdout), m_prefix(prefix), m_table(table) {}
+
+  ~TableWriter() { flush(); }
+
+  void add(const std::string& row) {
+    if (m_rows_in_insert == 0) {
+      fprintf(m_fdout, "INSERT INTO %s%s VALUES\n  (%s)", m_prefix, m_table,
+              row.c_str());
+    } else {
+      fprintf(m_fdout, ",\n  (%s)", row.c_str());
+    }
+    if (++m_rows_in_insert == kRowsPerInsert) {
+      flush();
+    }
+  }
+
+  // Adds a row, prefixed with the next id of the table.
+  void add_with_id(const std::string& row) {
+    add(std::to_string(m_next_id++) + ", " + row);
+  }
+
+  void flush() {
+    if (m_rows_in_insert > 0) {
+      fprintf(m_fdout, ";\n");
+      m_rows_in_insert = 0;
+    }
+  }
+
+ private:
+  FILE* m_fdout;
+  const char* m_prefix;
+  const char* m_table;
+  size_t m_rows_in_insert{0};
+  int m_next_id{0};
+};
+
+// The ids of the dumped items. They are assigned sequentially, in the order of
+// the stores, before anything is dumped in parallel.
+struct Ids {
+  std::unordered_map<const DexClass*, int> classes;
+  std::unordered_map<const DexMethod*, int> methods;
+  std::unordered_map<const DexField*, int> fields;
+  std::unordered_map<const DexString*, int> strings;
+};
+
+template <typename T>
+bool find_id(const std::unordered_map<const T*, int>& ids,
+             const T* item,
+             int* id) {
+  auto it = ids.find(item);
+  if (it == ids.end()) {
+    return false;
+  }
+  *id = it->second;
+  return true;
+}
+
+// The rows of everything defined in one class. The rows of the reference
+// tables don't have an id yet: those are numbered when written out, so that
+// they don't depend on the order in which the classes were processed.
+struct ClassRows {
+  std::string cls;
+  std::vector<std::string> fields;
+  std::vector<std::string> methods;
+  std::vector<std::string> field_string_refs;
+  std::vector<std::string> method_string_refs;
+  std::vector<std::string> method_class_refs;
+  std::vector<std::string> method_field_refs;
+  std::vector<std::string> method_method_refs;
+};
+
+void dump_field_refs(const Ids& ids,
+                     DexField* field,
+                     int field_id,
+                     ClassRows& rows) {
   auto* static_value = field->get_static_value();
   if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
   auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
-  auto string_id = string_ids[static_string_value->string()];
-  fprintf(
-    fdout,
-    "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-    prefix,
-    next_string_ref++,
-    field_id,
-    string_id);
+  int string_id = 0;
+  find_id(ids.strings, static_cast<const DexString*>(
+                           static_string_value->string()), &string_id);
+  rows.field_string_refs.push_back(values("%d, %d", field_id, string_id));
 }
 
-void dump_method_refs(FILE* fdout, const char* prefix, DexMethod* method, int method_id) {
+void dump_method_refs(const Ids& ids,
+                      DexMethod* method,
+                      int method_id,
+                      ClassRows& rows) {
   auto code = method->get_code();
   if (!code) return;
 
-  static int next_string_ref = 0;
-  static int next_class_ref = 0;
-  static int next_field_ref = 0;
-  static int next_method_ref = 0;
-
   for (auto& mie : InstructionIterable(code)) {
     auto insn = mie.insn;
+    int id;
     if (insn->has_string()) {
-      if (string_ids.count(insn->get_string())) {
-        auto string_id = string_ids[insn->get_string()];
-        fprintf(
-          fdout,
-          "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          method_id,
-          string_id,
-          insn->opcode());
+      if (find_id(ids.strings,
+                  static_cast<const DexString*>(insn->get_string()), &id)) {
+        rows.method_string_refs.push_back(
+            values("%d, %d, %d", method_id, id, insn->opcode()));
       }
     }
     if (insn->has_type()) {
       auto cls = type_class(insn->get_type());
-      if (cls && class_ids.count(cls)) {
-        auto class_id = class_ids[cls];
-        fprintf(
-          fdout,
-          "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-          prefix,
-          next_class_ref++,
-          method_id,
-          class_id,
-          insn->opcode());
+      if (cls && find_id(ids.classes, static_cast<const DexClass*>(cls), &id)) {
+        rows.method_class_refs.push_back(
+            values("%d, %d, %d", method_id, id, insn->opcode()));
       }
     }
     if (insn->has_field()) {
       auto field = resolve_field(insn->get_field());
-      if (field != nullptr && field_ids.count(field)) {
-        auto field_id = field_ids[field];
-        fprintf(
-          fdout,
-          "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-          prefix,
-          next_field_ref++,
-          method_id,
-          field_id,
-          insn->opcode());
+      if (field != nullptr &&
+          find_id(ids.fields, static_cast<const DexField*>(field), &id)) {
+        rows.method_field_refs.push_back(
+            values("%d, %d, %d", method_id, id, insn->opcode()));
       }
     }
     if (insn->has_method()) {
       auto meth = resolve_method(insn->get_method(), opcode_to_search(insn));
-      if (meth != nullptr && method_ids.count(meth)) {
-        auto method_ref_id = method_ids[meth];
-        fprintf(
-          fdout,
-          "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-          prefix,
-          next_method_ref++,
-          method_id,
-          method_ref_id,
-          insn->opcode());
+      if (meth != nullptr &&
+          find_id(ids.methods, static_cast<const DexMethod*>(meth), &id)) {
+        rows.method_method_refs.push_back(
+            values("%d, %d, %d", method_id, id, insn->opcode()));
       }
     }
   }
 }
 
-void dump_class(FILE* fdout, const char* prefix, const char* dex_id, DexClass* cls, int class_id) {
+std::string dump_class(const char* dex_id, DexClass* cls, int class_id) {
   // TODO: annotations?
   // TODO: inheritance?
   // TODO: string usage
   // TODO: size estimate
   auto deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(
-    fdout,
-    "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-    prefix,
-    class_id,
-    dex_id,
-    deobfuscated_name.c_str(),
-    cls->get_name()->c_str(),
-    cls->get_access()
-  );
+  return values("%d,'%s','%s','%s',%u",
+                class_id,
+                dex_id,
+                deobfuscated_name.c_str(),
+                cls->get_name()->c_str(),
+                cls->get_access());
 }
 
-void dump_field(FILE* fdout, const char* prefix, int class_id, DexField* field, int field_id) {
+std::string dump_field(int class_id, DexField* field, int field_id) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: annotations?
   // TODO: string usage (encoded_value for static fields)
   auto deobfuscated_name = field->get_deobfuscated_name();
   auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(
-    fdout,
-    "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-    prefix,
-    field_id,
-    class_id,
-    field_name,
-    field->get_name()->c_str(),
-    field->get_access()
-  );
+  return values("%d, %d, '%s', '%s', %u",
+                field_id,
+                class_id,
+                field_name,
+                field->get_name()->c_str(),
+                field->get_access());
 }
 
-void dump_method(FILE* fdout, const char* prefix, int class_id, DexMethod* method, int method_id) {
+std::string dump_method(int class_id, DexMethod* method, int method_id) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: throws?
@@ -172,17 +222,53 @@ void dump_method(FILE* fdout, const char* prefix, int class_id, DexMethod* metho
   // TODO: size estimate
   auto deobfuscated_name = method->get_deobfuscated_name();
   auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(
-    fdout,
-    "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%lu);\n",
-    prefix,
-    method_id,
-    class_id,
-    method_name,
-    method->get_name()->c_str(),
-    method->get_access(),
-    method->get_code() ? method->get_code()->sum_opcode_sizes() : 0
-  );
+  return values(
+      "%d,%d,'%s','%s',%d,%lu",
+      method_id,
+      class_id,
+      method_name,
+      method->get_name()->c_str(),
+      method->get_access(),
+      method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
+}
+
+// Formats all the rows of the class. This only reads the ids, so it runs on
+// all the classes in parallel.
+ClassRows dump_class_rows(const Ids& ids, const char* dex_id, DexClass* cls) {
+  ClassRows rows;
+  int class_id = ids.classes.at(cls);
+  rows.cls = dump_class(dex_id, cls, class_id);
+  for (auto& fields : {&cls->get_ifields(), &cls->get_sfields()}) {
+    for (auto field : *fields) {
+      rows.fields.push_back(dump_field(class_id, field, ids.fields.at(field)));
+    }
+  }
+  for (auto& methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+    for (auto meth : *methods) {
+      rows.methods.push_back(dump_method(class_id, meth, ids.methods.at(meth)));
+    }
+  }
+  for (auto& methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+    for (auto meth : *methods) {
+      dump_method_refs(ids, meth, ids.methods.at(meth), rows);
+    }
+  }
+  for (auto& fields : {&cls->get_sfields(), &cls->get_ifields()}) {
+    for (auto field : *fields) {
+      dump_field_refs(ids, field, ids.fields.at(field), rows);
+    }
+  }
+  return rows;
+}
+
+// Runs `f` on the indices [0, n) in parallel.
+template <typename Fn>
+void parallel_for(size_t n, const Fn& f) {
+  auto wq = workqueue_foreach<size_t>([&f](size_t i) { f(i); });
+  for (size_t i = 0; i < n; ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
 }
 
 void dump_sql(
@@ -266,107 +352,130 @@ CREATE TABLE %1$smethod_string_refs (
 )___",
     prefix
   );
-  int next_class_id = 0;
-  int next_method_id = 0;
-  int next_field_id = 0;
-  int next_string_id = 0;
 
-  // Dump all dex items
+  // Assign all the ids up front, in the order of the stores.
+  Ids ids;
+  std::vector<DexClass*> classes;
+  std::vector<std::string> class_dex_ids;
   fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& store : stores) {
-    auto store_name = store.get_name();
-    auto& dexen = store.get_dexen();
-    apply_deobfuscated_names(dexen, pg_map);
-    for (size_t dex_idx = 0 ; dex_idx < dexen.size() ; ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      GatheredTypes gtypes(&dex);
-      auto strings = gtypes.get_cls_order_dexstring_emitlist();
-      for (auto dexstr : strings) {
-        int id = next_string_id++;
-        string_ids[dexstr] = id;
-        // Escape string before inserting. ' -> ''
-        std::string esc(dexstr->c_str());
-        boost::replace_all(esc, "'", "''");
-        fprintf(fdout, "INSERT INTO %sstrings VALUES(%d, '%s');\n", prefix, id, esc.c_str());
-      }
-      std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
-      const char* dex_id = dex_id_str.c_str();
-      for (const auto& cls : dex) {
-        int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
-        class_ids[cls] = class_id;
-        for (auto field : cls->get_ifields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (auto field : cls->get_sfields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
+  {
+    TableWriter strings_table(fdout, prefix, "strings");
+    int next_string_id = 0;
+    for (auto& store : stores) {
+      auto store_name = store.get_name();
+      auto& dexen = store.get_dexen();
+      apply_deobfuscated_names(dexen, pg_map);
+      for (size_t dex_idx = 0 ; dex_idx < dexen.size() ; ++dex_idx) {
+        auto& dex = dexen[dex_idx];
+        GatheredTypes gtypes(&dex);
+        auto strings = gtypes.get_cls_order_dexstring_emitlist();
+        for (auto dexstr : strings) {
+          int id = next_string_id++;
+          ids.strings[dexstr] = id;
+          // Escape string before inserting. ' -> ''
+          std::string esc(dexstr->c_str());
+          boost::replace_all(esc, "'", "''");
+          strings_table.add(values("%d, '%s'", id, esc.c_str()));
         }
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
+        std::string dex_id(store_name + "/" + std::to_string(dex_idx));
+        for (const auto& cls : dex) {
+          ids.classes.emplace(cls, ids.classes.size());
+          for (auto& fields : {&cls->get_ifields(), &cls->get_sfields()}) {
+            for (auto field : *fields) {
+              ids.fields.emplace(field, ids.fields.size());
+            }
+          }
+          for (auto& methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+            for (auto meth : *methods) {
+              ids.methods.emplace(meth, ids.methods.size());
+            }
+          }
+          classes.push_back(cls);
+          class_dex_ids.push_back(dex_id);
         }
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
 
-  // Dump references
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& store : stores) {
-    auto& dexen = store.get_dexen();
-    for (size_t dex_idx = 0 ; dex_idx < dexen.size() ; ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      for (const auto& cls : dex) {
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (const auto& field : cls->get_sfields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
-        for (const auto& field : cls->get_ifields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
+  // Format the rows of every class in parallel...
+  std::vector<ClassRows> class_rows(classes.size());
+  parallel_for(classes.size(), [&](size_t i) {
+    class_rows[i] =
+        dump_class_rows(ids, class_dex_ids[i].c_str(), classes[i]);
+  });
+
+  // ... and write them out table by table, in class order.
+  const auto& write_table = [&](const char* table, bool with_id,
+                                const auto& get_rows) {
+    TableWriter writer(fdout, prefix, table);
+    for (auto& rows : class_rows) {
+      for (const auto& row : get_rows(rows)) {
+        if (with_id) {
+          writer.add_with_id(row);
+        } else {
+          writer.add(row);
         }
       }
     }
+  };
+  {
+    TableWriter classes_table(fdout, prefix, "classes");
+    for (auto& rows : class_rows) {
+      classes_table.add(rows.cls);
+    }
   }
+  write_table("fields", false,
+              [](const ClassRows& rows) -> auto& { return rows.fields; });
+  write_table("methods", false,
+              [](const ClassRows& rows) -> auto& { return rows.methods; });
   fprintf(fdout, "END TRANSACTION;\n");
 
+  // Dump references
+  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  write_table("method_string_refs", true, [](const ClassRows& rows) -> auto& {
+    return rows.method_string_refs;
+  });
+  write_table("method_class_refs", true, [](const ClassRows& rows) -> auto& {
+    return rows.method_class_refs;
+  });
+  write_table("method_field_refs", true, [](const ClassRows& rows) -> auto& {
+    return rows.method_field_refs;
+  });
+  write_table("method_method_refs", true, [](const ClassRows& rows) -> auto& {
+    return rows.method_method_refs;
+  });
+  write_table("field_string_refs", true, [](const ClassRows& rows) -> auto& {
+    return rows.field_string_refs;
+  });
+  fprintf(fdout, "END TRANSACTION;\n");
+  class_rows.clear();
+
   // Dump hierarchy
   auto scope = build_class_scope(stores);
   ClassHierarchy ch = build_type_hierarchy(scope);
-  int next_is_a_id = 0;
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& cls : scope) {
+  std::vector<std::vector<std::string>> is_a_rows(scope.size());
+  parallel_for(scope.size(), [&](size_t i) {
+    auto cls = scope[i];
     TypeSet results;
     get_all_children_or_implementors(ch, scope, cls, results);
-    for(auto type : results) {
+    for (auto type : results) {
       auto type_cls = type_class(type);
       if (type_cls) {
-        fprintf(
-          fdout,
-          "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-          prefix,
-          next_is_a_id++,
-          class_ids[type_cls],
-          class_ids[cls]
-        );
+        int type_cls_id = 0;
+        int cls_id = 0;
+        find_id(ids.classes, static_cast<const DexClass*>(type_cls),
+                &type_cls_id);
+        find_id(ids.classes, static_cast<const DexClass*>(cls), &cls_id);
+        is_a_rows[i].push_back(values("%d, %d", type_cls_id, cls_id));
+      }
+    }
+  });
+  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  {
+    TableWriter is_a_table(fdout, prefix, "is_a");
+    for (auto& rows : is_a_rows) {
+      for (const auto& row : rows) {
+        is_a_table.add_with_id(row);
       }
     }
   }
@@ -0,0 +1,479 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Debug.h"
+#include "Tool.h"
+#include "WorkQueue.h"
+
+/*
+ * This tool reads an HPROF heap dump of an Android app and writes the list of
+ * the classes it had loaded, in load order, in the format of the
+ * `coldstart_classes` file of the redex config:
+ *
+ * com/foo/Bar.class
+ * com/foo/Bar$Baz.class
+ * ...
+ *
+ * It is a faster replacement of tools/hprof/dump_classes_from_hprof.py. The
+ * file is mapped in memory and never copied; the heap dump segments, which
+ * make up almost all of the file, are parsed in parallel. Optionally, it also
+ * writes the number of instances and the shallow size of each class in the
+ * heap, largest first.
+ */
+namespace {
+
+enum HprofTag : uint8_t {
+  STRING = 0x01,
+  LOAD_CLASS = 0x02,
+  HEAP_DUMP = 0x0C,
+  HEAP_DUMP_SEGMENT = 0x1C,
+  HEAP_DUMP_END = 0x2C,
+};
+
+enum HeapTag : uint8_t {
+  ROOT_JNI_GLOBAL = 0x01,
+  ROOT_JNI_LOCAL = 0x02,
+  ROOT_JAVA_FRAME = 0x03,
+  ROOT_NATIVE_STACK = 0x04,
+  ROOT_STICKY_CLASS = 0x05,
+  ROOT_THREAD_BLOCK = 0x06,
+  ROOT_MONITOR_USED = 0x07,
+  ROOT_THREAD_OBJECT = 0x08,
+  CLASS_DUMP = 0x20,
+  INSTANCE_DUMP = 0x21,
+  OBJECT_ARRAY_DUMP = 0x22,
+  PRIMITIVE_ARRAY_DUMP = 0x23,
+  // Android extensions.
+  ROOT_INTERNED_STRING = 0x89,
+  ROOT_FINALIZING = 0x8a,
+  ROOT_DEBUGGER = 0x8b,
+  ROOT_REFERENCE_CLEANUP = 0x8c,
+  ROOT_VM_INTERNAL = 0x8d,
+  ROOT_JNI_MONITOR = 0x8e,
+  UNREACHABLE = 0x90,
+  PRIMITIVE_ARRAY_NODATA_DUMP = 0xc3,
+  HEAP_DUMP_INFO = 0xfe,
+  ROOT_UNKNOWN = 0xff,
+};
+
+enum BasicType : uint8_t {
+  OBJECT = 2,
+  BOOLEAN = 4,
+  CHAR = 5,
+  FLOAT = 6,
+  DOUBLE = 7,
+  BYTE = 8,
+  SHORT = 9,
+  INT = 10,
+  LONG = 11,
+};
+
+const char* primitive_array_name(uint8_t type) {
+  switch (type) {
+  case BOOLEAN:
+    return "boolean[]";
+  case CHAR:
+    return "char[]";
+  case FLOAT:
+    return "float[]";
+  case DOUBLE:
+    return "double[]";
+  case BYTE:
+    return "byte[]";
+  case SHORT:
+    return "short[]";
+  case INT:
+    return "int[]";
+  case LONG:
+    return "long[]";
+  default:
+    always_assert_log(false, "Unexpected primitive type %u", type);
+  }
+}
+
+// A cursor over the big-endian data of the dump.
+class Reader {
+ public:
+  Reader(const char* begin, const char* end, uint32_t id_size)
+      : m_ptr(reinterpret_cast<const uint8_t*>(begin)),
+        m_end(reinterpret_cast<const uint8_t*>(end)),
+        m_id_size(id_size) {}
+
+  bool at_end() const { return m_ptr >= m_end; }
+  const char* ptr() const { return reinterpret_cast<const char*>(m_ptr); }
+
+  uint8_t u1() {
+    check(1);
+    return *m_ptr++;
+  }
+
+  uint16_t u2() { return static_cast<uint16_t>(read(2)); }
+  uint32_t u4() { return static_cast<uint32_t>(read(4)); }
+  uint64_t id() { return read(m_id_size); }
+
+  void skip(uint64_t n) {
+    check(n);
+    m_ptr += n;
+  }
+
+  void skip_ids(uint64_t n) { skip(n * m_id_size); }
+
+  uint32_t size_of(uint8_t type) const {
+    switch (type) {
+    case OBJECT:
+      return m_id_size;
+    case BOOLEAN:
+    case BYTE:
+      return 1;
+    case CHAR:
+    case SHORT:
+      return 2;
+    case FLOAT:
+    case INT:
+      return 4;
+    case DOUBLE:
+    case LONG:
+      return 8;
+    default:
+      always_assert_log(false, "Unexpected basic type %u", type);
+    }
+  }
+
+ private:
+  void check(uint64_t n) const {
+    always_assert_log(n <= static_cast<uint64_t>(m_end - m_ptr),
+                      "Truncated hprof record");
+  }
+
+  uint64_t read(uint32_t n) {
+    check(n);
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      value = (value << 8) | *m_ptr++;
+    }
+    return value;
+  }
+
+  const uint8_t* m_ptr;
+  const uint8_t* m_end;
+  uint32_t m_id_size;
+};
+
+struct HeapStats {
+  uint64_t instances{0};
+  uint64_t shallow_size{0};
+};
+
+// Instance stats keyed by class object id. Primitive arrays have no class
+// object in the dump, so they are keyed by their element type instead, which
+// can't collide with the id of an object.
+using StatsMap = std::unordered_map<uint64_t, HeapStats>;
+
+struct LoadedClass {
+  uint32_t serial;
+  uint64_t name_id;
+};
+
+struct Hprof {
+  uint32_t id_size;
+  std::unordered_map<uint64_t, std::string> strings;
+  // Keyed by class object id.
+  std::unordered_map<uint64_t, LoadedClass> classes;
+  // The data of the HEAP_DUMP(_SEGMENT) records.
+  std::vector<std::pair<const char*, const char*>> heap_segments;
+};
+
+/*
+ * Reads the top level records. Only strings and class loads are decoded
+ * here, the heap dump segments are just located.
+ */
+Hprof read_records(const char* begin, const char* end) {
+  Hprof hprof;
+  auto header_end =
+      static_cast<const char*>(memchr(begin, '\0', end - begin));
+  always_assert_log(header_end != nullptr, "Not an hprof file");
+  Reader header(header_end + 1, end, 4);
+  hprof.id_size = header.u4();
+  always_assert_log(hprof.id_size == 4 || hprof.id_size == 8,
+                    "Unsupported id size %u", hprof.id_size);
+  header.skip(8); // timestamp
+
+  Reader reader(header.ptr(), end, hprof.id_size);
+  while (!reader.at_end()) {
+    auto tag = reader.u1();
+    reader.u4(); // time
+    auto length = reader.u4();
+    const char* body = reader.ptr();
+    reader.skip(length);
+    Reader record(body, body + length, hprof.id_size);
+    switch (tag) {
+    case STRING: {
+      auto id = record.id();
+      hprof.strings.emplace(id, std::string(record.ptr(), body + length));
+      break;
+    }
+    case LOAD_CLASS: {
+      auto serial = record.u4();
+      auto class_id = record.id();
+      record.u4(); // stack trace serial
+      auto name_id = record.id();
+      hprof.classes.emplace(class_id, LoadedClass{serial, name_id});
+      break;
+    }
+    case HEAP_DUMP:
+    case HEAP_DUMP_SEGMENT:
+      hprof.heap_segments.emplace_back(body, body + length);
+      break;
+    case HEAP_DUMP_END:
+      return hprof;
+    default:
+      break;
+    }
+  }
+  return hprof;
+}
+
+/*
+ * Counts the instances in one heap dump segment.
+ */
+StatsMap count_instances(const char* begin, const char* end, uint32_t id_size) {
+  StatsMap stats;
+  Reader reader(begin, end, id_size);
+  while (!reader.at_end()) {
+    auto tag = reader.u1();
+    switch (tag) {
+    case ROOT_UNKNOWN:
+    case ROOT_STICKY_CLASS:
+    case ROOT_MONITOR_USED:
+    case ROOT_INTERNED_STRING:
+    case ROOT_FINALIZING:
+    case ROOT_DEBUGGER:
+    case ROOT_REFERENCE_CLEANUP:
+    case ROOT_VM_INTERNAL:
+    case UNREACHABLE:
+      reader.skip_ids(1);
+      break;
+    case ROOT_JNI_GLOBAL:
+      reader.skip_ids(2);
+      break;
+    case ROOT_JNI_LOCAL:
+    case ROOT_JAVA_FRAME:
+    case ROOT_THREAD_OBJECT:
+    case ROOT_JNI_MONITOR:
+      reader.skip_ids(1);
+      reader.skip(8);
+      break;
+    case ROOT_NATIVE_STACK:
+    case ROOT_THREAD_BLOCK:
+      reader.skip_ids(1);
+      reader.skip(4);
+      break;
+    case HEAP_DUMP_INFO:
+      reader.skip(4);
+      reader.skip_ids(1);
+      break;
+    case CLASS_DUMP: {
+      // Class object, stack trace serial, super class, class loader,
+      // signers, protection domain and two reserved ids.
+      reader.skip_ids(1);
+      reader.skip(4);
+      reader.skip_ids(6);
+      reader.skip(4); // instance size
+      auto constants = reader.u2();
+      for (uint16_t i = 0; i < constants; ++i) {
+        reader.skip(2);
+        reader.skip(reader.size_of(reader.u1()));
+      }
+      auto statics = reader.u2();
+      for (uint16_t i = 0; i < statics; ++i) {
+        reader.skip_ids(1);
+        reader.skip(reader.size_of(reader.u1()));
+      }
+      auto fields = reader.u2();
+      for (uint16_t i = 0; i < fields; ++i) {
+        reader.skip_ids(1);
+        reader.skip(1);
+      }
+      break;
+    }
+    case INSTANCE_DUMP: {
+      reader.skip_ids(1);
+      reader.skip(4);
+      auto& class_stats = stats[reader.id()];
+      auto size = reader.u4();
+      reader.skip(size);
+      class_stats.instances++;
+      class_stats.shallow_size += size;
+      break;
+    }
+    case OBJECT_ARRAY_DUMP: {
+      reader.skip_ids(1);
+      reader.skip(4);
+      auto count = reader.u4();
+      auto& class_stats = stats[reader.id()];
+      reader.skip_ids(count);
+      class_stats.instances++;
+      class_stats.shallow_size += uint64_t(count) * id_size;
+      break;
+    }
+    case PRIMITIVE_ARRAY_DUMP:
+    case PRIMITIVE_ARRAY_NODATA_DUMP: {
+      reader.skip_ids(1);
+      reader.skip(4);
+      auto count = reader.u4();
+      auto type = reader.u1();
+      auto size = uint64_t(count) * reader.size_of(type);
+      if (tag == PRIMITIVE_ARRAY_DUMP) {
+        reader.skip(size);
+      }
+      auto& class_stats = stats[type];
+      class_stats.instances++;
+      class_stats.shallow_size += size;
+      break;
+    }
+    default:
+      always_assert_log(false, "Unknown heap dump tag 0x%x", tag);
+    }
+  }
+  return stats;
+}
+
+StatsMap count_all_instances(const Hprof& hprof) {
+  std::vector<StatsMap> segment_stats(hprof.heap_segments.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    const auto& segment = hprof.heap_segments[i];
+    segment_stats[i] =
+        count_instances(segment.first, segment.second, hprof.id_size);
+  });
+  for (size_t i = 0; i < hprof.heap_segments.size(); ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+
+  StatsMap stats;
+  for (const auto& segment : segment_stats) {
+    for (const auto& pair : segment) {
+      auto& class_stats = stats[pair.first];
+      class_stats.instances += pair.second.instances;
+      class_stats.shallow_size += pair.second.shallow_size;
+    }
+  }
+  return stats;
+}
+
+std::string class_name(const Hprof& hprof, const LoadedClass& cls) {
+  auto it = hprof.strings.find(cls.name_id);
+  always_assert_log(it != hprof.strings.end(), "Missing class name string");
+  return it->second;
+}
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void write_class_list(std::ostream& os, const Hprof& hprof) {
+  // A class loaded by several class loaders is listed where it was first
+  // loaded.
+  std::unordered_map<std::string, uint32_t> first_serial;
+  for (const auto& pair : hprof.classes) {
+    auto name = class_name(hprof, pair.second);
+    if (ends_with(name, "[]")) {
+      continue;
+    }
+    auto it = first_serial.emplace(std::move(name), pair.second.serial).first;
+    it->second = std::min(it->second, pair.second.serial);
+  }
+  std::vector<std::pair<uint32_t, std::string>> classes;
+  classes.reserve(first_serial.size());
+  for (auto& pair : first_serial) {
+    classes.emplace_back(pair.second, pair.first);
+  }
+  // On Dalvik and ART the serial numbers follow the class load order.
+  std::sort(classes.begin(), classes.end());
+  for (auto& cls : classes) {
+    std::replace(cls.second.begin(), cls.second.end(), '.', '/');
+    os << cls.second << ".class\n";
+  }
+}
+
+void write_stats(std::ostream& os, const Hprof& hprof, const StatsMap& stats) {
+  std::vector<std::pair<std::string, HeapStats>> by_name;
+  for (const auto& pair : stats) {
+    auto it = hprof.classes.find(pair.first);
+    std::string name = it != hprof.classes.end()
+                           ? class_name(hprof, it->second)
+                           : pair.first <= LONG
+                                 ? primitive_array_name(pair.first)
+                                 : "<unknown>";
+    by_name.emplace_back(std::move(name), pair.second);
+  }
+  std::sort(by_name.begin(), by_name.end(), [](const auto& a, const auto& b) {
+    if (a.second.shallow_size != b.second.shallow_size) {
+      return a.second.shallow_size > b.second.shallow_size;
+    }
+    return a.first < b.first;
+  });
+  os << "class,instances,shallow_size\n";
+  for (const auto& entry : by_name) {
+    os << entry.first << "," << entry.second.instances << ","
+       << entry.second.shallow_size << "\n";
+  }
+}
+
+class HprofClasses : public Tool {
+ public:
+  HprofClasses()
+      : Tool("hprof-classes",
+             "list the classes loaded in an hprof heap dump") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "hprof",
+        po::value<std::string>()->value_name("dump.hprof")->required(),
+        "heap dump to read")(
+        "output,o",
+        po::value<std::string>()->value_name("coldstart_classes.txt"),
+        "path to output class list (defaults to stdout)")(
+        "stats,s",
+        po::value<std::string>()->value_name("heap_stats.csv"),
+        "path to output the instance count and shallow size of each class");
+  }
+
+  void run(const po::variables_map& options) override {
+    boost::iostreams::mapped_file_source file(
+        options["hprof"].as<std::string>());
+    auto hprof = read_records(file.data(), file.data() + file.size());
+
+    if (options.count("output")) {
+      std::ofstream ofs(options["output"].as<std::string>(),
+                        std::ofstream::out | std::ofstream::trunc);
+      write_class_list(ofs, hprof);
+    } else {
+      write_class_list(std::cout, hprof);
+    }
+
+    if (options.count("stats")) {
+      auto stats = count_all_instances(hprof);
+      std::ofstream ofs(options["stats"].as<std::string>(),
+                        std::ofstream::out | std::ofstream::trunc);
+      write_stats(ofs, hprof, stats);
+    }
+  }
+};
+
+static HprofClasses s_tool;
+
+} // namespace